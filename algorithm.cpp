@@ -1,153 +1,330 @@
 #include "algorithm.h"
 #include "transport_system.h"
 #include "exceptions.h"
-#include <queue>
+#include "top_k_collector.h"
+#include "timetable.h"
 #include <algorithm>
+#include <set>
+#include <chrono>
+#include <functional>
 
 std::vector<Journey> BFSAlgorithm::findPath(const std::string& start, 
                                            const std::string& end,
                                            const Time& departureTime) {
-    std::vector<Journey> journeys;
-
-    struct SearchNode {
-        std::string currentStop;
-        Time currentTime;
-        std::vector<std::shared_ptr<Trip>> pathTrips;
-        std::vector<std::string> transferPoints;
-        int transfers;
-    };
+    JourneyStream stream(system, start, end, departureTime, JourneyOrder::ByDuration, maxTransfers);
+    return stream.take(resultLimit);
+}
 
-    std::queue<SearchNode> q;
-    q.push({start, departureTime, {}, {}, 0});
+std::vector<Journey> FastestPathAlgorithm::findPath(const std::string& start, 
+                                                   const std::string& end,
+                                                   const Time& departureTime) {
+    BFSAlgorithm bfs(system, 2, 1);
+    auto journeys = bfs.findPath(start, end, departureTime);
 
-    while (!q.empty()) {
-        auto node = q.front();
-        q.pop();
+    if (journeys.empty()) {
+        throw ContainerException("Маршрут не найден");
+    }
 
-        if (node.currentStop == end) {
-            journeys.emplace_back(node.pathTrips, node.transferPoints,
-                                 departureTime, node.currentTime);
-            continue;
-        }
+    return {journeys[0]}; // Возвращаем только самый быстрый
+}
 
-        if (node.transfers >= maxTransfers) {
-            continue;
+std::vector<Journey> MinimalTransfersAlgorithm::findPath(const std::string& start, 
+                                                         const std::string& end,
+                                                         const Time& departureTime) {
+    auto fewerTransfers = [](const Journey& a, const Journey& b) {
+        if (a.getTransferCount() != b.getTransferCount()) {
+            return a.getTransferCount() < b.getTransferCount();
         }
+        return a.getTotalDuration() < b.getTotalDuration();
+    };
+    TopKCollector<Journey, decltype(fewerTransfers)> best(1, fewerTransfers);
+
+    // Поездки приходят в порядке длительности: как только найдена поездка без пересадок,
+    // ни одна из следующих не может быть лучше
+    JourneyStream stream(system, start, end, departureTime, JourneyOrder::ByDuration, 2);
+    for (const auto& journey : stream) {
+        best.offer(journey);
+        if (best.worst().getTransferCount() == 0) {
+            break;
+        }
+    }
+
+    if (best.empty()) {
+        throw ContainerException("Маршрут не найден");
+    }
 
-        auto trips = system->getTripsThroughStop(node.currentStop);
+    return best.takeSorted();
+}
 
-        for (const auto& trip : trips) {
-            Time arrivalAtStop = trip->getArrivalTime(node.currentStop);
+std::vector<Journey> LatestDepartureAlgorithm::findPath(const std::string& start,
+                                                        const std::string& end,
+                                                        const Time& deadline,
+                                                        int weekDay) {
+    auto network = system->getSnapshot();
+    const TimetableIndex& index = network->getTimetableIndex();
+    const auto connections = index.getConnections();
+    const int source = index.findStop(start);
+    const int target = index.findStop(end);
+
+    if (source == -1 || target == -1 || source == target) {
+        return {};
+    }
 
-            if (arrivalAtStop < node.currentTime) {
-                continue;
-            }
+    const int NONE = -1;
+    const int NEVER = -1;
+    const int stopCount = index.getStopCount();
+    const int deadlineMinutes = deadline.getTotalMinutes();
+
+    // latest[s] - самое позднее отправление с остановки s, после которого можно успеть к сроку.
+    // boardAt[s] / leaveAt[s] - перегоны посадки и высадки этого этапа,
+    // tripExit[t] - перегон высадки, если рейс t уже ведет к цели.
+    // latestAlight[s] - самое позднее прибытие на s, после которого путь продолжается:
+    // пересадкой на той же остановке (с учетом минимального времени) или пешком к соседней
+    std::vector<int> latest(stopCount, NEVER);
+    std::vector<int> boardAt(stopCount, NONE);
+    std::vector<int> leaveAt(stopCount, NONE);
+    std::vector<int> tripExit(index.getTripCount(), NONE);
+    std::vector<int> latestAlight(stopCount, NEVER);
+
+    auto offerAlight = [&](int stop, int time) {
+        latestAlight[stop] = std::max(latestAlight[stop], time);
+    };
 
-            if (!node.pathTrips.empty() && node.pathTrips.back() == trip) {
-                continue;
-            }
+    latestAlight[target] = deadlineMinutes;
+    for (const auto& edge : index.getFootpathsTo(target)) {
+        offerAlight(edge.stop, deadlineMinutes - edge.minutes);
+    }
 
-            const auto& routeStops = trip->getRoute()->getAllStops();
-            int currentPos = trip->getRoute()->getStopPosition(node.currentStop);
+    // Самое позднее время выхода из начальной остановки (возможно, с переходом пешком к посадке)
+    int bestStart = NEVER;
+    int startWalkTo = NONE;
+    auto offerStart = [&](int time, int walkTo) {
+        if (time > bestStart) {
+            bestStart = time;
+            startWalkTo = walkTo;
+        }
+    };
 
-            if (currentPos == -1) continue;
+    auto last = std::upper_bound(connections.begin(), connections.end(), deadlineMinutes,
+                                 [](int time, const Connection& c) { return time < c.departure; });
 
-            for (int i = currentPos + 1; i < routeStops.size(); ++i) {
-                std::string nextStop = routeStops[i];
-                Time arrivalAtNext = trip->getArrivalTime(nextStop);
+    for (auto it = last; it != connections.begin();) {
+        --it;
+        const Connection& c = *it;
 
-                SearchNode nextNode = node;
-                nextNode.currentStop = nextStop;
-                nextNode.currentTime = arrivalAtNext;
-                nextNode.pathTrips.push_back(trip);
+        // Более раннее отправление уже не улучшит ответ для начальной остановки
+        if (c.departure < bestStart) {
+            break;
+        }
+        if (weekDay != 0 && c.weekDay != weekDay) {
+            continue;
+        }
 
-                if (!node.pathTrips.empty()) {
-                    nextNode.transferPoints.push_back(node.currentStop);
-                    nextNode.transfers++;
-                }
+        // Если рейс уже ведет к цели, остаемся в нем (меньше пересадок)
+        int& leave = tripExit[c.trip];
+        if (leave == NONE && c.arrival <= latestAlight[c.toStop]) {
+            leave = static_cast<int>(it - connections.begin());
+        }
+        if (leave == NONE) {
+            continue;
+        }
 
-                q.push(nextNode);
+        if (c.departure > latest[c.fromStop]) {
+            latest[c.fromStop] = c.departure;
+            boardAt[c.fromStop] = static_cast<int>(it - connections.begin());
+            leaveAt[c.fromStop] = leave;
+
+            offerAlight(c.fromStop, c.departure - index.getMinTransferTime(c.fromStop));
+            for (const auto& edge : index.getFootpathsTo(c.fromStop)) {
+                offerAlight(edge.stop, c.departure - edge.minutes);
+                if (edge.stop == source) {
+                    offerStart(c.departure - edge.minutes, c.fromStop);
+                }
+            }
+            if (c.fromStop == source) {
+                offerStart(c.departure, NONE);
             }
         }
     }
 
-    std::sort(journeys.begin(), journeys.end(),
-              [](const Journey& a, const Journey& b) {
-                  return a.getTotalDuration() < b.getTotalDuration();
-              });
-
-    return journeys;
-}
-
-std::vector<Journey> FastestPathAlgorithm::findPath(const std::string& start, 
-                                                   const std::string& end,
-                                                   const Time& departureTime) {
-    BFSAlgorithm bfs(system, 2);
-    auto journeys = bfs.findPath(start, end, departureTime);
+    if (bestStart == NEVER) {
+        return {};
+    }
 
-    if (journeys.empty()) {
-        throw ContainerException("Маршрут не найден");
+    // Восстановление поездки: от начальной остановки по лучшим этапам до цели.
+    // Итоговые значения latest только не меньше промежуточных, поэтому на каждой
+    // остановке подходит любое продолжение, на которое успеваем
+    std::vector<std::shared_ptr<Trip>> pathTrips;
+    std::vector<std::string> transferPoints;
+    int stop = startWalkTo == NONE ? source : startWalkTo;
+    int arrival = bestStart;
+    while (pathTrips.size() < connections.size()) {
+        const Connection& board = connections[boardAt[stop]];
+        const Connection& leave = connections[leaveAt[stop]];
+        pathTrips.push_back(index.getTrip(board.trip));
+        arrival = leave.arrival;
+        stop = leave.toStop;
+
+        if (stop == target) {
+            break;
+        }
+        int walkToTarget = index.getWalkMinutes(stop, target);
+        if (walkToTarget >= 0 && arrival + walkToTarget <= deadlineMinutes) {
+            arrival += walkToTarget;
+            break;
+        }
+        if (latest[stop] != NEVER && latest[stop] - index.getMinTransferTime(stop) >= arrival) {
+            transferPoints.push_back(index.getStopName(stop));
+            continue;
+        }
+        for (const auto& edge : index.getFootpathsFrom(stop)) {
+            if (latest[edge.stop] != NEVER && latest[edge.stop] - edge.minutes >= arrival) {
+                transferPoints.push_back(index.getStopName(stop) + " → " +
+                                         index.getStopName(edge.stop) + " (пешком)");
+                stop = edge.stop;
+                break;
+            }
+        }
     }
 
-    return {journeys[0]}; // Возвращаем только самый быстрый
+    return {Journey(pathTrips, transferPoints, Time(0, bestStart), Time(0, arrival))};
 }
 
-std::vector<Journey> MinimalTransfersAlgorithm::findPath(const std::string& start, 
-                                                         const std::string& end,
-                                                         const Time& departureTime) {
-    BFSAlgorithm bfs(system, 2);
-    auto journeys = bfs.findPath(start, end, departureTime);
-
-    if (journeys.empty()) {
-        throw ContainerException("Маршрут не найден");
+void ArrivalTimeCalculationAlgorithm::calculateArrivalTimes(Trip& trip, double averageSpeed) {
+    if (averageSpeed <= 0) {
+        throw InputException("Средняя скорость должна быть положительной");
     }
 
-    auto it = std::min_element(journeys.begin(), journeys.end(),
-                               [](const Journey& a, const Journey& b) {
-                                   return a.getTransferCount() < b.getTransferCount();
-                               });
+    const auto& stopsList = trip.getRoute()->getAllStops();
+
+    if (stopsList.empty()) {
+        throw ContainerException("Маршрут не содержит остановок");
+    }
 
-    return {*it};
+    // Рейс ссылается на общий массив смещений маршрута, собственного расписания не хранит
+    trip.setScheduleOffsets(system->getSegmentTable().routeOffsets(
+        trip.getRoute(), averageSpeed, trip.getStartTime().getTotalMinutes()));
 }
 
-void ArrivalTimeCalculationAlgorithm::calculateArrivalTimes(int tripId, double averageSpeed) {
-    if (averageSpeed <= 0) {
-        throw InputException("Средняя скорость должна быть положительной");
+std::vector<std::shared_ptr<Trip>> ArrivalTimeCalculationAlgorithm::calculateArrivalTimes(
+    const std::vector<std::shared_ptr<Trip>>& trips, const std::vector<double>& speeds) {
+    if (speeds.size() != trips.size()) {
+        throw InputException("Число скоростей не совпадает с числом рейсов");
     }
 
-    const auto& trips = system->getTrips();
-    auto tripIt = std::find_if(trips.begin(), trips.end(),
-                               [tripId](const auto& t) { return t->getTripId() == tripId; });
-
-    if (tripIt == trips.end()) {
-        throw ContainerException("Рейс с ID " + std::to_string(tripId) + " не найден");
+    lastBatchStats = ArrivalBatchStats();
+    lastBatchStats.trips = trips.size();
+    auto started = std::chrono::steady_clock::now();
+
+    // Массивы смещений общие для рейсов одного маршрута с одинаковой скоростью и поправкой
+    // и считаются таблицей перегонов один раз
+    const SegmentTable& segmentTable = system->getSegmentTable();
+    std::vector<std::shared_ptr<const std::vector<int>>> tripOffsets(trips.size());
+    std::set<const std::vector<int>*> patterns;
+    for (size_t t = 0; t < trips.size(); ++t) {
+        if (speeds[t] <= 0) {
+            throw InputException("Средняя скорость должна быть положительной");
+        }
+        const size_t stopCount = trips[t]->getRoute()->getAllStops().size();
+        if (stopCount == 0) {
+            throw ContainerException("Маршрут рейса " + std::to_string(trips[t]->getTripId()) +
+                                     " не содержит остановок");
+        }
+        tripOffsets[t] = segmentTable.routeOffsets(trips[t]->getRoute(), speeds[t],
+                                                   trips[t]->getStartTime().getTotalMinutes());
+        patterns.insert(tripOffsets[t].get());
+        lastBatchStats.stopTimes += stopCount;
     }
+    lastBatchStats.patterns = patterns.size();
+    auto computed = std::chrono::steady_clock::now();
+    lastBatchStats.computeMilliseconds = std::chrono::duration<double, std::milli>(computed - started).count();
+
+    TaskScheduler& scheduler = system->getScheduler();
+    int workers = threadCount > 0 ? threadCount : scheduler.getWorkerCount() + 1;
+    workers = std::max(1, std::min<int>(workers, static_cast<int>(trips.size() / BATCH_CHUNK_TRIPS) + 1));
+    lastBatchStats.threads = workers;
+
+    // Рейсы пересчитываются в копиях: прежние объекты может читать фоновое сохранение
+    std::vector<std::shared_ptr<Trip>> result(trips.size());
+    // Рейсы раздаются задачам планировщика кусками; каждая задача пишет только свои элементы
+    scheduler.parallelFor(trips.size(), BATCH_CHUNK_TRIPS, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            auto trip = std::make_shared<Trip>(*trips[t]);
+            trip->setScheduleOffsets(tripOffsets[t]);
+            result[t] = std::move(trip);
+        }
+    }, workers);
+    lastBatchStats.applyMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - computed).count();
+    return result;
+}
 
-    auto trip = *tripIt;
-    const auto& stopsList = trip->getRoute()->getAllStops();
+const ArrivalBatchStats& ArrivalTimeCalculationAlgorithm::getLastBatchStats() const {
+    return lastBatchStats;
+}
 
-    if (stopsList.empty()) {
-        throw ContainerException("Маршрут не содержит остановок");
+void DelayPropagationAlgorithm::setRecoveryMinutesPerStop(int minutes) {
+    if (minutes < 0) {
+        throw InputException("Нагон задержки не может быть отрицательным");
     }
+    recoveryMinutesPerStop = minutes;
+}
 
-    Time currentTime = trip->getStartTime();
-    trip->setArrivalTime(stopsList[0], currentTime);
+int DelayPropagationAlgorithm::getRecoveryMinutesPerStop() const {
+    return recoveryMinutesPerStop;
+}
 
-    const double distanceBetweenStops = 1.5; // км
-    const int stopTime = 1; // минута
+std::shared_ptr<Trip> DelayPropagationAlgorithm::propagate(const Trip& trip, size_t stopPosition, int delayMinutes,
+                                                           size_t& affectedStops) const {
+    return propagate(trip, stopPosition, delayMinutes, recoveryMinutesPerStop, affectedStops);
+}
 
-    for (size_t i = 1; i < stopsList.size(); ++i) {
-        double travelTimeMinutes = (distanceBetweenStops / averageSpeed) * 60;
-        Time arrivalTime = currentTime + static_cast<int>(travelTimeMinutes + 0.5);
-        trip->setArrivalTime(stopsList[i], arrivalTime);
-        currentTime = arrivalTime + stopTime;
+std::shared_ptr<Trip> DelayPropagationAlgorithm::propagate(const Trip& trip, size_t stopPosition, int delayMinutes,
+                                                           int recoveryMinutes, size_t& affectedStops) const {
+    if (recoveryMinutes < 0) {
+        throw InputException("Нагон задержки не может быть отрицательным");
+    }
+    const auto& routeStops = trip.getRoute()->getAllStops();
+    if (stopPosition >= routeStops.size()) {
+        throw InputException("Номер остановки вне маршрута рейса " + std::to_string(trip.getTripId()));
+    }
+    std::vector<int> current;
+    trip.getRouteStopMinutes(current);
+    if (current[stopPosition] == Trip::NO_STOP_TIME) {
+        throw ContainerException("Рейс " + std::to_string(trip.getTripId()) + " не останавливается на остановке " +
+                                 routeStops[stopPosition]);
+    }
+
+    const auto& offsets = trip.getScheduleOffsets();
+    const int start = trip.getStartTime().getTotalMinutes();
+    auto updated = std::make_shared<Trip>(trip);
+    affectedStops = 0;
+    int remaining = delayMinutes;
+    for (size_t i = stopPosition; i < routeStops.size(); ++i) {
+        if (current[i] == Trip::NO_STOP_TIME) {
+            continue;
+        }
+        const int planned = offsets && (*offsets)[i] != Trip::NO_STOP_TIME ? (start + (*offsets)[i]) % 1440
+                                                                            : current[i];
+        if (i > stopPosition) {
+            // Остановки без времени запаса не дают
+            remaining = remaining > 0 ? std::max(0, remaining - recoveryMinutes)
+                                      : std::min(0, remaining + recoveryMinutes);
+        }
+        const int expected = ((planned + remaining) % 1440 + 1440) % 1440;
+        if (expected != current[i]) {
+            updated->setArrivalTime(routeStops[i], Time(0, expected));
+            affectedStops++;
+        }
     }
+    return updated;
 }
 
 std::vector<std::shared_ptr<Route>> RouteSearchAlgorithm::findRoutes(const std::string& stopA, 
                                                                     const std::string& stopB) {
     std::vector<std::shared_ptr<Route>> foundRoutes;
-    const auto& routes = system->getRoutes();
+    auto network = system->getSnapshot();
+    const auto& routes = network->getRoutes();
     
     for (const auto& route : routes) {
         if (route->containsStop(stopA) &&
@@ -8,6 +8,7 @@
 #include "time.h"
 #include "route.h"
 #include "trip.h"
+#include "journey_stream.h"
 
 class TransportSystem;
 
@@ -42,14 +43,17 @@ public:
     void execute() override {}
 };
 
-// Алгоритм поиска в ширину (BFS) для поиска маршрутов с пересадками
+// Алгоритм поиска маршрутов с пересадками.
+// Вершины обходятся в порядке времени прибытия (JourneyStream), поэтому поиск
+// останавливается, как только найдено resultLimit лучших поездок (0 - все поездки).
 class BFSAlgorithm : public PathFindingAlgorithm {
 private:
     int maxTransfers;
+    size_t resultLimit;
 
 public:
-    BFSAlgorithm(TransportSystem* sys, int maxTransfers = 2) 
-        : PathFindingAlgorithm(sys), maxTransfers(maxTransfers) {}
+    BFSAlgorithm(TransportSystem* sys, int maxTransfers = 2, size_t resultLimit = 0) 
+        : PathFindingAlgorithm(sys), maxTransfers(maxTransfers), resultLimit(resultLimit) {}
 
     std::vector<Journey> findPath(const std::string& start, 
                                  const std::string& end,
@@ -96,12 +100,59 @@ public:
     }
 };
 
+// Алгоритм обратного поиска "прибыть к сроку": самое позднее отправление,
+// при котором можно успеть на конечную остановку к заданному времени.
+// Просматривает перегоны компактного расписания (TimetableIndex) в обратном порядке.
+// Учитывает минимальное время пересадки и пешие переходы между остановками.
+class LatestDepartureAlgorithm : public Algorithm {
+public:
+    explicit LatestDepartureAlgorithm(TransportSystem* sys) : Algorithm(sys) {}
+
+    // weekDay = 0 - любой день. Пустой результат означает, что маршрута нет
+    std::vector<Journey> findPath(const std::string& start,
+                                  const std::string& end,
+                                  const Time& deadline,
+                                  int weekDay = 0);
+
+    void execute() override {}
+
+    std::string getDescription() const override {
+        return "Алгоритм поиска самого позднего отправления для прибытия к сроку";
+    }
+};
+
+// Итоги пакетного пересчета времени прибытия
+struct ArrivalBatchStats {
+    size_t trips = 0;
+    size_t stopTimes = 0;
+    size_t patterns = 0;              // различных общих массивов смещений
+    int threads = 0;                  // задач планировщика
+    double computeMilliseconds = 0.0; // подбор общих массивов смещений
+    double applyMilliseconds = 0.0;   // сборка новых объектов рейсов
+};
+
 // Алгоритм расчета времени прибытия
 class ArrivalTimeCalculationAlgorithm : public Algorithm {
-public:
-    explicit ArrivalTimeCalculationAlgorithm(TransportSystem* sys) : Algorithm(sys) {}
+private:
+    int threadCount;
+    ArrivalBatchStats lastBatchStats;
+    // Столько рейсов задача пакетного пересчета берет за раз
+    static const size_t BATCH_CHUNK_TRIPS = 1024;
 
-    void calculateArrivalTimes(int tripId, double averageSpeed);
+public:
+    explicit ArrivalTimeCalculationAlgorithm(TransportSystem* sys, int threads = 0)
+        : Algorithm(sys), threadCount(threads) {}
+
+    // Время движения по перегонам берется из таблицы перегонов системы (SegmentTable).
+    // Рейс изменяется на месте: вызывающий передает объект, который еще никто не читает
+    void calculateArrivalTimes(Trip& trip, double averageSpeed);
+    // Пакетный пересчет: speeds[i] - скорость для trips[i]. Рейсы с одинаковым маршрутом, скоростью
+    // и поправкой на время суток ссылаются на общий массив смещений маршрута;
+    // копии рейсов с новым массивом собираются параллельно задачами планировщика системы.
+    // Возвращает новые объекты в том же порядке; исходные рейсы не изменяются
+    std::vector<std::shared_ptr<Trip>> calculateArrivalTimes(const std::vector<std::shared_ptr<Trip>>& trips,
+                                                             const std::vector<double>& speeds);
+    const ArrivalBatchStats& getLastBatchStats() const;
 
     void execute() override {
         // Реализация может быть добавлена при необходимости
@@ -112,6 +163,45 @@ public:
     }
 };
 
+// Результат обновления задержки рейса
+struct DelayUpdateResult {
+    size_t affectedStops = 0;      // остановок, на которых изменилось время
+    size_t changedConnections = 0; // перегонов, переставленных в индексе расписания
+    bool indexUpdated = false;     // индекс обновлен на месте (иначе перестроится при обращении)
+    double microseconds = 0.0;
+};
+
+// Алгоритм распространения задержки рейса вниз по маршруту
+class DelayPropagationAlgorithm : public Algorithm {
+private:
+    int recoveryMinutesPerStop;
+
+public:
+    explicit DelayPropagationAlgorithm(TransportSystem* sys, int recoveryPerStop = 0)
+        : Algorithm(sys), recoveryMinutesPerStop(recoveryPerStop) {}
+
+    // На каждой следующей остановке задержка сокращается на столько минут (запас в стоянках и перегонах)
+    void setRecoveryMinutesPerStop(int minutes);
+    int getRecoveryMinutesPerStop() const;
+
+    // Копия рейса, который на остановке stopPosition маршрута опаздывает на delayMinutes
+    // (отрицательное значение - идет раньше). Задержка отсчитывается от планового времени
+    // (общего шаблона рейса; без шаблона - от текущего) и сокращается к нулю на следующих
+    // остановках. Прежний прогноз ниже по маршруту заменяется целиком.
+    // affectedStops - число остановок с измененным временем
+    std::shared_ptr<Trip> propagate(const Trip& trip, size_t stopPosition, int delayMinutes,
+                                    size_t& affectedStops) const;
+    // То же с нагоном recoveryMinutes на остановку вместо заданного алгоритму
+    std::shared_ptr<Trip> propagate(const Trip& trip, size_t stopPosition, int delayMinutes,
+                                    int recoveryMinutes, size_t& affectedStops) const;
+
+    void execute() override {}
+
+    std::string getDescription() const override {
+        return "Алгоритм распространения задержки рейса";
+    }
+};
+
 // Алгоритм поиска маршрутов между остановками
 class RouteSearchAlgorithm : public Algorithm {
 public:
@@ -0,0 +1,92 @@
+#include "background_saver.h"
+
+BackgroundSaver::BackgroundSaver(WriteFunction writeFunction) : write(std::move(writeFunction)) {}
+
+BackgroundSaver::~BackgroundSaver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void BackgroundSaver::request(NetworkState state, std::function<void()> onSuccess) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending) {
+            status.coalesced++;
+        }
+        pending = std::move(state);
+        // Более новая копия содержит все, что было в старой, поэтому ее успех
+        // можно засчитать и ожидавшему обработчику
+        if (onSuccess) {
+            pendingOnSuccess = std::move(onSuccess);
+        }
+        // Поток запускается при первом запросе
+        if (!worker.joinable()) {
+            worker = std::thread(&BackgroundSaver::run, this);
+        }
+    }
+    changed.notify_all();
+}
+
+void BackgroundSaver::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this] { return pending || stopping; });
+        if (!pending) {
+            return; // остановка с пустой очередью
+        }
+
+        NetworkState state = std::move(*pending);
+        pending.reset();
+        std::function<void()> onSuccess = std::move(pendingOnSuccess);
+        pendingOnSuccess = nullptr;
+        running = true;
+        status.state = SaveState::Running;
+        lock.unlock();
+
+        SaveStats stats;
+        std::string error;
+        bool succeeded = true;
+        try {
+            stats = write(state);
+            if (onSuccess) {
+                onSuccess();
+            }
+        } catch (const std::exception& e) {
+            succeeded = false;
+            error = e.what();
+        }
+
+        lock.lock();
+        running = false;
+        status.completed++;
+        if (succeeded) {
+            status.state = SaveState::Succeeded;
+            status.lastStats = stats;
+        } else {
+            status.state = SaveState::Failed;
+            status.error = error;
+        }
+        changed.notify_all();
+    }
+}
+
+void BackgroundSaver::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !pending && !running; });
+}
+
+bool BackgroundSaver::isBusy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending.has_value() || running;
+}
+
+SaveStatus BackgroundSaver::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return status;
+}
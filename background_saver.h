@@ -0,0 +1,71 @@
+#ifndef BACKGROUND_SAVER_H
+#define BACKGROUND_SAVER_H
+
+#include <string>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "network_state.h"
+
+// Итоги полного сохранения
+struct SaveStats {
+    size_t bytes = 0;          // записано байт, включая manifest.txt
+    double milliseconds = 0.0; // от начала сериализации до переименования последнего файла
+    uint64_t generation = 0;   // номер поколения в manifest.txt
+};
+
+enum class SaveState {
+    Idle,      // сохранений еще не было
+    Running,   // идет запись
+    Succeeded, // последнее сохранение завершено
+    Failed     // последнее сохранение завершилось ошибкой
+};
+
+struct SaveStatus {
+    SaveState state = SaveState::Idle;
+    SaveStats lastStats;         // последнего успешного сохранения
+    std::string error;           // текст последней ошибки
+    unsigned long long completed = 0; // завершенных сохранений (успешных и нет)
+    unsigned long long coalesced = 0; // запросов, замененных более новыми до начала записи
+};
+
+// Фоновое сохранение: копия сети записывается в отдельном потоке.
+// Одновременно выполняется не больше одной записи; запрос, пришедший во время записи,
+// ждет ее окончания, а несколько таких запросов объединяются - записывается самый новый.
+class BackgroundSaver {
+public:
+    using WriteFunction = std::function<SaveStats(const NetworkState&)>;
+
+private:
+    WriteFunction write;
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::optional<NetworkState> pending;
+    std::function<void()> pendingOnSuccess;
+    bool running = false;
+    bool stopping = false;
+    SaveStatus status;
+
+    void run();
+
+public:
+    explicit BackgroundSaver(WriteFunction writeFunction);
+    // Дожидается записи всех принятых запросов
+    ~BackgroundSaver();
+
+    BackgroundSaver(const BackgroundSaver&) = delete;
+    BackgroundSaver& operator=(const BackgroundSaver&) = delete;
+
+    // onSuccess вызывается в фоновом потоке после успешной записи этой или более новой копии
+    void request(NetworkState state, std::function<void()> onSuccess = {});
+    // Ожидание, пока очередь не опустеет
+    void wait();
+    bool isBusy() const;
+    SaveStatus getStatus() const;
+};
+
+#endif // BACKGROUND_SAVER_H
@@ -0,0 +1,105 @@
+// Замер пересчета времени прибытия: по одному рейсу против пакетного пересчета всех рейсов.
+// Сборка: cmake -DBUILD_BENCHMARKS=ON; запуск:
+//   arrival_batch_benchmark [рейсов=100000] [рейсов по одному=все]
+// Если по одному пересчитаны все рейсы, расписания двух систем сравниваются.
+#include "../transport_system.h"
+#include "../ui.h"
+#include <chrono>
+#include <map>
+#include <algorithm>
+#include <filesystem>
+#include <cstdlib>
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Тестовая сеть, размноженная до нужного числа рейсов
+void buildNetwork(TransportSystem& system, int totalTrips) {
+    std::cout.setstate(std::ios::failbit);
+    initializeTestData(system);
+    std::cout.clear();
+    auto base = system.getTrips();
+    int nextId = 100000;
+    while (static_cast<int>(system.getTrips().size()) < totalTrips) {
+        for (const auto& trip : base) {
+            if (static_cast<int>(system.getTrips().size()) >= totalTrips) {
+                break;
+            }
+            nextId++;
+            system.addTripDirect(std::make_shared<Trip>(nextId, trip->getRoute(), trip->getVehicle(),
+                                                        trip->getDriver(), trip->getStartTime() + nextId % 90,
+                                                        trip->getWeekDay()));
+        }
+    }
+}
+
+double speedOf(const Trip& trip) {
+    const std::string& type = trip.getRoute()->getVehicleType();
+    return type == "Трамвай" ? 25.0 : type == "Троллейбус" ? 28.0 : 30.0;
+}
+
+// Время на остановках маршрута по номерам рейсов
+std::map<int, std::vector<int>> schedules(const TransportSystem& system) {
+    std::map<int, std::vector<int>> result;
+    for (const auto& trip : system.getTrips()) {
+        trip->getRouteStopMinutes(result[trip->getTripId()]);
+    }
+    return result;
+}
+
+void printBatch(const char* title, const ArrivalBatchStats& stats, double totalMilliseconds) {
+    std::cout << title << ": рейсов " << stats.trips << ", остановок " << stats.stopTimes
+              << ", общих массивов смещений " << stats.patterns << ", потоков " << stats.threads
+              << "; расчет " << stats.computeMilliseconds << " мс, копии " << stats.applyMilliseconds
+              << " мс, всего " << totalMilliseconds << " мс\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int totalTrips = argc > 1 ? std::atoi(argv[1]) : 100000;
+    const int perTripCount = argc > 2 ? std::min(std::atoi(argv[2]), totalTrips) : totalTrips;
+
+    try {
+        const std::string directory = "benchmark_data/";
+        std::filesystem::remove_all(directory);
+        TransportSystem perTrip(directory);
+        buildNetwork(perTrip, totalTrips);
+        TransportSystem batch(directory);
+        buildNetwork(batch, totalTrips);
+
+        std::vector<std::pair<int, double>> targets;
+        for (const auto& trip : perTrip.getTrips()) {
+            if (static_cast<int>(targets.size()) >= perTripCount) {
+                break;
+            }
+            targets.push_back({trip->getTripId(), speedOf(*trip)});
+        }
+        auto started = std::chrono::steady_clock::now();
+        for (const auto& [tripId, speed] : targets) {
+            perTrip.calculateArrivalTimes(tripId, speed);
+        }
+        double perTripMilliseconds = millisecondsSince(started);
+        std::cout << "По одному рейсу: рейсов " << targets.size() << ", всего " << perTripMilliseconds << " мс ("
+                  << (targets.empty() ? 0.0 : perTripMilliseconds * 1000.0 / targets.size()) << " мкс на рейс)\n";
+
+        // Повторный пересчет берет массивы смещений из заполненной таблицы перегонов
+        for (const char* title : {"Пакет", "Пакет повторно"}) {
+            started = std::chrono::steady_clock::now();
+            ArrivalBatchStats stats = batch.recalculateArrivalTimes(nullptr, speedOf);
+            printBatch(title, stats, millisecondsSince(started));
+        }
+
+        if (perTripCount == totalTrips) {
+            std::cout << "Расписания совпадают: " << (schedules(perTrip) == schedules(batch) ? "да" : "НЕТ") << "\n";
+        }
+        std::filesystem::remove_all(directory);
+    } catch (const std::exception& e) {
+        std::cerr << "Ошибка: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Замер конкуренции потоков: один поток изменяет сеть, N потоков выполняют запросы.
+// Сборка: cmake -DBUILD_BENCHMARKS=ON; запуск:
+//   contention_benchmark [рейсов=20000] [потоков запросов=1,2,4] [секунд=10] [пауза записи, мс=5]
+#include "../transport_system.h"
+#include "../ui.h"
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <filesystem>
+#include <cstdlib>
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Тестовая сеть, размноженная до нужного числа рейсов, с рассчитанным временем прибытия
+void buildNetwork(TransportSystem& system, int totalTrips) {
+    std::cout.setstate(std::ios::failbit);
+    initializeTestData(system);
+    std::cout.clear();
+    auto base = system.getTrips();
+    int nextId = 100000;
+    while (static_cast<int>(system.getTrips().size()) < totalTrips) {
+        for (const auto& trip : base) {
+            if (static_cast<int>(system.getTrips().size()) >= totalTrips) {
+                break;
+            }
+            nextId++;
+            system.addTripDirect(std::make_shared<Trip>(nextId, trip->getRoute(), trip->getVehicle(),
+                                                        trip->getDriver(), trip->getStartTime() + nextId % 90,
+                                                        trip->getWeekDay()));
+        }
+    }
+    system.recalculateArrivalTimes(nullptr, [](const Trip&) { return 27.0; });
+    system.publishSnapshot();
+}
+
+struct ReaderResult {
+    long queries = 0;
+    double totalMilliseconds = 0.0;
+    double worstMilliseconds = 0.0;
+    long errors = 0;
+};
+
+void runRound(TransportSystem& system, int readers, int seconds, int pauseMilliseconds) {
+    std::vector<std::string> stops;
+    for (const auto& stop : system.getStops()) {
+        stops.push_back(stop.getName());
+    }
+    std::vector<int> routeNumbers;
+    for (const auto& route : system.getRoutes()) {
+        routeNumbers.push_back(route->getNumber());
+    }
+    // Рейсы с рассчитанным временем - для задержек
+    std::vector<int> timedTrips;
+    for (const auto& trip : system.getTrips()) {
+        std::vector<int> minutes;
+        trip->getRouteStopMinutes(minutes);
+        if (std::any_of(minutes.begin(), minutes.end(), [](int m) { return m != Trip::NO_STOP_TIME; })) {
+            timedTrips.push_back(trip->getTripId());
+        }
+    }
+
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::vector<ReaderResult> results(readers);
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::mt19937 random(r + 1);
+            ReaderResult& result = results[r];
+            while (!go) {
+                std::this_thread::yield();
+            }
+            while (!stop) {
+                auto started = std::chrono::steady_clock::now();
+                const std::string& from = stops[random() % stops.size()];
+                const std::string& to = stops[random() % stops.size()];
+                try {
+                    switch (result.queries % 5) {
+                        case 0: system.findRoutes(from, to); break;
+                        case 1: system.getTripsThroughStop(from); break;
+                        case 2:
+                            if (!system.findRouteByNumber(routeNumbers[random() % routeNumbers.size()])) {
+                                result.errors++;
+                            }
+                            break;
+                        case 3:
+                            try {
+                                system.getJourneyPlanner().findLatestDepartureJourney(from, to, Time(12, 0));
+                            } catch (const ContainerException&) {
+                                // поездки к сроку нет
+                            }
+                            break;
+                        case 4: system.getJourneyPlanner().findJourneysWithTransfers(from, to, Time(7, 0), 0, 3); break;
+                    }
+                } catch (const std::exception&) {
+                    result.errors++;
+                }
+                double elapsed = millisecondsSince(started);
+                result.totalMilliseconds += elapsed;
+                result.worstMilliseconds = std::max(result.worstMilliseconds, elapsed);
+                result.queries++;
+            }
+        });
+    }
+
+    // Поток изменений: задержки, добавление и удаление рейсов, отмена команд
+    std::mt19937 random(99);
+    long writes = 0;
+    double writeTotal = 0.0;
+    double writeWorst = 0.0;
+    int nextTripId = 900000;
+    go = true;
+    auto roundStart = std::chrono::steady_clock::now();
+    std::ostringstream silenced;
+    auto* previous = std::cout.rdbuf(silenced.rdbuf());
+    while (millisecondsSince(roundStart) < seconds * 1000.0) {
+        auto started = std::chrono::steady_clock::now();
+        int kind = random() % 10;
+        if (kind < 6) {
+            int tripId = timedTrips[random() % timedTrips.size()];
+            std::vector<int> minutes;
+            system.getTripById(tripId)->getRouteStopMinutes(minutes);
+            size_t position;
+            do {
+                position = random() % minutes.size();
+            } while (minutes[position] == Trip::NO_STOP_TIME);
+            system.applyDelay(tripId, position, static_cast<int>(random() % 20));
+        } else if (kind < 8) {
+            auto base = system.getTripById(timedTrips[random() % timedTrips.size()]);
+            system.addTrip(std::make_shared<Trip>(nextTripId++, base->getRoute(), base->getVehicle(),
+                                                  base->getDriver(), base->getStartTime() + 5, base->getWeekDay()));
+        } else if (kind < 9 && system.canUndo()) {
+            system.undo();
+        } else if (nextTripId > 900000 && system.getTripById(nextTripId - 1)) {
+            system.removeTrip(nextTripId - 1);
+        }
+        system.publishSnapshot();
+        double elapsed = millisecondsSince(started);
+        writeTotal += elapsed;
+        writeWorst = std::max(writeWorst, elapsed);
+        writes++;
+        if (pauseMilliseconds > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(pauseMilliseconds));
+        }
+    }
+    std::cout.rdbuf(previous);
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ReaderResult total;
+    for (const auto& result : results) {
+        total.queries += result.queries;
+        total.totalMilliseconds += result.totalMilliseconds;
+        total.worstMilliseconds = std::max(total.worstMilliseconds, result.worstMilliseconds);
+        total.errors += result.errors;
+    }
+    std::cout << "Потоков запросов: " << readers
+              << "; запросов " << total.queries << " (" << total.queries / static_cast<double>(seconds) << "/с)"
+              << ", среднее " << (total.queries ? total.totalMilliseconds / total.queries : 0.0) << " мс"
+              << ", худшее " << total.worstMilliseconds << " мс"
+              << "; изменений " << writes << ", среднее " << (writes ? writeTotal / writes : 0.0) << " мс"
+              << ", худшее " << writeWorst << " мс; ошибок " << total.errors << "\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int totalTrips = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::vector<int> readerCounts{1, 2, 4};
+    if (argc > 2) {
+        readerCounts.clear();
+        std::stringstream list(argv[2]);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            readerCounts.push_back(std::atoi(item.c_str()));
+        }
+    }
+    const int seconds = argc > 3 ? std::atoi(argv[3]) : 10;
+    const int pause = argc > 4 ? std::atoi(argv[4]) : 5;
+
+    try {
+        const std::string directory = "benchmark_data/";
+        std::filesystem::remove_all(directory);
+        for (int readers : readerCounts) {
+            TransportSystem system(directory);
+            buildNetwork(system, totalTrips);
+            runRound(system, readers, seconds, pause);
+        }
+        std::filesystem::remove_all(directory);
+    } catch (const std::exception& e) {
+        std::cerr << "Ошибка: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
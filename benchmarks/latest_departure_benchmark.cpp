@@ -0,0 +1,124 @@
+// Замер обратного поиска (самое позднее отправление к сроку) против прямого поиска
+// от остановки до всех (TimetableIndex::earliestArrivalFromStop) по всем парам остановок.
+// Сборка: cmake -DBUILD_BENCHMARKS=ON; запуск:
+//   latest_departure_benchmark [рейсов=20000] [сроки, минуты=480,600,900,1200] [день недели=1]
+// Каждый ответ обратного поиска проверяется прямым поиском от найденного времени и минутой позже.
+#include "../transport_system.h"
+#include "../ui.h"
+#include <chrono>
+#include <sstream>
+#include <cstdlib>
+#include <filesystem>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double microsecondsBetween(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// Тестовая сеть, размноженная до нужного числа рейсов, с рассчитанным временем прибытия
+void buildNetwork(TransportSystem& system, int totalTrips) {
+    std::cout.setstate(std::ios::failbit);
+    initializeTestData(system);
+    std::cout.clear();
+    auto base = system.getTrips();
+    int nextId = 100000;
+    while (static_cast<int>(system.getTrips().size()) < totalTrips) {
+        for (const auto& trip : base) {
+            if (static_cast<int>(system.getTrips().size()) >= totalTrips) {
+                break;
+            }
+            nextId++;
+            system.addTripDirect(std::make_shared<Trip>(nextId, trip->getRoute(), trip->getVehicle(),
+                                                        trip->getDriver(), trip->getStartTime() + nextId % 90,
+                                                        trip->getWeekDay()));
+        }
+    }
+    system.recalculateArrivalTimes(nullptr, [](const Trip&) { return 27.0; });
+}
+
+}
+
+int main(int argc, char** argv) {
+    const int totalTrips = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::vector<int> deadlines{480, 600, 900, 1200};
+    if (argc > 2) {
+        deadlines.clear();
+        std::stringstream list(argv[2]);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            deadlines.push_back(std::atoi(item.c_str()));
+        }
+    }
+    const int weekDay = argc > 3 ? std::atoi(argv[3]) : 1;
+
+    try {
+        const std::string directory = "benchmark_data/";
+        std::filesystem::remove_all(directory);
+        TransportSystem system(directory);
+        buildNetwork(system, totalTrips);
+
+        const TimetableIndex& index = system.getTimetableIndex();
+        const int stopCount = index.getStopCount();
+        LatestDepartureAlgorithm reverse(&system);
+        std::vector<int> arrival;
+        std::vector<int> transfers;
+
+        long queries = 0;
+        long found = 0;
+        long mismatches = 0;
+        double reverseMicroseconds = 0.0;
+        double forwardMicroseconds = 0.0;
+        for (int deadline : deadlines) {
+            for (int origin = 0; origin < stopCount; ++origin) {
+                for (int target = 0; target < stopCount; ++target) {
+                    if (origin == target) {
+                        continue;
+                    }
+                    auto started = Clock::now();
+                    auto journeys = reverse.findPath(index.getStopName(origin), index.getStopName(target),
+                                                     Time(0, deadline), weekDay);
+                    auto reversed = Clock::now();
+                    index.earliestArrivalFromStop(origin, 0, weekDay, arrival, transfers);
+                    auto forwarded = Clock::now();
+                    reverseMicroseconds += microsecondsBetween(started, reversed);
+                    forwardMicroseconds += microsecondsBetween(reversed, forwarded);
+                    queries++;
+
+                    // Проверка: без ответа цель недостижима к сроку; с ответом - отправление
+                    // в найденное время успевает к сроку, а минутой позже уже нет
+                    if (journeys.empty()) {
+                        if (arrival[target] <= deadline) {
+                            mismatches++;
+                        }
+                        continue;
+                    }
+                    found++;
+                    const int departure = journeys[0].getStartTime().getTotalMinutes();
+                    index.earliestArrivalFromStop(origin, departure, weekDay, arrival, transfers);
+                    bool mismatch = journeys[0].getEndTime().getTotalMinutes() > deadline ||
+                                    arrival[target] > deadline;
+                    index.earliestArrivalFromStop(origin, departure + 1, weekDay, arrival, transfers);
+                    if (mismatch || arrival[target] <= deadline) {
+                        mismatches++;
+                    }
+                }
+            }
+        }
+
+        std::cout << "Рейсов " << system.getTrips().size() << ", остановок " << stopCount << "\n"
+                  << "Запросов " << queries << ", найдено поездок " << found << "\n"
+                  << "Обратный поиск: всего " << reverseMicroseconds / 1000.0 << " мс, "
+                  << (queries ? reverseMicroseconds / queries : 0.0) << " мкс на запрос\n"
+                  << "Прямой поиск до всех остановок: всего " << forwardMicroseconds / 1000.0 << " мс, "
+                  << (queries ? forwardMicroseconds / queries : 0.0) << " мкс на запрос\n"
+                  << "Несовпадений с прямым поиском: " << mismatches << "\n";
+        std::filesystem::remove_all(directory);
+    } catch (const std::exception& e) {
+        std::cerr << "Ошибка: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,437 @@
+#include "binary_snapshot.h"
+#include "transport_system.h"
+#include "mapped_file.h"
+#include "network_state.h"
+#include "bus.h"
+#include "tram.h"
+#include "trolleybus.h"
+#include <span>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[4] = {'T', 'N', 'S', 'N'};
+const size_t SECTION_ALIGNMENT = 8;
+
+enum Section : uint32_t {
+    StringTable,
+    StringData,
+    StopsSection,
+    VehiclesSection,
+    DriversSection,
+    RoutesSection,
+    RouteStopsSection,
+    TripsSection,
+    StopTimesSection,
+    TransfersSection,
+    FootpathsSection,
+    IndexStopsSection,
+    ConnectionsSection,
+    SectionCount
+};
+
+struct SectionEntry {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    SectionEntry sections[SectionCount];
+};
+
+// Строки хранятся один раз и адресуются номером в таблице
+struct StringRecord {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct StopRecord {
+    int32_t id;
+    uint32_t name;
+};
+
+struct VehicleRecord {
+    uint32_t type;
+    uint32_t model;
+    uint32_t licensePlate;
+};
+
+struct DriverRecord {
+    uint32_t firstName;
+    uint32_t lastName;
+    uint32_t middleName;
+    uint32_t category;
+};
+
+struct RouteRecord {
+    int32_t number;
+    uint32_t vehicleType;
+    uint32_t firstStop;   // начало списка остановок в секции RouteStops
+    uint32_t stopCount;
+    uint32_t weekDayMask; // бит d - маршрут работает в день d (1..7)
+    uint32_t registered;  // 1 - маршрут есть в списке маршрутов системы, 0 - используется только рейсами
+};
+
+struct TripRecord {
+    int32_t id;
+    uint32_t route;
+    uint32_t vehicle;
+    int32_t driver; // -1 - водитель не назначен
+    int32_t startMinutes;
+    int32_t weekDay;
+    uint32_t firstStopTime; // начало расписания в секции StopTimes
+    uint32_t stopTimeCount;
+};
+
+struct StopTimeRecord {
+    uint32_t stop;
+    int32_t minutes;
+};
+
+struct TransferRecord {
+    int32_t stopId;
+    int32_t minutes;
+};
+
+struct FootpathRecord {
+    int32_t fromStopId;
+    int32_t toStopId;
+    int32_t minutes;
+};
+
+static_assert(std::is_trivially_copyable_v<Connection> && sizeof(Connection) == 6 * sizeof(int32_t),
+              "Перегон должен записываться в файл как есть");
+
+class SnapshotWriter {
+private:
+    std::vector<char> sections[SectionCount];
+    uint64_t counts[SectionCount] = {};
+    std::unordered_map<std::string, uint32_t> stringIds;
+
+public:
+    template <typename T>
+    void append(Section section, const T& record) {
+        const char* bytes = reinterpret_cast<const char*>(&record);
+        sections[section].insert(sections[section].end(), bytes, bytes + sizeof(T));
+        counts[section]++;
+    }
+
+    template <typename T>
+    void appendAll(Section section, std::span<const T> records) {
+        const char* bytes = reinterpret_cast<const char*>(records.data());
+        sections[section].insert(sections[section].end(), bytes, bytes + records.size_bytes());
+        counts[section] += records.size();
+    }
+
+    uint32_t string(const std::string& value) {
+        auto it = stringIds.find(value);
+        if (it != stringIds.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(counts[StringTable]);
+        append(StringTable, StringRecord{static_cast<uint32_t>(sections[StringData].size()),
+                                         static_cast<uint32_t>(value.size())});
+        sections[StringData].insert(sections[StringData].end(), value.begin(), value.end());
+        counts[StringData] += value.size();
+        stringIds.emplace(value, id);
+        return id;
+    }
+
+    // Файл целиком собирается в одном буфере
+    std::string finish() {
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = BinarySnapshot::VERSION;
+
+        auto align = [](uint64_t value) {
+            return (value + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+        };
+        uint64_t offset = align(sizeof(SnapshotHeader));
+        for (uint32_t s = 0; s < SectionCount; ++s) {
+            header.sections[s] = {offset, counts[s]};
+            offset = align(offset + sections[s].size());
+        }
+        header.fileSize = offset;
+
+        // Промежутки выравнивания остаются нулевыми
+        std::string result(header.fileSize, '\0');
+        std::memcpy(result.data(), &header, sizeof(header));
+        for (uint32_t s = 0; s < SectionCount; ++s) {
+            if (!sections[s].empty()) {
+                std::memcpy(result.data() + header.sections[s].offset, sections[s].data(), sections[s].size());
+            }
+        }
+        return result;
+    }
+};
+
+class SnapshotReader {
+private:
+    const MappedFile& file;
+    const std::string& path;
+    const SnapshotHeader* header = nullptr;
+    std::span<const StringRecord> strings;
+    std::span<const char> stringData;
+
+public:
+    SnapshotReader(const MappedFile& mapped, const std::string& filePath) : file(mapped), path(filePath) {
+        if (file.size() < sizeof(SnapshotHeader)) {
+            throw FileException(path, "файл меньше заголовка снимка");
+        }
+        header = reinterpret_cast<const SnapshotHeader*>(file.data());
+        if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            throw FileException(path, "неверная сигнатура снимка");
+        }
+        if (header->version != BinarySnapshot::VERSION) {
+            throw FileException(path, "неподдерживаемая версия снимка " + std::to_string(header->version));
+        }
+        if (header->fileSize != file.size()) {
+            throw FileException(path, "размер файла не совпадает с заголовком");
+        }
+        strings = section<StringRecord>(StringTable);
+        stringData = section<char>(StringData);
+    }
+
+    template <typename T>
+    std::span<const T> section(Section id) const {
+        const SectionEntry& entry = header->sections[id];
+        if (entry.offset % SECTION_ALIGNMENT != 0 || entry.offset > file.size() ||
+            entry.count > (file.size() - entry.offset) / sizeof(T)) {
+            throw FileException(path, "секция " + std::to_string(id) + " выходит за границы файла");
+        }
+        return {reinterpret_cast<const T*>(file.data() + entry.offset), static_cast<size_t>(entry.count)};
+    }
+
+    std::string string(uint32_t id) const {
+        if (id >= strings.size() || strings[id].offset > stringData.size() ||
+            strings[id].length > stringData.size() - strings[id].offset) {
+            throw FileException(path, "неверная ссылка на строку");
+        }
+        return std::string(stringData.data() + strings[id].offset, strings[id].length);
+    }
+
+    void check(bool condition, const std::string& what) const {
+        if (!condition) {
+            throw FileException(path, what);
+        }
+    }
+};
+
+std::shared_ptr<Vehicle> createVehicle(const std::string& type, const std::string& model,
+                                       const std::string& licensePlate) {
+    if (type == "Автобус") return std::make_shared<Bus>(model, licensePlate);
+    if (type == "Трамвай") return std::make_shared<Tram>(model, licensePlate);
+    if (type == "Троллейбус") return std::make_shared<Trolleybus>(model, licensePlate);
+    throw InputException("Неизвестный тип транспорта: " + type);
+}
+
+} // namespace
+
+std::string BinarySnapshot::serialize(const NetworkState& state) {
+    SnapshotWriter writer;
+
+    for (const auto& stop : state.stops) {
+        writer.append(StopsSection, StopRecord{stop.getId(), writer.string(stop.getName())});
+    }
+
+    // Рейсы могут ссылаться на объекты, которых нет в общих списках (так их создает
+    // загрузка из текста), поэтому такие объекты дописываются в конец секций
+    std::unordered_map<const Vehicle*, uint32_t> vehicleIds;
+    auto addVehicle = [&](const std::shared_ptr<Vehicle>& vehicle) {
+        auto [it, inserted] = vehicleIds.emplace(vehicle.get(), static_cast<uint32_t>(vehicleIds.size()));
+        if (inserted) {
+            writer.append(VehiclesSection, VehicleRecord{writer.string(vehicle->getType()),
+                                                         writer.string(vehicle->getModel()),
+                                                         writer.string(vehicle->getLicensePlate())});
+        }
+        return it->second;
+    };
+    std::unordered_map<const Driver*, uint32_t> driverIds;
+    auto addDriver = [&](const std::shared_ptr<Driver>& driver) {
+        auto [it, inserted] = driverIds.emplace(driver.get(), static_cast<uint32_t>(driverIds.size()));
+        if (inserted) {
+            writer.append(DriversSection, DriverRecord{writer.string(driver->getFirstName()),
+                                                       writer.string(driver->getLastName()),
+                                                       writer.string(driver->getMiddleName()),
+                                                       writer.string(driver->getCategory())});
+        }
+        return it->second;
+    };
+    std::unordered_map<const Route*, uint32_t> routeIds;
+    uint32_t routeStopCount = 0;
+    auto addRoute = [&](const std::shared_ptr<Route>& route, bool registered) {
+        auto [it, inserted] = routeIds.emplace(route.get(), static_cast<uint32_t>(routeIds.size()));
+        if (inserted) {
+            uint32_t mask = 0;
+            for (int day : route->getWeekDays()) {
+                mask |= 1u << day;
+            }
+            const auto& routeStops = route->getAllStops();
+            writer.append(RoutesSection, RouteRecord{route->getNumber(), writer.string(route->getVehicleType()),
+                                                     routeStopCount, static_cast<uint32_t>(routeStops.size()),
+                                                     mask, registered ? 1u : 0u});
+            for (const auto& stopName : routeStops) {
+                writer.append(RouteStopsSection, writer.string(stopName));
+            }
+            routeStopCount += static_cast<uint32_t>(routeStops.size());
+        }
+        return it->second;
+    };
+
+    for (const auto& vehicle : state.vehicles) addVehicle(vehicle);
+    for (const auto& driver : state.drivers) addDriver(driver);
+    for (const auto& route : state.routes) addRoute(route, true);
+
+    uint32_t stopTimeCount = 0;
+    for (const auto& trip : state.trips) {
+        const auto& schedule = trip->getSchedule();
+        writer.append(TripsSection, TripRecord{trip->getTripId(), addRoute(trip->getRoute(), false),
+                                               addVehicle(trip->getVehicle()),
+                                               trip->getDriver() ? static_cast<int32_t>(addDriver(trip->getDriver())) : -1,
+                                               trip->getStartTime().getTotalMinutes(), trip->getWeekDay(),
+                                               stopTimeCount, static_cast<uint32_t>(schedule.size())});
+        for (const auto& [stopName, time] : schedule) {
+            writer.append(StopTimesSection, StopTimeRecord{writer.string(stopName), time.getTotalMinutes()});
+        }
+        stopTimeCount += static_cast<uint32_t>(schedule.size());
+    }
+
+    const auto& transfers = state.transferNetwork;
+    for (const auto& [stopId, minutes] : transfers.getMinTransferTimes()) {
+        writer.append(TransfersSection, TransferRecord{stopId, minutes});
+    }
+    for (const auto& footpath : transfers.getFootpaths()) {
+        writer.append(FootpathsSection, FootpathRecord{footpath.fromStopId, footpath.toStopId, footpath.minutes});
+    }
+
+    // Индекс строится по тому же списку рейсов, поэтому номера рейсов в перегонах
+    // совпадают с порядком секции Trips
+    TimetableIndex builtIndex;
+    if (!state.timetableIndex) {
+        builtIndex.build(state.trips, state.stops, state.transferNetwork);
+    }
+    const TimetableIndex& index = state.timetableIndex ? *state.timetableIndex : builtIndex;
+    for (const auto& name : index.getStopNames()) {
+        writer.append(IndexStopsSection, writer.string(name));
+    }
+    writer.appendAll(ConnectionsSection, index.getConnections());
+
+    return writer.finish();
+}
+
+void BinarySnapshot::load(TransportSystem& system, const std::string& path) {
+    auto mapped = std::make_shared<const MappedFile>(path);
+    SnapshotReader reader(*mapped, path);
+
+    auto stopRecords = reader.section<StopRecord>(StopsSection);
+    auto vehicleRecords = reader.section<VehicleRecord>(VehiclesSection);
+    auto driverRecords = reader.section<DriverRecord>(DriversSection);
+    auto routeRecords = reader.section<RouteRecord>(RoutesSection);
+    auto routeStops = reader.section<uint32_t>(RouteStopsSection);
+    auto tripRecords = reader.section<TripRecord>(TripsSection);
+    auto stopTimes = reader.section<StopTimeRecord>(StopTimesSection);
+    auto transferRecords = reader.section<TransferRecord>(TransfersSection);
+    auto footpathRecords = reader.section<FootpathRecord>(FootpathsSection);
+    auto indexStops = reader.section<uint32_t>(IndexStopsSection);
+    auto connections = reader.section<Connection>(ConnectionsSection);
+
+    // Сначала все объекты собираются отдельно: при ошибке в файле система не меняется
+    std::vector<Stop> stops;
+    stops.reserve(stopRecords.size());
+    for (const auto& r : stopRecords) {
+        stops.emplace_back(r.id, reader.string(r.name));
+    }
+
+    std::vector<std::shared_ptr<Vehicle>> vehicles;
+    vehicles.reserve(vehicleRecords.size());
+    for (const auto& r : vehicleRecords) {
+        vehicles.push_back(createVehicle(reader.string(r.type), reader.string(r.model),
+                                         reader.string(r.licensePlate)));
+    }
+
+    std::vector<std::shared_ptr<Driver>> drivers;
+    drivers.reserve(driverRecords.size());
+    for (const auto& r : driverRecords) {
+        drivers.push_back(std::make_shared<Driver>(reader.string(r.firstName), reader.string(r.lastName),
+                                                   reader.string(r.middleName), reader.string(r.category)));
+    }
+
+    std::vector<std::shared_ptr<Route>> routes;
+    routes.reserve(routeRecords.size());
+    for (const auto& r : routeRecords) {
+        reader.check(r.firstStop <= routeStops.size() && r.stopCount <= routeStops.size() - r.firstStop,
+                     "неверный список остановок маршрута " + std::to_string(r.number));
+        std::vector<std::string> routeStopNames;
+        routeStopNames.reserve(r.stopCount);
+        for (uint32_t i = 0; i < r.stopCount; ++i) {
+            routeStopNames.push_back(reader.string(routeStops[r.firstStop + i]));
+        }
+        std::set<int> days;
+        for (int day = 1; day <= 7; ++day) {
+            if (r.weekDayMask & (1u << day)) {
+                days.insert(day);
+            }
+        }
+        routes.push_back(std::make_shared<Route>(r.number, reader.string(r.vehicleType), routeStopNames, days));
+    }
+
+    std::vector<std::shared_ptr<Trip>> trips;
+    trips.reserve(tripRecords.size());
+    for (const auto& r : tripRecords) {
+        reader.check(r.route < routes.size() && r.vehicle < vehicles.size() &&
+                     r.driver >= -1 && r.driver < static_cast<int32_t>(drivers.size()),
+                     "неверные ссылки рейса " + std::to_string(r.id));
+        reader.check(r.firstStopTime <= stopTimes.size() && r.stopTimeCount <= stopTimes.size() - r.firstStopTime,
+                     "неверное расписание рейса " + std::to_string(r.id));
+        auto trip = std::make_shared<Trip>(r.id, routes[r.route], vehicles[r.vehicle],
+                                           r.driver >= 0 ? drivers[r.driver] : nullptr,
+                                           Time(0, r.startMinutes), r.weekDay);
+        for (uint32_t i = 0; i < r.stopTimeCount; ++i) {
+            const StopTimeRecord& stopTime = stopTimes[r.firstStopTime + i];
+            trip->setArrivalTime(reader.string(stopTime.stop), Time(0, stopTime.minutes));
+        }
+        trip->shareSchedule();
+        trips.push_back(std::move(trip));
+    }
+
+    for (const auto& r : footpathRecords) {
+        reader.check(r.minutes >= 0 && r.fromStopId != r.toStopId, "неверный пеший переход");
+    }
+    for (const auto& r : transferRecords) {
+        reader.check(r.minutes >= 0, "неверное время пересадки");
+    }
+
+    std::vector<std::string> indexStopNames;
+    indexStopNames.reserve(indexStops.size());
+    for (uint32_t nameId : indexStops) {
+        indexStopNames.push_back(reader.string(nameId));
+    }
+    for (const auto& c : connections) {
+        reader.check(c.fromStop >= 0 && c.fromStop < static_cast<int>(indexStops.size()) &&
+                     c.toStop >= 0 && c.toStop < static_cast<int>(indexStops.size()) &&
+                     c.trip >= 0 && c.trip < static_cast<int>(trips.size()),
+                     "неверный перегон в индексе расписания");
+    }
+
+    // Файл корректен - переносим данные в систему
+    for (const auto& stop : stops) system.addStopDirect(stop);
+    for (const auto& vehicle : vehicles) system.addVehicleDirect(vehicle);
+    for (const auto& driver : drivers) system.addDriverDirect(driver);
+    for (size_t i = 0; i < routes.size(); ++i) {
+        if (routeRecords[i].registered) {
+            system.addRouteDirect(routes[i]);
+        }
+    }
+    for (const auto& trip : trips) system.addTripDirect(trip);
+    for (const auto& r : transferRecords) system.setMinTransferTime(r.stopId, r.minutes);
+    for (const auto& r : footpathRecords) system.addFootpath(r.fromStopId, r.toStopId, r.minutes);
+
+    TimetableIndex index;
+    index.adopt(system.getTrips(), system.getStops(), system.getTransferNetwork(),
+                indexStopNames, connections, mapped);
+    system.installTimetableIndex(std::move(index));
+}
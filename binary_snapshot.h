@@ -0,0 +1,29 @@
+#ifndef BINARY_SNAPSHOT_H
+#define BINARY_SNAPSHOT_H
+
+#include <string>
+#include <cstdint>
+
+class TransportSystem;
+struct NetworkState;
+
+// Бинарный снимок транспортной сети (network.bin).
+// Все записи имеют фиксированный размер и лежат в секциях, выровненных по 8 байт,
+// поэтому при загрузке файл отображается в память и читается напрямую, без разбора текста.
+// Вместе с данными сохраняется готовый индекс перегонов (TimetableIndex), который
+// после загрузки используется прямо из отображенного файла.
+// Числа хранятся в порядке байт той платформы, на которой снимок записан.
+class BinarySnapshot {
+public:
+    static const uint32_t VERSION = 1;
+
+    // Содержимое файла снимка (записывается на диск вызывающим)
+    static std::string serialize(const NetworkState& state);
+
+    // Загружает снимок в пустую систему. Перед изменением системы проверяются
+    // заголовок, границы секций и все ссылки между записями; при ошибке
+    // бросается FileException, а система остается нетронутой
+    static void load(TransportSystem& system, const std::string& path);
+};
+
+#endif // BINARY_SNAPSHOT_H
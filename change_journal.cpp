@@ -0,0 +1,217 @@
+#include "change_journal.h"
+#include "exceptions.h"
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+int openForAppend(const std::string& path, bool truncate) {
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY | (truncate ? _O_TRUNC : 0),
+                 _S_IREAD | _S_IWRITE);
+}
+bool writeAll(int fd, const char* data, size_t size) {
+    return _write(fd, data, static_cast<unsigned int>(size)) == static_cast<int>(size);
+}
+bool syncToDisk(int fd) {
+    return _commit(fd) == 0;
+}
+void closeDescriptor(int fd) {
+    _close(fd);
+}
+#else
+int openForAppend(const std::string& path, bool truncate) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0), 0644);
+}
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+bool syncToDisk(int fd) {
+    return ::fsync(fd) == 0;
+}
+void closeDescriptor(int fd) {
+    ::close(fd);
+}
+#endif
+
+} // namespace
+
+ChangeJournal::ChangeJournal(std::string journalPath) : path(std::move(journalPath)) {}
+
+ChangeJournal::~ChangeJournal() {
+    close();
+}
+
+std::vector<std::string> ChangeJournal::readRecords() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return readRecordsUnlocked();
+}
+
+std::vector<std::string> ChangeJournal::readRecordsUnlocked() const {
+    std::vector<std::string> result;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return result;
+    }
+
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t position = 0;
+    while (position < content.size()) {
+        size_t end = content.find('\n', position);
+        if (end == std::string::npos) {
+            break;
+        }
+        if (end > position) {
+            result.emplace_back(content, position, end - position);
+        }
+        position = end + 1;
+    }
+    return result;
+}
+
+void ChangeJournal::open() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (descriptor != -1) {
+        return;
+    }
+    records = readRecordsUnlocked().size();
+
+    // Оборванная запись отрезается, иначе следующая запись склеилась бы с ней
+    std::error_code error;
+    if (std::filesystem::exists(path, error)) {
+        std::ifstream file(path, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        size_t lastNewline = content.rfind('\n');
+        size_t validLength = lastNewline == std::string::npos ? 0 : lastNewline + 1;
+        if (validLength < content.size()) {
+            std::filesystem::resize_file(path, validLength, error);
+            if (error) {
+                throw FileException(path, "восстановление журнала изменений");
+            }
+        }
+    }
+
+    descriptor = openForAppend(path, false);
+    if (descriptor == -1) {
+        throw FileException(path, "открытие журнала изменений");
+    }
+}
+
+bool ChangeJournal::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return descriptor != -1;
+}
+
+void ChangeJournal::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closeUnlocked();
+}
+
+void ChangeJournal::closeUnlocked() {
+    if (descriptor != -1) {
+        closeDescriptor(descriptor);
+        descriptor = -1;
+    }
+}
+
+void ChangeJournal::append(const std::string& record) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (descriptor == -1) {
+        throw FileException(path, "запись в закрытый журнал изменений");
+    }
+    if (record.find('\n') != std::string::npos) {
+        throw InputException("Запись журнала не может содержать перевод строки");
+    }
+
+    std::string line = record + '\n';
+    if (!writeAll(descriptor, line.data(), line.size()) || !syncToDisk(descriptor)) {
+        throw FileException(path, "запись в журнал изменений");
+    }
+    records++;
+}
+
+void ChangeJournal::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool wasOpen = descriptor != -1;
+    closeUnlocked();
+    int fd = openForAppend(path, true);
+    if (fd == -1 || !syncToDisk(fd)) {
+        if (fd != -1) {
+            closeDescriptor(fd);
+        }
+        throw FileException(path, "очистка журнала изменений");
+    }
+    records = 0;
+    if (wasOpen) {
+        descriptor = fd;
+    } else {
+        closeDescriptor(fd);
+    }
+}
+
+void ChangeJournal::discardFirst(size_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> kept = readRecordsUnlocked();
+    kept.erase(kept.begin(), kept.begin() + static_cast<std::ptrdiff_t>(std::min(count, kept.size())));
+
+    std::string content;
+    for (const auto& record : kept) {
+        content += record;
+        content += '\n';
+    }
+
+    // Оставшиеся записи пишутся в новый файл, который затем заменяет журнал
+    const std::string tempPath = path + ".tmp";
+    int fd = openForAppend(tempPath, true);
+    bool ok = fd != -1 && writeAll(fd, content.data(), content.size()) && syncToDisk(fd);
+    if (fd != -1) {
+        closeDescriptor(fd);
+    }
+    if (!ok) {
+        throw FileException(tempPath, "усечение журнала изменений");
+    }
+
+    bool wasOpen = descriptor != -1;
+    closeUnlocked();
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        throw FileException(path, "усечение журнала изменений");
+    }
+    records = kept.size();
+    if (wasOpen) {
+        descriptor = openForAppend(path, false);
+        if (descriptor == -1) {
+            throw FileException(path, "открытие журнала изменений");
+        }
+    }
+}
+
+size_t ChangeJournal::recordCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return records;
+}
+
+const std::string& ChangeJournal::getPath() const {
+    return path;
+}
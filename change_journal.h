@@ -0,0 +1,50 @@
+#ifndef CHANGE_JOURNAL_H
+#define CHANGE_JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <mutex>
+
+// Журнал изменений: файл, в который только дописываются строки-записи.
+// Каждая запись сбрасывается на диск (fsync) до возврата из append,
+// поэтому подтвержденное изменение переживает аварийное завершение программы.
+// Методы можно вызывать из разных потоков (дописывание и усечение после фонового сохранения).
+class ChangeJournal {
+private:
+    std::string path;
+    int descriptor = -1;
+    size_t records = 0;
+    mutable std::mutex mutex;
+
+    std::vector<std::string> readRecordsUnlocked() const;
+    void closeUnlocked();
+
+public:
+    explicit ChangeJournal(std::string journalPath);
+    ~ChangeJournal();
+
+    ChangeJournal(const ChangeJournal&) = delete;
+    ChangeJournal& operator=(const ChangeJournal&) = delete;
+
+    // Записи, уже лежащие в файле. Оборванная при сбое последняя строка
+    // (без завершающего перевода строки) не возвращается
+    std::vector<std::string> readRecords() const;
+
+    // Открытие для дописывания; число записей берется из файла
+    void open();
+    bool isOpen() const;
+    void close();
+
+    void append(const std::string& record);
+    // Очистка после того, как все изменения вошли в полное сохранение
+    void reset();
+    // Удаляет первые count записей (они вошли в полное сохранение), сохраняя
+    // записи, дописанные позже. Файл заменяется атомарно
+    void discardFirst(size_t count);
+
+    size_t recordCount() const;
+    const std::string& getPath() const;
+};
+
+#endif // CHANGE_JOURNAL_H
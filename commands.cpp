@@ -1,6 +1,26 @@
 #include "commands.h"
 #include "transport_system.h"
 
+void StopTransferRules::capture(const TransportSystem& system, int stopId) {
+    const TransferNetwork& transfers = system.getTransferNetwork();
+    minTransferMinutes = transfers.getMinTransferTime(stopId);
+    footpaths.clear();
+    for (const auto& footpath : transfers.getFootpaths()) {
+        if (footpath.fromStopId == stopId || footpath.toStopId == stopId) {
+            footpaths.push_back(footpath);
+        }
+    }
+}
+
+void StopTransferRules::restore(TransportSystem& system, int stopId) const {
+    if (minTransferMinutes > 0) {
+        system.setMinTransferTime(stopId, minTransferMinutes);
+    }
+    for (const auto& footpath : footpaths) {
+        system.addFootpath(footpath.fromStopId, footpath.toStopId, footpath.minutes);
+    }
+}
+
 AddRouteCommand::AddRouteCommand(TransportSystem* sys, std::shared_ptr<Route> r)
     : system(sys), route(r) {}
 
@@ -105,9 +125,11 @@ AddStopCommand::AddStopCommand(TransportSystem* sys, const Stop& s)
 
 void AddStopCommand::execute() {
     system->addStopDirect(stop);
+    rules.restore(*system, stop.getId());
 }
 
 void AddStopCommand::undo() {
+    rules.capture(*system, stop.getId());
     system->removeStopDirect(stop.getId());
 }
 
@@ -120,11 +142,13 @@ RemoveStopCommand::RemoveStopCommand(TransportSystem* sys, int id)
 
 void RemoveStopCommand::execute() {
     stop = system->getStopById(stopId);
+    rules.capture(*system, stopId);
     system->removeStopDirect(stopId);
 }
 
 void RemoveStopCommand::undo() {
     system->addStopDirect(stop);
+    rules.restore(*system, stopId);
 }
 
 std::string RemoveStopCommand::getDescription() const {
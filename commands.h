@@ -7,9 +7,21 @@
 #include "vehicle.h"
 #include "stop.h"
 #include "driver.h"
+#include "transfer_network.h"
+#include <vector>
 
 class TransportSystem;
 
+// Время пересадки и пешеходные переходы остановки: удаляются вместе с ней
+// и возвращаются, когда остановка возвращается отменой или повтором команды
+struct StopTransferRules {
+    int minTransferMinutes = 0;
+    std::vector<Footpath> footpaths;
+
+    void capture(const TransportSystem& system, int stopId);
+    void restore(TransportSystem& system, int stopId) const;
+};
+
 class AddRouteCommand : public Command {
 private:
     TransportSystem* system;
@@ -89,6 +101,7 @@ class AddStopCommand : public Command {
 private:
     TransportSystem* system;
     Stop stop;
+    StopTransferRules rules; // заданные до отмены добавления
 
 public:
     AddStopCommand(TransportSystem* sys, const Stop& s);
@@ -102,6 +115,7 @@ private:
     TransportSystem* system;
     Stop stop;
     int stopId;
+    StopTransferRules rules;
 
 public:
     RemoveStopCommand(TransportSystem* sys, int id);
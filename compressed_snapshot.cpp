@@ -0,0 +1,580 @@
+#include "compressed_snapshot.h"
+#include "transport_system.h"
+#include "network_state.h"
+#include "bus.h"
+#include "tram.h"
+#include "trolleybus.h"
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <algorithm>
+#include <set>
+
+namespace {
+
+const char ARCHIVE_MAGIC[4] = {'T', 'N', 'S', 'Z'};
+const size_t CHECKSUM_BYTES = sizeof(uint64_t);
+const int NO_TIME = Trip::NO_STOP_TIME;
+
+uint64_t checksum(std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+class Encoder {
+private:
+    std::string out;
+
+public:
+    void unsignedValue(uint64_t value) {
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    // zigzag: небольшие по модулю отрицательные числа тоже занимают один байт
+    void signedValue(int64_t value) {
+        unsignedValue((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void raw(std::string_view bytes) {
+        out.append(bytes);
+    }
+
+    // Столбец возрастающих в основном чисел: первое значение, затем разности
+    void deltaColumn(const std::vector<int64_t>& values) {
+        int64_t previous = 0;
+        for (int64_t value : values) {
+            signedValue(value - previous);
+            previous = value;
+        }
+    }
+
+    void column(const std::vector<uint32_t>& values) {
+        for (uint32_t value : values) {
+            unsignedValue(value);
+        }
+    }
+
+    std::string& data() {
+        return out;
+    }
+};
+
+class Decoder {
+private:
+    const unsigned char* position;
+    const unsigned char* end;
+    const std::string& path;
+
+public:
+    Decoder(std::string_view data, const std::string& filePath)
+        : position(reinterpret_cast<const unsigned char*>(data.data())),
+          end(reinterpret_cast<const unsigned char*>(data.data()) + data.size()), path(filePath) {}
+
+    uint64_t unsignedValue() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position == end) {
+                throw FileException(path, "архив обрезан");
+            }
+            unsigned char byte = *position++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw FileException(path, "неверное число в архиве");
+    }
+
+    int64_t signedValue() {
+        uint64_t value = unsignedValue();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    uint32_t index(size_t limit, const char* what) {
+        uint64_t value = unsignedValue();
+        check(value < limit, what);
+        return static_cast<uint32_t>(value);
+    }
+
+    int32_t intValue() {
+        int64_t value = signedValue();
+        check(value >= INT32_MIN && value <= INT32_MAX, "число вне диапазона");
+        return static_cast<int32_t>(value);
+    }
+
+    // Каждый элемент занимает хотя бы байт, поэтому большее число - признак порчи файла
+    size_t count() {
+        uint64_t value = unsignedValue();
+        check(value <= static_cast<uint64_t>(end - position), "неверное число записей");
+        return static_cast<size_t>(value);
+    }
+
+    std::string_view raw(size_t size) {
+        check(size <= static_cast<size_t>(end - position), "архив обрезан");
+        std::string_view result(reinterpret_cast<const char*>(position), size);
+        position += size;
+        return result;
+    }
+
+    std::vector<int32_t> deltaColumn(size_t count) {
+        std::vector<int32_t> values(count);
+        int64_t previous = 0;
+        for (auto& value : values) {
+            previous += signedValue();
+            check(previous >= INT32_MIN && previous <= INT32_MAX, "число вне диапазона");
+            value = static_cast<int32_t>(previous);
+        }
+        return values;
+    }
+
+    std::vector<uint32_t> column(size_t count, size_t limit, const char* what) {
+        std::vector<uint32_t> values(count);
+        for (auto& value : values) {
+            value = index(limit, what);
+        }
+        return values;
+    }
+
+    bool finished() const {
+        return position == end;
+    }
+
+    void check(bool condition, const std::string& what) const {
+        if (!condition) {
+            throw FileException(path, what);
+        }
+    }
+};
+
+// Словарь строк в порядке первого использования
+class StringDictionary {
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<const std::string*> values;
+
+public:
+    uint32_t id(const std::string& value) {
+        auto [it, inserted] = ids.emplace(value, static_cast<uint32_t>(values.size()));
+        if (inserted) {
+            values.push_back(&it->first);
+        }
+        return it->second;
+    }
+
+    void write(Encoder& encoder) const {
+        encoder.unsignedValue(values.size());
+        for (const auto* value : values) {
+            encoder.unsignedValue(value->size());
+        }
+        for (const auto* value : values) {
+            encoder.raw(*value);
+        }
+    }
+};
+
+std::shared_ptr<Vehicle> createVehicle(const std::string& type, const std::string& model,
+                                       const std::string& licensePlate) {
+    if (type == "Автобус") return std::make_shared<Bus>(model, licensePlate);
+    if (type == "Трамвай") return std::make_shared<Tram>(model, licensePlate);
+    if (type == "Троллейбус") return std::make_shared<Trolleybus>(model, licensePlate);
+    throw InputException("Неизвестный тип транспорта: " + type);
+}
+
+} // namespace
+
+std::string CompressedSnapshot::serialize(const NetworkState& state) {
+    StringDictionary strings;
+
+    std::vector<int64_t> stopIds;
+    std::vector<uint32_t> stopNames;
+    for (const auto& stop : state.stops) {
+        stopIds.push_back(stop.getId());
+        stopNames.push_back(strings.id(stop.getName()));
+    }
+
+    // Рейсы могут ссылаться на объекты вне общих списков - они дописываются в конец столбцов
+    std::unordered_map<const Vehicle*, uint32_t> vehicleIds;
+    std::vector<uint32_t> vehicleColumns[3];
+    auto addVehicle = [&](const std::shared_ptr<Vehicle>& vehicle) {
+        auto [it, inserted] = vehicleIds.emplace(vehicle.get(), static_cast<uint32_t>(vehicleIds.size()));
+        if (inserted) {
+            vehicleColumns[0].push_back(strings.id(vehicle->getType()));
+            vehicleColumns[1].push_back(strings.id(vehicle->getModel()));
+            vehicleColumns[2].push_back(strings.id(vehicle->getLicensePlate()));
+        }
+        return it->second;
+    };
+    std::unordered_map<const Driver*, uint32_t> driverIds;
+    std::vector<uint32_t> driverColumns[4];
+    auto addDriver = [&](const std::shared_ptr<Driver>& driver) {
+        auto [it, inserted] = driverIds.emplace(driver.get(), static_cast<uint32_t>(driverIds.size()));
+        if (inserted) {
+            driverColumns[0].push_back(strings.id(driver->getFirstName()));
+            driverColumns[1].push_back(strings.id(driver->getLastName()));
+            driverColumns[2].push_back(strings.id(driver->getMiddleName()));
+            driverColumns[3].push_back(strings.id(driver->getCategory()));
+        }
+        return it->second;
+    };
+
+    // Последовательности остановок маршрутов без повторов
+    std::unordered_map<std::string, uint32_t> patternIds;
+    std::vector<uint32_t> patternLengths;
+    std::vector<uint32_t> patternStops;
+    std::unordered_map<const Route*, uint32_t> routeIds;
+    std::vector<int64_t> routeNumbers;
+    std::vector<uint32_t> routeTypes, routePatterns, routeDays, routeRegistered;
+    auto addRoute = [&](const std::shared_ptr<Route>& route, bool registered) {
+        auto [it, inserted] = routeIds.emplace(route.get(), static_cast<uint32_t>(routeIds.size()));
+        if (inserted) {
+            std::string key;
+            std::vector<uint32_t> stopsOfRoute;
+            for (const auto& name : route->getAllStops()) {
+                uint32_t id = strings.id(name);
+                stopsOfRoute.push_back(id);
+                key.append(reinterpret_cast<const char*>(&id), sizeof(id));
+            }
+            auto [pattern, newPattern] = patternIds.emplace(key, static_cast<uint32_t>(patternLengths.size()));
+            if (newPattern) {
+                patternLengths.push_back(static_cast<uint32_t>(stopsOfRoute.size()));
+                patternStops.insert(patternStops.end(), stopsOfRoute.begin(), stopsOfRoute.end());
+            }
+            uint32_t mask = 0;
+            for (int day : route->getWeekDays()) {
+                mask |= 1u << day;
+            }
+            routeNumbers.push_back(route->getNumber());
+            routeTypes.push_back(strings.id(route->getVehicleType()));
+            routePatterns.push_back(pattern->second);
+            routeDays.push_back(mask);
+            routeRegistered.push_back(registered ? 1u : 0u);
+        }
+        return it->second;
+    };
+
+    for (const auto& vehicle : state.vehicles) addVehicle(vehicle);
+    for (const auto& driver : state.drivers) addDriver(driver);
+    for (const auto& route : state.routes) addRoute(route, true);
+
+    // Шаблоны расписаний: смещения от отправления по остановкам маршрута.
+    // Значение в шаблоне - zigzag-разность с предыдущим заданным смещением плюс 1, 0 - нет времени
+    std::unordered_map<std::string, uint32_t> templateIds;
+    std::vector<uint32_t> templateLengths;
+    Encoder templateValues;
+    std::vector<int64_t> tripIds;
+    std::vector<uint32_t> tripRoutes, tripVehicles, tripDrivers, tripStarts, tripDays, tripTemplates, tripExtraCounts;
+    Encoder extras;
+    std::vector<int> minutes;
+    for (const auto& trip : state.trips) {
+        const auto& routeStops = trip->getRoute()->getAllStops();
+        const int start = trip->getStartTime().getTotalMinutes();
+        trip->getRouteStopMinutes(minutes);
+
+        Encoder shape;
+        int previous = 0;
+        for (size_t s = 0; s < routeStops.size(); ++s) {
+            if (minutes[s] == Trip::NO_STOP_TIME) {
+                shape.unsignedValue(0);
+                continue;
+            }
+            int offset = minutes[s] - start;
+            int64_t delta = offset - previous;
+            shape.unsignedValue(((static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63)) + 1);
+            previous = offset;
+        }
+        auto [shapeIt, newShape] = templateIds.emplace(shape.data(), static_cast<uint32_t>(templateLengths.size()));
+        if (newShape) {
+            templateLengths.push_back(static_cast<uint32_t>(routeStops.size()));
+            templateValues.raw(shape.data());
+        }
+
+        // Время на остановках, которых нет в маршруте (оно бывает только среди отличий от шаблона)
+        uint32_t extraCount = 0;
+        std::unordered_set<std::string_view> onRoute(routeStops.begin(), routeStops.end());
+        for (const auto& [name, time] : trip->getScheduleExceptions()) {
+            if (!onRoute.count(name)) {
+                extras.unsignedValue(strings.id(name));
+                extras.unsignedValue(static_cast<uint64_t>(time.getTotalMinutes()));
+                extraCount++;
+            }
+        }
+
+        tripIds.push_back(trip->getTripId());
+        tripRoutes.push_back(addRoute(trip->getRoute(), false));
+        tripVehicles.push_back(addVehicle(trip->getVehicle()));
+        tripDrivers.push_back(trip->getDriver() ? addDriver(trip->getDriver()) + 1 : 0);
+        tripStarts.push_back(static_cast<uint32_t>(start));
+        tripDays.push_back(static_cast<uint32_t>(trip->getWeekDay()));
+        tripTemplates.push_back(shapeIt->second);
+        tripExtraCounts.push_back(extraCount);
+    }
+
+    std::vector<std::pair<int, int>> transfers(state.transferNetwork.getMinTransferTimes().begin(),
+                                               state.transferNetwork.getMinTransferTimes().end());
+    std::sort(transfers.begin(), transfers.end());
+
+    Encoder out;
+    out.raw(std::string_view(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)));
+    out.unsignedValue(VERSION);
+    strings.write(out);
+
+    out.unsignedValue(stopIds.size());
+    out.deltaColumn(stopIds);
+    out.column(stopNames);
+
+    out.unsignedValue(vehicleColumns[0].size());
+    for (const auto& column : vehicleColumns) out.column(column);
+    out.unsignedValue(driverColumns[0].size());
+    for (const auto& column : driverColumns) out.column(column);
+
+    out.unsignedValue(patternLengths.size());
+    out.column(patternLengths);
+    out.column(patternStops);
+    out.unsignedValue(routeNumbers.size());
+    out.deltaColumn(routeNumbers);
+    out.column(routeTypes);
+    out.column(routePatterns);
+    out.column(routeDays);
+    out.column(routeRegistered);
+
+    out.unsignedValue(templateLengths.size());
+    out.column(templateLengths);
+    out.raw(templateValues.data());
+
+    out.unsignedValue(tripIds.size());
+    out.deltaColumn(tripIds);
+    out.column(tripRoutes);
+    out.column(tripVehicles);
+    out.column(tripDrivers);
+    out.column(tripStarts);
+    out.column(tripDays);
+    out.column(tripTemplates);
+    out.column(tripExtraCounts);
+    out.raw(extras.data());
+
+    out.unsignedValue(transfers.size());
+    for (const auto& [stopId, minutes] : transfers) {
+        out.signedValue(stopId);
+        out.unsignedValue(static_cast<uint64_t>(minutes));
+    }
+    const auto& footpaths = state.transferNetwork.getFootpaths();
+    out.unsignedValue(footpaths.size());
+    for (const auto& footpath : footpaths) {
+        out.signedValue(footpath.fromStopId);
+        out.signedValue(footpath.toStopId - static_cast<int64_t>(footpath.fromStopId));
+        out.unsignedValue(static_cast<uint64_t>(footpath.minutes));
+    }
+
+    uint64_t sum = checksum(out.data());
+    out.raw(std::string_view(reinterpret_cast<const char*>(&sum), sizeof(sum)));
+    return std::move(out.data());
+}
+
+void CompressedSnapshot::load(TransportSystem& system, const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw FileException(path, "открытие архива");
+    }
+    const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (content.size() < sizeof(ARCHIVE_MAGIC) + CHECKSUM_BYTES ||
+        std::memcmp(content.data(), ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0) {
+        throw FileException(path, "неверная сигнатура архива");
+    }
+    std::string_view body(content.data(), content.size() - CHECKSUM_BYTES);
+    uint64_t storedSum;
+    std::memcpy(&storedSum, content.data() + body.size(), sizeof(storedSum));
+    if (checksum(body) != storedSum) {
+        throw FileException(path, "контрольная сумма архива не совпадает");
+    }
+
+    Decoder in(body.substr(sizeof(ARCHIVE_MAGIC)), path);
+    uint64_t version = in.unsignedValue();
+    in.check(version == VERSION, "неподдерживаемая версия архива " + std::to_string(version));
+
+    std::vector<std::string> strings(in.count());
+    std::vector<size_t> lengths(strings.size());
+    for (auto& length : lengths) {
+        length = in.count();
+    }
+    for (size_t i = 0; i < strings.size(); ++i) {
+        strings[i] = std::string(in.raw(lengths[i]));
+    }
+    const size_t stringCount = strings.size();
+
+    // Сначала все объекты собираются отдельно: при ошибке в файле система не меняется
+    std::vector<Stop> stops;
+    {
+        size_t count = in.count();
+        auto ids = in.deltaColumn(count);
+        auto names = in.column(count, stringCount, "неверная ссылка на строку");
+        stops.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            stops.emplace_back(ids[i], strings[names[i]]);
+        }
+    }
+
+    std::vector<std::shared_ptr<Vehicle>> vehicles;
+    {
+        size_t count = in.count();
+        auto types = in.column(count, stringCount, "неверная ссылка на строку");
+        auto models = in.column(count, stringCount, "неверная ссылка на строку");
+        auto plates = in.column(count, stringCount, "неверная ссылка на строку");
+        for (size_t i = 0; i < count; ++i) {
+            vehicles.push_back(createVehicle(strings[types[i]], strings[models[i]], strings[plates[i]]));
+        }
+    }
+
+    std::vector<std::shared_ptr<Driver>> drivers;
+    {
+        size_t count = in.count();
+        std::vector<uint32_t> columns[4];
+        for (auto& column : columns) {
+            column = in.column(count, stringCount, "неверная ссылка на строку");
+        }
+        for (size_t i = 0; i < count; ++i) {
+            drivers.push_back(std::make_shared<Driver>(strings[columns[0][i]], strings[columns[1][i]],
+                                                       strings[columns[2][i]], strings[columns[3][i]]));
+        }
+    }
+
+    std::vector<std::vector<std::string>> patterns(in.count());
+    {
+        std::vector<size_t> patternLengths(patterns.size());
+        for (auto& length : patternLengths) {
+            length = in.count();
+        }
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            patterns[p].reserve(patternLengths[p]);
+            for (size_t i = 0; i < patternLengths[p]; ++i) {
+                patterns[p].push_back(strings[in.index(stringCount, "неверная ссылка на строку")]);
+            }
+        }
+    }
+
+    std::vector<std::shared_ptr<Route>> routes;
+    std::vector<uint32_t> routeRegistered;
+    {
+        size_t count = in.count();
+        auto numbers = in.deltaColumn(count);
+        auto types = in.column(count, stringCount, "неверная ссылка на строку");
+        auto routePatterns = in.column(count, patterns.size(), "неверная ссылка на список остановок");
+        auto days = in.column(count, 256, "неверные дни маршрута");
+        routeRegistered = in.column(count, 2, "неверный признак маршрута");
+        for (size_t i = 0; i < count; ++i) {
+            in.check(!patterns[routePatterns[i]].empty(), "пустой маршрут " + std::to_string(numbers[i]));
+            std::set<int> weekDays;
+            for (int day = 1; day <= 7; ++day) {
+                if (days[i] & (1u << day)) {
+                    weekDays.insert(day);
+                }
+            }
+            routes.push_back(std::make_shared<Route>(numbers[i], strings[types[i]], patterns[routePatterns[i]], weekDays));
+        }
+    }
+
+    // Шаблоны раскрываются в смещения один раз
+    std::vector<std::vector<int>> templates(in.count());
+    {
+        std::vector<size_t> templateLengths(templates.size());
+        for (auto& length : templateLengths) {
+            length = in.count();
+        }
+        for (size_t t = 0; t < templates.size(); ++t) {
+            templates[t].reserve(templateLengths[t]);
+            int previous = 0;
+            for (size_t i = 0; i < templateLengths[t]; ++i) {
+                uint64_t value = in.unsignedValue();
+                if (value == 0) {
+                    templates[t].push_back(NO_TIME);
+                    continue;
+                }
+                value -= 1;
+                previous += static_cast<int>(static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+                templates[t].push_back(previous);
+            }
+        }
+    }
+
+    std::vector<std::shared_ptr<Trip>> trips;
+    {
+        size_t count = in.count();
+        auto ids = in.deltaColumn(count);
+        auto tripRoutes = in.column(count, routes.size(), "неверная ссылка рейса на маршрут");
+        auto tripVehicles = in.column(count, vehicles.size(), "неверная ссылка рейса на транспорт");
+        auto tripDrivers = in.column(count, drivers.size() + 1, "неверная ссылка рейса на водителя");
+        auto starts = in.column(count, 24 * 60, "неверное время отправления");
+        auto days = in.column(count, 8, "неверный день рейса");
+        auto tripTemplates = in.column(count, templates.size(), "неверная ссылка на шаблон расписания");
+        auto extraCounts = in.column(count, body.size(), "неверное число записей");
+        trips.reserve(count);
+        // Шаблон архива становится общим массивом смещений рейсов (смещения приводятся к суткам)
+        std::vector<std::shared_ptr<const std::vector<int>>> sharedTemplates(templates.size());
+        for (size_t i = 0; i < count; ++i) {
+            const auto& route = routes[tripRoutes[i]];
+            const auto& routeStops = route->getAllStops();
+            const auto& offsets = templates[tripTemplates[i]];
+            in.check(offsets.size() == routeStops.size() && days[i] >= 1,
+                     "шаблон расписания не подходит к маршруту рейса " + std::to_string(ids[i]));
+
+            const int start = static_cast<int>(starts[i]);
+            auto trip = std::make_shared<Trip>(ids[i], route, vehicles[tripVehicles[i]],
+                                               tripDrivers[i] ? drivers[tripDrivers[i] - 1] : nullptr,
+                                               Time(0, start), static_cast<int>(days[i]));
+            auto& shared = sharedTemplates[tripTemplates[i]];
+            if (!shared) {
+                std::vector<int> normalized(offsets.size());
+                for (size_t s = 0; s < offsets.size(); ++s) {
+                    normalized[s] = offsets[s] == NO_TIME ? NO_TIME : (offsets[s] % 1440 + 1440) % 1440;
+                }
+                shared = Trip::shareOffsets(std::move(normalized));
+            }
+            trip->setScheduleOffsets(shared);
+            trips.push_back(std::move(trip));
+        }
+        for (size_t i = 0; i < count; ++i) {
+            for (uint32_t e = 0; e < extraCounts[i]; ++e) {
+                const std::string& name = strings[in.index(stringCount, "неверная ссылка на строку")];
+                trips[i]->setArrivalTime(name, Time(0, static_cast<int>(in.index(24 * 60, "неверное время"))));
+            }
+        }
+    }
+
+    std::vector<std::pair<int, int>> transfers(in.count());
+    for (auto& [stopId, minutes] : transfers) {
+        stopId = in.intValue();
+        minutes = static_cast<int>(in.index(INT32_MAX, "неверное время пересадки"));
+    }
+    std::vector<Footpath> footpaths(in.count());
+    for (auto& footpath : footpaths) {
+        footpath.fromStopId = in.intValue();
+        footpath.toStopId = footpath.fromStopId + in.intValue();
+        footpath.minutes = static_cast<int>(in.index(INT32_MAX, "неверный пеший переход"));
+        in.check(footpath.fromStopId != footpath.toStopId, "неверный пеший переход");
+    }
+    in.check(in.finished(), "лишние данные в конце архива");
+
+    // Файл корректен - переносим данные в систему
+    for (const auto& stop : stops) system.addStopDirect(stop);
+    for (const auto& vehicle : vehicles) system.addVehicleDirect(vehicle);
+    for (const auto& driver : drivers) system.addDriverDirect(driver);
+    for (size_t i = 0; i < routes.size(); ++i) {
+        if (routeRegistered[i]) {
+            system.addRouteDirect(routes[i]);
+        }
+    }
+    for (const auto& trip : trips) system.addTripDirect(trip);
+    for (const auto& [stopId, minutes] : transfers) system.setMinTransferTime(stopId, minutes);
+    for (const auto& footpath : footpaths) system.addFootpath(footpath.fromStopId, footpath.toStopId, footpath.minutes);
+}
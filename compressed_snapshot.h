@@ -0,0 +1,33 @@
+#ifndef COMPRESSED_SNAPSHOT_H
+#define COMPRESSED_SNAPSHOT_H
+
+#include <string>
+#include <cstdint>
+
+class TransportSystem;
+struct NetworkState;
+
+// Сжатый снимок сети для архива версий расписания (*.tnc).
+// В отличие от network.bin рассчитан на минимальный размер, а не на отображение в память:
+//  - все числа записываются как varint, знаковые - в zigzag-кодировке;
+//  - записи хранятся по столбцам (все номера, затем все ссылки и т.д.),
+//    возрастающие идентификаторы - разностями с предыдущим значением;
+//  - строки (названия остановок, типы, ФИО) хранятся один раз в словаре и адресуются номером;
+//  - одинаковые последовательности остановок маршрутов хранятся один раз;
+//  - расписание рейса записывается как шаблон смещений от времени отправления
+//    по порядку остановок маршрута (разностями соседних времен), одинаковые шаблоны
+//    хранятся один раз. Время на остановках вне маршрута записывается отдельно.
+// Индекс перегонов в архив не входит и строится при первом поиске.
+// Файл заканчивается контрольной суммой FNV-1a содержимого.
+class CompressedSnapshot {
+public:
+    static const uint32_t VERSION = 1;
+
+    static std::string serialize(const NetworkState& state);
+
+    // Загружает архив в пустую систему. При повреждении файла бросается FileException,
+    // а система остается нетронутой
+    static void load(TransportSystem& system, const std::string& path);
+};
+
+#endif // COMPRESSED_SNAPSHOT_H
@@ -9,118 +9,740 @@
 #include "route.h"
 #include "trip.h"
 #include "exceptions.h"
+#include "binary_snapshot.h"
+#include "compressed_snapshot.h"
+#include "mapped_file.h"
+#include "text_parser.h"
+#include "save_transaction.h"
+#include "lazy_trip_store.h"
+#include "segment_table.h"
 #include <fstream>
-#include <sstream>
+#include <chrono>
+#include <string_view>
+#include <unordered_set>
+#include <map>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <charconv>
 
-DataManager::DataManager(const std::string& dir) : dataDirectory(dir) {
+namespace {
+
+// Ключ водителя для проверки дубликатов: ФИО без категории
+std::string driverKey(const std::string& firstName, const std::string& lastName, const std::string& middleName) {
+    return firstName + '|' + lastName + '|' + middleName;
+}
+
+// Маршрут из полной строки рейса совпадает с маршрутом системы
+bool sameRoute(const Route& a, const Route& b) {
+    return a.getNumber() == b.getNumber() && a.getVehicleType() == b.getVehicleType() &&
+           a.getAllStops() == b.getAllStops() && a.getWeekDays() == b.getWeekDays();
+}
+
+// Транспорт из строки vehicles.txt: тип|модель|госномер[|вместимость|питание]
+std::shared_ptr<Vehicle> parseVehicle(std::string_view line) {
+    FieldTokenizer fields(line, '|');
+    std::string_view typeField, modelField, plateField;
+    fields.next(typeField);
+    fields.next(modelField);
+    // Дальше могут идти вместимость и тип питания - номер заканчивается на '|'
+    fields.next(plateField);
+    std::string model(modelField), licensePlate(plateField);
+
+    if (typeField == "Автобус") {
+        return std::make_shared<Bus>(model, licensePlate);
+    } else if (typeField == "Трамвай") {
+        return std::make_shared<Tram>(model, licensePlate);
+    } else if (typeField == "Троллейбус") {
+        return std::make_shared<Trolleybus>(model, licensePlate);
+    }
+    throw InputException("Неизвестный тип транспорта: " + std::string(typeField));
+}
+
+// Смещения и размеры в trips.idx могут не помещаться в int
+size_t parseSizeField(std::string_view field) {
+    field = trimField(field);
+    size_t value = 0;
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    if (error != std::errc() || end != field.data() + field.size() || field.empty()) {
+        throw InputException("Неверное число: " + std::string(field));
+    }
+    return value;
+}
+
+} // namespace
+
+TripLinker::TripLinker(TransportSystem& sys) : system(sys) {
+    for (const auto& route : system.getRoutes()) {
+        routesByNumber.emplace(route->getNumber(), route);
+    }
+    for (const auto& vehicle : system.getVehicles()) {
+        vehiclesByPlate.emplace(vehicle->getLicensePlate(), vehicle);
+    }
+    for (const auto& driver : system.getDrivers()) {
+        driversByName.emplace(driverKey(driver->getFirstName(), driver->getLastName(), driver->getMiddleName()),
+                              driver);
+    }
+}
+
+std::shared_ptr<Trip> TripLinker::link(ParsedTrip& parsed) {
+    // Нормализованная строка только ссылается на объекты системы и ничего не создает
+    if (parsed.byReference) {
+        auto routeIt = routesByNumber.find(parsed.routeNumber);
+        Trip::resolveRoute(parsed, routeIt != routesByNumber.end() ? routeIt->second : nullptr);
+    } else {
+        // Полная строка несет свою копию маршрута; совпадающий маршрут системы используется вместо нее
+        auto routeIt = routesByNumber.find(parsed.route->getNumber());
+        if (routeIt != routesByNumber.end() && sameRoute(*routeIt->second, *parsed.route)) {
+            parsed.route = routeIt->second;
+        }
+    }
+
+    std::shared_ptr<Vehicle> vehicle;
+    auto vehicleIt = vehiclesByPlate.find(parsed.licensePlate);
+    if (vehicleIt != vehiclesByPlate.end()) {
+        vehicle = vehicleIt->second;
+    } else if ((vehicle = Trip::createVehicle(parsed))) {
+        system.addVehicleDirect(vehicle);
+        vehiclesByPlate.emplace(parsed.licensePlate, vehicle);
+    }
+
+    std::string key = driverKey(parsed.driverFirstName, parsed.driverLastName, parsed.driverMiddleName);
+    auto driverIt = driversByName.find(key);
+    std::shared_ptr<Driver> driver;
+    if (driverIt != driversByName.end()) {
+        driver = driverIt->second;
+    } else if (parsed.byReference) {
+        throw ContainerException("Водитель " + parsed.driverLastName + " " +
+                                 parsed.driverFirstName + " не найден в системе");
+    } else {
+        driver = std::make_shared<Driver>(parsed.driverFirstName, parsed.driverLastName,
+                                          parsed.driverMiddleName, parsed.driverCategory);
+        system.addDriverDirect(driver);
+        driversByName.emplace(std::move(key), driver);
+    }
+
+    return Trip::fromParsed(parsed, vehicle, driver);
+}
+
+void TripLinker::rememberRoute(const std::shared_ptr<Route>& route) {
+    routesByNumber[route->getNumber()] = route;
+}
+
+void TripLinker::forgetRoute(int routeNumber) {
+    routesByNumber.erase(routeNumber);
+}
+
+void TripLinker::rememberVehicle(const std::shared_ptr<Vehicle>& vehicle) {
+    vehiclesByPlate[vehicle->getLicensePlate()] = vehicle;
+}
+
+void TripLinker::forgetVehicle(const std::string& licensePlate) {
+    vehiclesByPlate.erase(licensePlate);
+}
+
+void TripLinker::rememberDriver(const std::shared_ptr<Driver>& driver) {
+    driversByName[driverKey(driver->getFirstName(), driver->getLastName(), driver->getMiddleName())] = driver;
+}
+
+void TripLinker::forgetDriver(const Driver& driver) {
+    driversByName.erase(driverKey(driver.getFirstName(), driver.getLastName(), driver.getMiddleName()));
+}
+
+DataManager::DataManager(const std::string& dir)
+    : dataDirectory(dir), journal(dir + "journal.txt"),
+      watcher(dir, {"stops.txt", "vehicles.txt", "drivers.txt", "routes.txt", "trips.txt", "admins.bin",
+                    "transfers.txt", "footpaths.txt", "segments.txt", "network.bin", SaveTransaction::MANIFEST_NAME}),
+      saver([this](const NetworkState& state) { return writeState(state); }) {
     std::filesystem::create_directories(dataDirectory);
 }
 
-void DataManager::saveAllData(TransportSystem& system) {
+void DataManager::setLoadThreads(int threads) {
+    loadThreadCount = threads;
+}
+
+void DataManager::setLazyTripLoading(bool enabled) {
+    lazyTripLoading = enabled;
+}
+
+const std::string& DataManager::getDataDirectory() const {
+    return dataDirectory;
+}
+
+void DataManager::startWatching(std::chrono::milliseconds pollInterval, std::function<void()> onChange) {
+    watcher.start(pollInterval, std::move(onChange));
+}
+
+void DataManager::stopWatching() {
+    watcher.stop();
+}
+
+bool DataManager::isWatching() const {
+    return watcher.isRunning();
+}
+
+void DataManager::requestReload() {
+    watcher.trigger();
+}
+
+size_t DataManager::journalRecordCount() const {
+    return journal.isOpen() ? journal.recordCount() : journal.readRecords().size();
+}
+
+size_t DataManager::commitWatched(SaveTransaction& transaction) {
+    // Собственная запись не должна выглядеть для наблюдения как замена файлов извне
+    watcher.pause();
+    size_t bytes = 0;
+    try {
+        bytes = transaction.commit();
+    } catch (...) {
+        watcher.resume();
+        throw;
+    }
+    watcher.resume();
+    return bytes;
+}
+
+SaveStats DataManager::writeState(const NetworkState& state) {
+    auto start = std::chrono::steady_clock::now();
+
+    SaveTransaction transaction(dataDirectory);
+    saveStops(state, transaction.file("stops.txt"));
+    saveVehicles(state, transaction.file("vehicles.txt"));
+    saveDrivers(state, transaction.file("drivers.txt"));
+    saveRoutes(state, transaction.file("routes.txt"));
+    std::string tripsIndex;
+    saveTrips(state, transaction.file("trips.txt"), &tripsIndex);
+    transaction.file("trips.idx") = std::move(tripsIndex);
+    saveAdminCredentials(state, transaction.file("admins.bin"));
+    saveTransfers(state, transaction.file("transfers.txt"));
+    saveFootpaths(state, transaction.file("footpaths.txt"));
+    // Снимок пишется последним, чтобы он не оказался старше текстовых файлов
+    saveSnapshot(state, transaction.file("network.bin"));
+
+    SaveStats stats;
+    stats.bytes = commitWatched(transaction);
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats.generation = SaveTransaction::currentGeneration(dataDirectory);
+    return stats;
+}
+
+void DataManager::requestSave(TransportSystem& system) {
+    // После записи из журнала удаляются только записи, вошедшие в копию;
+    // изменения, сделанные во время записи, остаются в журнале
+    std::function<void()> onSuccess;
+    if (journal.isOpen()) {
+        size_t covered = journal.recordCount();
+        onSuccess = [this, covered] { journal.discardFirst(covered); };
+    }
+    saver.request(system.captureState(), std::move(onSuccess));
+}
+
+bool DataManager::saveAllData(TransportSystem& system) {
+    std::cout << "Сохранение данных в файлы...\n";
+    requestSave(system);
+    saver.wait();
+    reportSaveStatus();
+    return saver.getStatus().state == SaveState::Succeeded;
+}
+
+void DataManager::saveChanges(TransportSystem& system) {
+    if (!journalEnabled) {
+        saveAllData(system);
+        return;
+    }
+    reportSaveStatus();
+    if (!journal.isOpen() || journal.recordCount() >= JOURNAL_COMPACTION_RECORDS) {
+        requestSave(system);
+        std::cout << "Сохранение данных выполняется в фоновом режиме.\n";
+        return;
+    }
+    std::cout << "Изменения уже записаны в журнал (записей: " << journal.recordCount() << ").\n";
+}
+
+void DataManager::compact(TransportSystem& system) {
+    // Пока идет запись, система не меняется, поэтому после успешного сохранения
+    // недоступный ранее журнал можно начать заново
+    if (!saveAllData(system) || journal.isOpen() || !journalEnabled) {
+        return;
+    }
     try {
-        std::cout << "Сохранение данных в файлы...\n";
+        journal.reset();
+        journal.open();
+    } catch (const std::exception& e) {
+        std::cout << "Ошибка журнала изменений: " << e.what() << "\n";
+        journal.close();
+    }
+}
+
+void DataManager::reportSaveStatus() {
+    SaveStatus status = saver.getStatus();
+    if (status.completed == reportedSaves) {
+        return;
+    }
+    reportedSaves = status.completed;
+
+    if (status.state == SaveState::Failed) {
+        std::cout << "Ошибка при сохранении данных: " << status.error << "\n";
+        return;
+    }
+    const SaveStats& stats = status.lastStats;
+    double megabytesPerSecond = stats.milliseconds > 0 ? stats.bytes / 1048576.0 / (stats.milliseconds / 1000.0) : 0.0;
+    std::cout << "Данные успешно сохранены! (" << (stats.bytes + 1023) / 1024 << " КБ за "
+              << static_cast<int>(stats.milliseconds + 0.5) << " мс, "
+              << static_cast<int>(megabytesPerSecond + 0.5) << " МБ/с)\n";
+}
+
+SaveStatus DataManager::getSaveStatus() const {
+    return saver.getStatus();
+}
+
+void DataManager::waitForSave() {
+    saver.wait();
+}
+
+std::string DataManager::archive(TransportSystem& system) {
+    namespace fs = std::filesystem;
+    const fs::path archiveDirectory = fs::path(dataDirectory) / "archive";
+    fs::create_directories(archiveDirectory);
+
+    // Файлы нумеруются по порядку: network-0001.tnc, network-0002.tnc, ...
+    int lastNumber = 0;
+    for (const auto& entry : fs::directory_iterator(archiveDirectory)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() == 16 && name.compare(0, 8, "network-") == 0 && name.compare(12, 4, ".tnc") == 0) {
+            try {
+                lastNumber = std::max(lastNumber, parseIntField(std::string_view(name).substr(8, 4)));
+            } catch (const InputException&) {
+            }
+        }
+    }
+    std::string number = std::to_string(lastNumber + 1);
+    number.insert(0, number.size() < 4 ? 4 - number.size() : 0, '0');
+    const fs::path path = archiveDirectory / ("network-" + number + ".tnc");
 
-        saveStops(system);
-        saveVehicles(system);
-        saveDrivers(system);
-        saveRoutes(system);
-        saveTrips(system);
-        saveAdminCredentials(system);
+    const std::string content = CompressedSnapshot::serialize(system.captureState());
+    const fs::path tmpPath = path.string() + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if (!file) {
+            throw FileException(tmpPath.string(), "запись архива");
+        }
+    }
+    fs::rename(tmpPath, path);
+    return path.string();
+}
 
-        std::cout << "Данные успешно сохранены!\n";
+void DataManager::loadArchive(TransportSystem& system, const std::string& path) {
+    if (!system.getStops().empty() || !system.getRoutes().empty() || !system.getTrips().empty()) {
+        throw ContainerException("Архив загружается только в пустую систему");
+    }
+    CompressedSnapshot::load(system, path);
+}
+
+void DataManager::suspendJournal() {
+    journal.close();
+}
+
+bool DataManager::isJournalOpen() const {
+    return journal.isOpen();
+}
+
+void DataManager::recordChange(TransportSystem& system, const std::string& record) {
+    if (!journal.isOpen()) {
+        return;
+    }
+    try {
+        journal.append(record);
     } catch (const std::exception& e) {
-        std::cout << "Ошибка при сохранении данных: " << e.what() << "\n";
+        // Изменение уже применено в памяти; оно попадет на диск при следующем полном сохранении
+        std::cout << "Ошибка журнала изменений: " << e.what()
+                  << ". Данные будут полностью перезаписаны при следующем сохранении.\n";
+        journal.close();
+        return;
+    }
+    // Пока идет предыдущая запись, новая не запрашивается: журнал просто растет
+    if (journal.recordCount() >= JOURNAL_COMPACTION_RECORDS && !saver.isBusy()) {
+        requestSave(system);
     }
 }
 
+void DataManager::recordChanges(TransportSystem& system, size_t count,
+                                const std::function<std::string(size_t)>& record) {
+    if (!journal.isOpen() || count == 0) {
+        return;
+    }
+    if (count < JOURNAL_COMPACTION_RECORDS) {
+        for (size_t i = 0; i < count && journal.isOpen(); ++i) {
+            recordChange(system, record(i));
+        }
+        return;
+    }
+    // Копия для сохранения уже содержит все изменения группы
+    requestSave(system);
+}
+
+size_t DataManager::replayJournal(TransportSystem& system) {
+    std::vector<std::string> records = journal.readRecords();
+    if (records.empty()) {
+        return 0;
+    }
+
+    FileLoadStats& stats = fileStats("journal.txt");
+    std::vector<std::pair<int, std::string>> badLines;
+    TripLinker linker(system);
+    for (size_t i = 0; i < records.size(); ++i) {
+        try {
+            applyJournalRecord(system, records[i], linker);
+            stats.loaded++;
+        } catch (const std::exception& e) {
+            badLines.emplace_back(static_cast<int>(i + 1), e.what());
+        }
+    }
+    stats.skipped = static_cast<int>(badLines.size());
+    reportBadLines("journal.txt", badLines);
+    return records.size();
+}
+
+void DataManager::applyJournalRecord(TransportSystem& system, const std::string& record, TripLinker& linker) {
+    FieldTokenizer fields(record, '|');
+    std::string_view operation;
+    fields.next(operation);
+    const std::string_view payload = fields.rest();
+
+    // Добавление заменяет запись с тем же ключом, удаление отсутствующей записи ничего не делает.
+    // Поэтому журнал можно применить и к состоянию, в которое часть записей уже вошла.
+    // Замененные и удаленные маршруты, транспорт и водители передаются в таблицы linker
+    if (operation == "+stop") {
+        // Правила пересадок остановки, уже вошедшей в файлы, удаляются вместе с ней и
+        // восстанавливаются записями, которые идут в журнале после ее добавления
+        Stop stop = Stop::deserialize(payload);
+        system.removeStopDirect(stop.getId());
+        system.addStopDirect(stop);
+    } else if (operation == "-stop") {
+        system.removeStopDirect(parseIntField(payload));
+    } else if (operation == "+route") {
+        auto route = Route::deserialize(payload);
+        system.removeRouteDirect(route->getNumber());
+        system.addRouteDirect(route);
+        linker.rememberRoute(route);
+    } else if (operation == "-route") {
+        int routeNumber = parseIntField(payload);
+        system.removeRouteDirect(routeNumber);
+        linker.forgetRoute(routeNumber);
+    } else if (operation == "+vehicle") {
+        auto vehicle = parseVehicle(payload);
+        system.removeVehicleDirect(vehicle->getLicensePlate());
+        system.addVehicleDirect(vehicle);
+        linker.rememberVehicle(vehicle);
+    } else if (operation == "-vehicle") {
+        std::string licensePlate(payload);
+        system.removeVehicleDirect(licensePlate);
+        linker.forgetVehicle(licensePlate);
+    } else if (operation == "+driver") {
+        auto driver = Driver::deserialize(payload);
+        if (auto existing = system.findDriverByName(driver->getFirstName(), driver->getLastName(),
+                                                    driver->getMiddleName())) {
+            system.removeDriverDirect(existing);
+        }
+        system.addDriverDirect(driver);
+        linker.rememberDriver(driver);
+    } else if (operation == "-driver") {
+        FieldTokenizer name(payload, '|');
+        std::string_view firstName, lastName, middleName;
+        name.next(firstName);
+        name.next(lastName);
+        name.next(middleName);
+        if (auto existing = system.findDriverByName(std::string(firstName), std::string(lastName),
+                                                    std::string(middleName))) {
+            system.removeDriverDirect(existing);
+            linker.forgetDriver(*existing);
+        }
+    } else if (operation == "+trip") {
+        auto trip = linkTrip(linker, payload);
+        system.removeTripDirect(trip->getTripId());
+        system.addTripDirect(trip);
+    } else if (operation == "-trip") {
+        system.removeTripDirect(parseIntField(payload));
+    } else if (operation == "transfer") {
+        FieldTokenizer values(payload, '|');
+        std::string_view stopIdField, minutesField;
+        values.next(stopIdField);
+        values.next(minutesField);
+        system.setMinTransferTime(parseIntField(stopIdField), parseIntField(minutesField));
+    } else if (operation == "footpath") {
+        FieldTokenizer values(payload, '|');
+        std::string_view fromField, toField, minutesField;
+        values.next(fromField);
+        values.next(toField);
+        values.next(minutesField);
+        system.addFootpath(parseIntField(fromField), parseIntField(toField), parseIntField(minutesField));
+    } else if (operation == "admin") {
+        FieldTokenizer values(payload, '|');
+        std::string_view username;
+        values.next(username);
+        system.addAdmin(std::string(username), std::string(values.rest()));
+    } else {
+        throw InputException("Неизвестная операция журнала: " + std::string(operation));
+    }
+}
+
+std::shared_ptr<Trip> DataManager::linkTrip(TripLinker& linker, std::string_view line) {
+    ParsedTrip parsed = Trip::parse(line, 2);
+    return linker.link(parsed);
+}
+
 void DataManager::loadAllData(TransportSystem& system) {
+    lastLoadSummary = LoadSummary();
+
+    try {
+        SaveTransaction::recover(dataDirectory);
+    } catch (const std::exception& e) {
+        std::cout << "Не удалось завершить прерванное сохранение: " << e.what() << "\n";
+    }
+
+    // Записи журнала применяются к полностью загруженным рейсам. Пока идет наблюдение за файлами,
+    // trips.txt может заменить кто угодно, поэтому рейсы тоже разбираются сразу
+    loadFiles(system, lazyTripLoading && !isWatching() && journal.readRecords().empty());
+    openJournal(system);
+    printLoadSummary();
+}
+
+size_t DataManager::loadForReload(TransportSystem& system) {
+    lastLoadSummary = LoadSummary();
+    // Прерванное сохранение не доводится до конца: его может выполнять работающая программа
+    loadFiles(system, false);
+    return replayJournal(system);
+}
+
+void DataManager::loadFiles(TransportSystem& system, bool allowLazyTrips) {
+    // Снимок содержит все рейсы, поэтому при загрузке по требованию читаются текстовые файлы и индекс
+    TripFileStamp tripsFileStamp;
+    std::unordered_map<int, LazyTripStore::RouteEntry> tripIndex;
+    bool lazyTrips = allowLazyTrips && readTripIndex(tripsFileStamp, tripIndex);
+
+    if (!lazyTrips && loadSnapshot(system)) {
+        lastLoadSummary.fromSnapshot = true;
+        lastLoadSummary.files = {
+            {"stops.txt", {static_cast<int>(system.getStops().size()), 0, 0}},
+            {"vehicles.txt", {static_cast<int>(system.getVehicles().size()), 0, 0}},
+            {"drivers.txt", {static_cast<int>(system.getDrivers().size()), 0, 0}},
+            {"routes.txt", {static_cast<int>(system.getRoutes().size()), 0, 0}},
+            {"trips.txt", {static_cast<int>(system.getTrips().size()), 0, 0}},
+        };
+        loadAdminCredentials(system);
+        // Таблицы перегонов в снимке нет
+        try {
+            loadSegments(system);
+        } catch (const std::exception& e) {
+            lastLoadSummary.error = e.what();
+        }
+        return;
+    }
+
     try {
         loadStops(system);
         loadVehicles(system);
         loadDrivers(system);
         loadRoutes(system);
-        loadTrips(system);
+        if (lazyTrips && installLazyTrips(system, tripsFileStamp, std::move(tripIndex))) {
+            lastLoadSummary.lazyTrips = true;
+        } else {
+            loadTrips(system);
+            if (tripsFileOutdated) {
+                upgradeTripsFile(system);
+            }
+        }
         loadAdminCredentials(system);
+        loadTransfers(system);
+        loadFootpaths(system);
+        loadSegments(system);
     } catch (const std::exception& e) {
-        // Ошибки обрабатываются в отдельных функциях загрузки
+        // Загрузка прерывается на первой ошибке; то, что успело загрузиться, остается
+        lastLoadSummary.error = e.what();
     }
 }
 
-void DataManager::saveStops(TransportSystem& system) {
-    std::ofstream file(dataDirectory + "stops.txt");
-    if (!file.is_open()) throw FileException("stops.txt", "открытие для записи");
-
-    const auto& stops = system.getStops();
-    for (const auto& stop : stops) {
-        file << stop.serialize() << "\n";
+void DataManager::openJournal(TransportSystem& system) {
+    // Записи журнала применяются до его открытия, поэтому сами в журнал не попадают
+    replayJournal(system);
+    journalEnabled = true;
+    try {
+        journal.open();
+    } catch (const std::exception& e) {
+        std::cout << "Ошибка журнала изменений: " << e.what()
+                  << ". Изменения будут сохраняться полной перезаписью файлов.\n";
     }
-    file.close();
 }
 
-void DataManager::saveVehicles(TransportSystem& system) {
-    std::ofstream file(dataDirectory + "vehicles.txt");
-    if (!file.is_open()) throw FileException("vehicles.txt", "открытие для записи");
+const LoadSummary& DataManager::getLastLoadSummary() const {
+    return lastLoadSummary;
+}
+
+
 
-    const auto& vehicles = system.getVehicles();
-    for (const auto& vehicle : vehicles) {
-        file << vehicle->serialize() << "\n";
+FileLoadStats& DataManager::fileStats(const std::string& fileName) {
+    for (auto& [name, stats] : lastLoadSummary.files) {
+        if (name == fileName) {
+            return stats;
+        }
     }
-    file.close();
+    lastLoadSummary.files.push_back({fileName, FileLoadStats()});
+    return lastLoadSummary.files.back().second;
 }
 
-void DataManager::saveDrivers(TransportSystem& system) {
-    std::ofstream file(dataDirectory + "drivers.txt");
-    if (!file.is_open()) throw FileException("drivers.txt", "открытие для записи");
+void DataManager::printLoadSummary() const {
+    if (lastLoadSummary.files.empty() && lastLoadSummary.error.empty()) {
+        return;
+    }
 
-    const auto& drivers = system.getDrivers();
-    for (const auto& driver : drivers) {
-        file << driver->serialize() << "\n";
+    std::cout << "Загрузка данных" << (lastLoadSummary.fromSnapshot ? " (из снимка network.bin)" : "")
+              << (lastLoadSummary.lazyTrips ? " (рейсы по требованию)" : "") << ":\n";
+    for (const auto& [name, stats] : lastLoadSummary.files) {
+        std::cout << "  " << name << ": загружено " << stats.loaded;
+        if (stats.duplicates > 0) {
+            std::cout << ", дубликатов пропущено " << stats.duplicates;
+        }
+        if (stats.skipped > 0) {
+            std::cout << ", строк пропущено " << stats.skipped;
+        }
+        std::cout << "\n";
+    }
+    if (!lastLoadSummary.error.empty()) {
+        std::cout << "  Загрузка прервана: " << lastLoadSummary.error << "\n";
     }
-    file.close();
 }
 
-void DataManager::saveRoutes(TransportSystem& system) {
-    std::ofstream file(dataDirectory + "routes.txt");
-    if (!file.is_open()) throw FileException("routes.txt", "открытие для записи");
+void DataManager::saveStops(const NetworkState& state, std::string& out) const {
+    for (const auto& stop : state.stops) {
+        out += stop.serialize();
+        out += '\n';
+    }
+}
 
-    const auto& routes = system.getRoutes();
-    for (const auto& route : routes) {
-        file << route->serialize() << "\n";
+void DataManager::saveVehicles(const NetworkState& state, std::string& out) const {
+    for (const auto& vehicle : state.vehicles) {
+        out += vehicle->serialize();
+        out += '\n';
     }
-    file.close();
 }
 
-void DataManager::saveTrips(TransportSystem& system) {
-    std::ofstream file(dataDirectory + "trips.txt");
-    if (!file.is_open()) throw FileException("trips.txt", "открытие для записи");
+void DataManager::saveDrivers(const NetworkState& state, std::string& out) const {
+    for (const auto& driver : state.drivers) {
+        out += driver->serialize();
+        out += '\n';
+    }
+}
 
-    const auto& trips = system.getTrips();
-    for (const auto& trip : trips) {
-        file << trip->serialize() << "\n";
+void DataManager::saveRoutes(const NetworkState& state, std::string& out) const {
+    for (const auto& route : state.routes) {
+        out += route->serialize();
+        out += '\n';
     }
-    file.close();
 }
 
-void DataManager::saveAdminCredentials(TransportSystem& system) {
-    std::ofstream file(dataDirectory + "admins.bin", std::ios::binary);
-    if (!file.is_open()) throw FileException("admins.bin", "открытие для записи");
+void DataManager::saveTrips(const NetworkState& state, std::string& out, std::string* index) const {
+    // Рейс ссылается на маршрут, транспорт и водителя по ключу, если они есть в системе.
+    // Остальные рейсы (например, на удаленный маршрут) пишутся полной строкой
+    std::unordered_map<int, const Route*> routesByNumber;
+    for (const auto& route : state.routes) {
+        routesByNumber.emplace(route->getNumber(), route.get());
+    }
+    std::unordered_map<std::string, const Vehicle*> vehiclesByPlate;
+    for (const auto& vehicle : state.vehicles) {
+        vehiclesByPlate.emplace(vehicle->getLicensePlate(), vehicle.get());
+    }
+    std::unordered_set<std::string> driverNames;
+    for (const auto& driver : state.drivers) {
+        driverNames.insert(driverKey(driver->getFirstName(), driver->getLastName(), driver->getMiddleName()));
+    }
 
-    const auto& creds = system.getAdminCredentials();
+    // Участки файла с рейсами каждого маршрута для trips.idx (подряд идущие строки объединяются)
+    std::map<int, std::pair<size_t, std::vector<TripFileRange>>> routeRanges;
+    std::unordered_set<int> tripIds;
+    bool indexable = true;
+
+    // Рейсы пишутся сгруппированными по маршрутам (с сохранением порядка внутри маршрута),
+    // чтобы рейсы маршрута занимали в файле один участок и индекс не рос с числом рейсов
+    std::vector<const Trip*> ordered;
+    ordered.reserve(state.trips.size());
+    for (const auto& trip : state.trips) {
+        ordered.push_back(trip.get());
+    }
+    std::stable_sort(ordered.begin(), ordered.end(), [](const Trip* a, const Trip* b) {
+        return a->getRoute()->getNumber() < b->getRoute()->getNumber();
+    });
+
+    out += TRIPS_FORMAT_HEADER;
+    out += '\n';
+    for (const Trip* trip : ordered) {
+        auto routeIt = routesByNumber.find(trip->getRoute()->getNumber());
+        auto vehicleIt = vehiclesByPlate.find(trip->getVehicle()->getLicensePlate());
+        const auto& driver = trip->getDriver();
+        std::string line;
+        if (routeIt != routesByNumber.end() && routeIt->second == trip->getRoute().get() &&
+            vehicleIt != vehiclesByPlate.end() && vehicleIt->second == trip->getVehicle().get() &&
+            driverNames.count(driverKey(driver->getFirstName(), driver->getLastName(), driver->getMiddleName()))) {
+            line = trip->serializeByReference();
+        }
+        if (line.empty()) {
+            // Полная строка может добавить транспорт и водителя в систему - ее нельзя отложить
+            indexable = false;
+            line = trip->serialize();
+        }
+        if (!tripIds.insert(trip->getTripId()).second) {
+            indexable = false;
+        }
+        if (index && indexable) {
+            auto& [count, ranges] = routeRanges[trip->getRoute()->getNumber()];
+            count++;
+            if (!ranges.empty() && ranges.back().offset + ranges.back().length == out.size()) {
+                ranges.back().length += line.size() + 1;
+            } else {
+                ranges.push_back({out.size(), line.size() + 1});
+            }
+        }
+        out += line;
+        out += '\n';
+    }
+
+    if (!index) {
+        return;
+    }
+    *index += TRIPS_INDEX_HEADER;
+    *index += '\n';
+    if (!indexable) {
+        *index += "unindexed\n";
+        return;
+    }
+    *index += std::to_string(out.size());
+    *index += '\n';
+    for (const auto& [routeNumber, entry] : routeRanges) {
+        *index += std::to_string(routeNumber) + "|" + std::to_string(entry.first) + "|";
+        for (size_t i = 0; i < entry.second.size(); ++i) {
+            if (i > 0) {
+                *index += ';';
+            }
+            *index += std::to_string(entry.second[i].offset) + ":" + std::to_string(entry.second[i].length);
+        }
+        *index += '\n';
+    }
+}
+
+void DataManager::saveAdminCredentials(const NetworkState& state, std::string& out) const {
+    const auto& creds = state.adminCredentials;
     size_t count = creds.size();
-    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.append(reinterpret_cast<const char*>(&count), sizeof(count));
 
     for (const auto& [username, password] : creds) {
         size_t usernameLen = username.size();
         size_t passwordLen = password.size();
-        file.write(reinterpret_cast<const char*>(&usernameLen), sizeof(usernameLen));
-        file.write(username.c_str(), usernameLen);
-        file.write(reinterpret_cast<const char*>(&passwordLen), sizeof(passwordLen));
-        file.write(password.c_str(), passwordLen);
+        out.append(reinterpret_cast<const char*>(&usernameLen), sizeof(usernameLen));
+        out.append(username);
+        out.append(reinterpret_cast<const char*>(&passwordLen), sizeof(passwordLen));
+        out.append(password);
     }
-    file.close();
 }
 
 void DataManager::loadStops(TransportSystem& system) {
@@ -129,26 +751,24 @@ void DataManager::loadStops(TransportSystem& system) {
         return;
     }
 
+    FileLoadStats& stats = fileStats("stops.txt");
+    std::unordered_set<int> knownIds;
+    for (const auto& stop : system.getStops()) {
+        knownIds.insert(stop.getId());
+    }
+
     std::string line;
     int lineNumber = 0;
-    int loadedCount = 0;
     while (std::getline(file, line)) {
         lineNumber++;
         if (!line.empty()) {
             try {
                 Stop stop = Stop::deserialize(line);
-                // Проверяем на дубликаты перед добавлением
-                bool exists = false;
-                const auto& existingStops = system.getStops();
-                for (const auto& existingStop : existingStops) {
-                    if (existingStop.getId() == stop.getId()) {
-                        exists = true;
-                        break;
-                    }
-                }
-                if (!exists) {
+                if (knownIds.insert(stop.getId()).second) {
                     system.addStopDirect(stop);
-                    loadedCount++;
+                    stats.loaded++;
+                } else {
+                    stats.duplicates++;
                 }
             } catch (const std::exception& e) {
                 throw FileException("stops.txt", "чтение строки " + std::to_string(lineNumber) + ": " + e.what());
@@ -167,43 +787,24 @@ void DataManager::loadVehicles(TransportSystem& system) {
         return;
     }
 
+    FileLoadStats& stats = fileStats("vehicles.txt");
+    std::unordered_set<std::string> knownPlates;
+    for (const auto& vehicle : system.getVehicles()) {
+        knownPlates.insert(vehicle->getLicensePlate());
+    }
+
     std::string line;
     int lineNumber = 0;
-    int loadedCount = 0;
     while (std::getline(file, line)) {
         lineNumber++;
         if (!line.empty()) {
             try {
-                std::istringstream ss(line);
-                std::string type, model, licensePlate;
-                std::getline(ss, type, '|');
-                std::getline(ss, model, '|');
-                std::getline(ss, licensePlate);
-
-                // Проверяем на дубликаты перед добавлением
-                bool exists = false;
-                const auto& existingVehicles = system.getVehicles();
-                for (const auto& existingVehicle : existingVehicles) {
-                    if (existingVehicle->getLicensePlate() == licensePlate) {
-                        exists = true;
-                        break;
-                    }
-                }
-                
-                if (!exists) {
-                    std::shared_ptr<Vehicle> vehicle;
-                    if (type == "Автобус") {
-                        vehicle = std::make_shared<Bus>(model, licensePlate);
-                    } else if (type == "Трамвай") {
-                        vehicle = std::make_shared<Tram>(model, licensePlate);
-                    } else if (type == "Троллейбус") {
-                        vehicle = std::make_shared<Trolleybus>(model, licensePlate);
-                    } else {
-                        throw InputException("Неизвестный тип транспорта: " + type);
-                    }
-
+                auto vehicle = parseVehicle(line);
+                if (knownPlates.insert(vehicle->getLicensePlate()).second) {
                     system.addVehicleDirect(vehicle);
-                    loadedCount++;
+                    stats.loaded++;
+                } else {
+                    stats.duplicates++;
                 }
             } catch (const std::exception& e) {
                 throw FileException("vehicles.txt", "чтение строки " + std::to_string(lineNumber) + ": " + e.what());
@@ -222,9 +823,14 @@ void DataManager::loadDrivers(TransportSystem& system) {
         return;
     }
 
+    FileLoadStats& stats = fileStats("drivers.txt");
+    std::unordered_set<std::string> knownNames;
+    for (const auto& driver : system.getDrivers()) {
+        knownNames.insert(driverKey(driver->getFirstName(), driver->getLastName(), driver->getMiddleName()));
+    }
+
     std::string line;
     int lineNumber = 0;
-    int loadedCount = 0;
     while (std::getline(file, line)) {
         lineNumber++;
         if (!line.empty()) {
@@ -232,14 +838,13 @@ void DataManager::loadDrivers(TransportSystem& system) {
                 // Проверяем, что строка не содержит данные транспорта (формат: тип|модель|номер)
                 // Водители должны быть в формате: имя|фамилия|отчество
                 // Если в строке есть цифры в первой части или формат не соответствует, пропускаем
-                std::istringstream testStream(line);
-                std::string firstPart, secondPart, thirdPart;
-                std::getline(testStream, firstPart, '|');
-                std::getline(testStream, secondPart, '|');
-                std::getline(testStream, thirdPart);
-                
+                FieldTokenizer fields(line, '|');
+                std::string_view firstPart;
+                fields.next(firstPart);
+
                 // Проверяем, что первая часть не является типом транспорта
                 if (firstPart == "Автобус" || firstPart == "Трамвай" || firstPart == "Троллейбус") {
+                    stats.skipped++;
                     continue;
                 }
                 
@@ -248,27 +853,21 @@ void DataManager::loadDrivers(TransportSystem& system) {
                 // Имена обычно начинаются с буквы и не содержат только цифры
                 if (firstPart.length() > 0 && std::isdigit(static_cast<unsigned char>(firstPart[0]))) {
                     // Начинается с цифры - похоже на номерной знак или ID, пропускаем
+                    stats.skipped++;
                     continue;
                 }
                 
                 auto driver = Driver::deserialize(line);
-                // Проверяем на дубликаты перед добавлением
-                bool exists = false;
-                const auto& existingDrivers = system.getDrivers();
-                for (const auto& existingDriver : existingDrivers) {
-                    if (existingDriver->getFirstName() == driver->getFirstName() &&
-                        existingDriver->getLastName() == driver->getLastName() &&
-                        existingDriver->getMiddleName() == driver->getMiddleName()) {
-                        exists = true;
-                        break;
-                    }
-                }
-                if (!exists) {
+                if (knownNames.insert(driverKey(driver->getFirstName(), driver->getLastName(),
+                                                driver->getMiddleName())).second) {
                     system.addDriverDirect(driver);
-                    loadedCount++;
+                    stats.loaded++;
+                } else {
+                    stats.duplicates++;
                 }
             } catch (const std::exception& e) {
-                // Не бросаем исключение, просто пропускаем неправильную строку
+                // Неправильная строка пропускается и учитывается в итогах загрузки
+                stats.skipped++;
                 continue;
             }
         }
@@ -285,26 +884,24 @@ void DataManager::loadRoutes(TransportSystem& system) {
         return;
     }
 
+    FileLoadStats& stats = fileStats("routes.txt");
+    std::unordered_set<int> knownNumbers;
+    for (const auto& route : system.getRoutes()) {
+        knownNumbers.insert(route->getNumber());
+    }
+
     std::string line;
     int lineNumber = 0;
-    int loadedCount = 0;
     while (std::getline(file, line)) {
         lineNumber++;
         if (!line.empty()) {
             try {
                 auto route = Route::deserialize(line);
-                // Проверяем на дубликаты перед добавлением
-                bool exists = false;
-                const auto& existingRoutes = system.getRoutes();
-                for (const auto& existingRoute : existingRoutes) {
-                    if (existingRoute->getNumber() == route->getNumber()) {
-                        exists = true;
-                        break;
-                    }
-                }
-                if (!exists) {
+                if (knownNumbers.insert(route->getNumber()).second) {
                     system.addRouteDirect(route);
-                    loadedCount++;
+                    stats.loaded++;
+                } else {
+                    stats.duplicates++;
                 }
             } catch (const std::exception& e) {
                 throw FileException("routes.txt", "чтение строки " + std::to_string(lineNumber) + ": " + e.what());
@@ -318,42 +915,238 @@ void DataManager::loadRoutes(TransportSystem& system) {
 }
 
 void DataManager::loadTrips(TransportSystem& system) {
-    std::ifstream file(dataDirectory + "trips.txt");
-    if (!file.is_open()) {
+    const std::string path = dataDirectory + "trips.txt";
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) {
         return;
     }
 
-    std::string line;
-    int lineNumber = 0;
-    int loadedCount = 0;
-    while (std::getline(file, line)) {
-        lineNumber++;
-        if (!line.empty()) {
+    MappedFile file(path);
+    std::string_view content(file.data() ? file.data() : "", file.size());
+
+    // Версия формата определяется по первой строке
+    int formatVersion = 1;
+    int headerLines = 0;
+    if (content.substr(0, TRIPS_FORMAT_HEADER.size()) == TRIPS_FORMAT_HEADER) {
+        formatVersion = 2;
+        headerLines = 1;
+        size_t newline = content.find('\n');
+        content.remove_prefix(newline == std::string_view::npos ? content.size() : newline + 1);
+    }
+
+    // Файл делится на куски по границам строк; маленькие файлы разбираются в одном потоке
+    int workers = loadThreadCount > 0 ? loadThreadCount : system.getScheduler().getWorkerCount() + 1;
+    size_t chunkCount = std::clamp<size_t>(content.size() / MIN_PARSE_CHUNK_BYTES, 1,
+                                           static_cast<size_t>(std::max(workers, 1)));
+    std::vector<size_t> chunkStart(chunkCount + 1, content.size());
+    chunkStart[0] = 0;
+    for (size_t c = 1; c < chunkCount; ++c) {
+        size_t newline = content.find('\n', content.size() * c / chunkCount);
+        chunkStart[c] = std::max(chunkStart[c - 1],
+                                 newline == std::string_view::npos ? content.size() : newline + 1);
+    }
+
+    // Разбор не трогает систему: каждая задача заполняет только свой результат
+    struct ChunkResult {
+        int lineCount = 0;
+        std::vector<std::pair<int, ParsedTrip>> trips;
+        std::vector<std::pair<int, std::string>> errors;
+    };
+    std::vector<ChunkResult> results(chunkCount);
+
+    auto parseChunk = [&](size_t c) {
+        ChunkResult& result = results[c];
+        size_t position = chunkStart[c];
+        while (position < chunkStart[c + 1]) {
+            size_t lineEnd = content.find('\n', position);
+            if (lineEnd == std::string_view::npos || lineEnd > chunkStart[c + 1]) {
+                lineEnd = chunkStart[c + 1];
+            }
+            std::string_view line = content.substr(position, lineEnd - position);
+            position = lineEnd + 1;
+            result.lineCount++;
+
+            if (line.empty()) {
+                continue;
+            }
             try {
-                auto trip = Trip::deserialize(line, &system);
-                // Проверяем на дубликаты перед добавлением
-                bool exists = false;
-                const auto& existingTrips = system.getTrips();
-                for (const auto& existingTrip : existingTrips) {
-                    if (existingTrip->getTripId() == trip->getTripId()) {
-                        exists = true;
-                        break;
-                    }
-                }
-                if (!exists) {
-                    system.addTripDirect(trip);
-                    loadedCount++;
-                }
+                result.trips.emplace_back(result.lineCount, Trip::parse(line, formatVersion));
             } catch (const std::exception& e) {
-                // Не бросаем исключение, просто пропускаем неправильную строку
+                result.errors.emplace_back(result.lineCount, e.what());
+            }
+        }
+    };
+
+    system.getScheduler().parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            parseChunk(c);
+        }
+    }, static_cast<int>(chunkCount));
+
+    FileLoadStats& stats = fileStats("trips.txt");
+
+    // Слияние в одном потоке в порядке строк файла
+    TripLinker linker(system);
+    std::unordered_set<int> tripIds;
+    for (const auto& trip : system.getTrips()) {
+        tripIds.insert(trip->getTripId());
+    }
+
+    std::vector<std::pair<int, std::string>> badLines;
+    int lineOffset = headerLines;
+    for (auto& result : results) {
+        auto error = result.errors.begin();
+        for (auto& [localLine, parsed] : result.trips) {
+            for (; error != result.errors.end() && error->first < localLine; ++error) {
+                badLines.emplace_back(lineOffset + error->first, error->second);
+            }
+
+            if (tripIds.count(parsed.tripId)) {
+                stats.duplicates++;
                 continue;
             }
+
+            try {
+                system.addTripDirect(linker.link(parsed));
+                tripIds.insert(parsed.tripId);
+                stats.loaded++;
+            } catch (const std::exception& e) {
+                badLines.emplace_back(lineOffset + localLine, e.what());
+            }
+        }
+        for (; error != result.errors.end(); ++error) {
+            badLines.emplace_back(lineOffset + error->first, error->second);
         }
+        lineOffset += result.lineCount;
     }
-    if (file.bad() && !file.eof()) {
-        throw FileException("trips.txt", "ошибка чтения файла");
+
+    stats.skipped = static_cast<int>(badLines.size());
+    // Старый файл переписывается только если он прочитан целиком, иначе строки с ошибками потерялись бы
+    tripsFileOutdated = formatVersion < 2 && stats.loaded > 0 && badLines.empty();
+    reportBadLines("trips.txt", badLines);
+}
+
+bool DataManager::readTripIndex(TripFileStamp& stamp, std::unordered_map<int, LazyTripStore::RouteEntry>& entries) const {
+    namespace fs = std::filesystem;
+    const fs::path tripsPath = dataDirectory + "trips.txt";
+    const fs::path indexPath = dataDirectory + "trips.idx";
+    std::error_code error;
+    if (!fs::exists(tripsPath, error) || !fs::exists(indexPath, error)) {
+        return false;
     }
-    file.close();
+    // trips.txt, измененный после индекса (например, вручную), читается полностью
+    auto indexTime = fs::last_write_time(indexPath, error);
+    if (error) {
+        return false;
+    }
+    auto tripsTime = fs::last_write_time(tripsPath, error);
+    if (error || tripsTime > indexTime) {
+        return false;
+    }
+    size_t actualSize = fs::file_size(tripsPath, error);
+    if (error) {
+        return false;
+    }
+
+    std::ifstream file(indexPath);
+    std::string line;
+    if (!std::getline(file, line) || line != TRIPS_INDEX_HEADER || !std::getline(file, line)) {
+        return false;
+    }
+    try {
+        // "unindexed" - в trips.txt есть полные строки, которые нельзя разобрать отдельно
+        if (line == "unindexed" || parseSizeField(line) != actualSize) {
+            return false;
+        }
+        stamp.size = actualSize;
+        stamp.modified = tripsTime;
+
+        while (std::getline(file, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            FieldTokenizer fields(line, '|');
+            std::string_view numberField, countField, rangesField;
+            if (!fields.next(numberField) || !fields.next(countField) || !fields.next(rangesField)) {
+                return false;
+            }
+            LazyTripStore::RouteEntry entry;
+            entry.tripCount = parseSizeField(countField);
+            FieldTokenizer ranges(rangesField, ';');
+            std::string_view rangeField;
+            while (ranges.next(rangeField)) {
+                size_t colon = rangeField.find(':');
+                if (colon == std::string_view::npos) {
+                    return false;
+                }
+                TripFileRange range{parseSizeField(rangeField.substr(0, colon)),
+                                    parseSizeField(rangeField.substr(colon + 1))};
+                if (range.offset + range.length > actualSize) {
+                    return false;
+                }
+                entry.ranges.push_back(range);
+            }
+            entries[parseIntField(numberField)] = std::move(entry);
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return !file.bad();
+}
+
+bool DataManager::installLazyTrips(TransportSystem& system, TripFileStamp stamp,
+                                   std::unordered_map<int, LazyTripStore::RouteEntry> entries) {
+    for (auto& [number, entry] : entries) {
+        entry.route = system.findRouteByNumber(number);
+        if (!entry.route) {
+            return false;
+        }
+    }
+    // Строки индекса ссылаются на маршруты, транспорт и водителей только по ключу,
+    // поэтому связывание не добавляет объектов в систему и может выполняться из любого потока
+    auto linker = std::make_shared<TripLinker>(system);
+    auto store = std::make_shared<LazyTripStore>(
+        dataDirectory + "trips.txt", stamp, std::move(entries),
+        [linker](ParsedTrip& parsed) { return linker->link(parsed); });
+    fileStats("trips.txt").loaded = static_cast<int>(store->tripCount());
+    system.installLazyTrips(std::move(store));
+    return true;
+}
+
+void DataManager::reportBadLines(const std::string& fileName, const std::vector<std::pair<int, std::string>>& badLines) {
+    if (badLines.empty()) {
+        return;
+    }
+    std::cout << fileName << ": пропущено строк с ошибками: " << badLines.size() << "\n";
+    for (size_t i = 0; i < badLines.size() && i < MAX_REPORTED_BAD_LINES; ++i) {
+        std::cout << "  строка " << badLines[i].first << ": " << badLines[i].second << "\n";
+    }
+    if (badLines.size() > MAX_REPORTED_BAD_LINES) {
+        std::cout << "  ... и еще " << (badLines.size() - MAX_REPORTED_BAD_LINES) << "\n";
+    }
+}
+
+void DataManager::upgradeTripsFile(TransportSystem& system) {
+    tripsFileOutdated = false;
+    const std::string path = dataDirectory + "trips.txt";
+    std::error_code error;
+    std::filesystem::copy_file(path, path + ".bak", std::filesystem::copy_options::overwrite_existing, error);
+    if (error) {
+        std::cout << "trips.txt: не удалось сохранить копию старого файла (" << error.message()
+                  << "), файл оставлен в старом формате\n";
+        return;
+    }
+    try {
+        SaveTransaction transaction(dataDirectory);
+        std::string tripsIndex;
+        saveTrips(system.captureState(), transaction.file("trips.txt"), &tripsIndex);
+        transaction.file("trips.idx") = std::move(tripsIndex);
+        commitWatched(transaction);
+    } catch (const std::exception& e) {
+        std::cout << "trips.txt: не удалось записать файл в новом формате (" << e.what() << ")\n";
+        return;
+    }
+    std::cout << "trips.txt преобразован в формат версии 2, старый файл сохранен как trips.txt.bak\n";
 }
 
 void DataManager::loadAdminCredentials(TransportSystem& system) {
@@ -381,3 +1174,149 @@ void DataManager::loadAdminCredentials(TransportSystem& system) {
     system.setAdminCredentials(creds);
 }
 
+
+void DataManager::saveTransfers(const NetworkState& state, std::string& out) const {
+    // Порядок строк не зависит от порядка хранения в хеш-таблице
+    std::vector<std::pair<int, int>> entries(state.transferNetwork.getMinTransferTimes().begin(),
+                                             state.transferNetwork.getMinTransferTimes().end());
+    std::sort(entries.begin(), entries.end());
+    for (const auto& [stopId, minutes] : entries) {
+        out += std::to_string(stopId) + "|" + std::to_string(minutes) + "\n";
+    }
+}
+
+void DataManager::saveFootpaths(const NetworkState& state, std::string& out) const {
+    for (const auto& footpath : state.transferNetwork.getFootpaths()) {
+        out += std::to_string(footpath.fromStopId) + "|" + std::to_string(footpath.toStopId) + "|" +
+               std::to_string(footpath.minutes) + "\n";
+    }
+}
+
+void DataManager::loadTransfers(TransportSystem& system) {
+    std::ifstream file(dataDirectory + "transfers.txt");
+    if (!file.is_open()) {
+        return;
+    }
+
+    FileLoadStats& stats = fileStats("transfers.txt");
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty()) {
+            try {
+                FieldTokenizer fields(line, '|');
+                std::string_view stopIdField, minutesField;
+                fields.next(stopIdField);
+                fields.next(minutesField);
+                system.setMinTransferTime(parseIntField(stopIdField), parseIntField(minutesField));
+                stats.loaded++;
+            } catch (const std::exception& e) {
+                throw FileException("transfers.txt", "чтение строки " + std::to_string(lineNumber) + ": " + e.what());
+            }
+        }
+    }
+    file.close();
+}
+
+void DataManager::loadFootpaths(TransportSystem& system) {
+    std::ifstream file(dataDirectory + "footpaths.txt");
+    if (!file.is_open()) {
+        return;
+    }
+
+    FileLoadStats& stats = fileStats("footpaths.txt");
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty()) {
+            try {
+                FieldTokenizer fields(line, '|');
+                std::string_view fromField, toField, minutesField;
+                fields.next(fromField);
+                fields.next(toField);
+                fields.next(minutesField);
+                // Повторно заданный переход заменяет прежний и считается дубликатом
+                size_t before = system.getTransferNetwork().getFootpaths().size();
+                system.addFootpath(parseIntField(fromField), parseIntField(toField), parseIntField(minutesField));
+                if (system.getTransferNetwork().getFootpaths().size() > before) {
+                    stats.loaded++;
+                } else {
+                    stats.duplicates++;
+                }
+            } catch (const std::exception& e) {
+                throw FileException("footpaths.txt", "чтение строки " + std::to_string(lineNumber) + ": " + e.what());
+            }
+        }
+    }
+    file.close();
+}
+
+void DataManager::loadSegments(TransportSystem& system) {
+    std::ifstream file(dataDirectory + "segments.txt");
+    if (!file.is_open()) {
+        return;
+    }
+
+    FileLoadStats& stats = fileStats("segments.txt");
+    auto table = std::make_shared<SegmentTable>();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!trimField(line).empty()) {
+            try {
+                if (table->parseLine(line)) {
+                    stats.loaded++;
+                } else {
+                    stats.duplicates++;
+                }
+            } catch (const std::exception& e) {
+                throw FileException("segments.txt", "чтение строки " + std::to_string(lineNumber) + ": " + e.what());
+            }
+        }
+    }
+    file.close();
+    system.setSegmentTable(std::move(table));
+}
+
+void DataManager::saveSnapshot(const NetworkState& state, std::string& out) const {
+    out = BinarySnapshot::serialize(state);
+}
+
+bool DataManager::loadSnapshot(TransportSystem& system) {
+    namespace fs = std::filesystem;
+    const fs::path snapshotPath = dataDirectory + "network.bin";
+    std::error_code error;
+    if (!fs::exists(snapshotPath, error)) {
+        return false;
+    }
+
+    // Снимок годится только для пустой системы
+    if (!system.getStops().empty() || !system.getRoutes().empty() || !system.getTrips().empty() ||
+        !system.getVehicles().empty() || !system.getDrivers().empty()) {
+        return false;
+    }
+
+    // Текстовые файлы, измененные после снимка, имеют приоритет (импорт)
+    auto snapshotTime = fs::last_write_time(snapshotPath, error);
+    if (error) {
+        return false;
+    }
+    for (const char* name : {"stops.txt", "vehicles.txt", "drivers.txt", "routes.txt",
+                             "trips.txt", "transfers.txt", "footpaths.txt"}) {
+        const fs::path textPath = dataDirectory + name;
+        if (fs::exists(textPath, error) && fs::last_write_time(textPath, error) > snapshotTime) {
+            return false;
+        }
+    }
+
+    try {
+        BinarySnapshot::load(system, snapshotPath.string());
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "Снимок сети не загружен (" << e.what() << "), используются текстовые файлы\n";
+        return false;
+    }
+}
@@ -2,34 +2,210 @@
 #define DATA_MANAGER_H
 
 #include <string>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <utility>
 #include <filesystem>
+#include <functional>
+#include <chrono>
+#include <unordered_map>
+#include "change_journal.h"
+#include "background_saver.h"
+#include "network_state.h"
+#include "lazy_trip_store.h"
+#include "data_watcher.h"
 
 class TransportSystem;
+class SaveTransaction;
+
+// Связывание разобранных рейсов с маршрутами, транспортом и водителями системы
+// через хеш-таблицы. Транспорт и водители из полных строк, которых нет в системе, добавляются в нее.
+// Таблицы строятся один раз на проход (загрузка trips.txt, применение журнала, перенос
+// оперативных данных); маршруты, транспорт и водители, замененные или удаленные во время
+// прохода, передаются в таблицы методами remember/forget
+class TripLinker {
+private:
+    TransportSystem& system;
+    std::unordered_map<int, std::shared_ptr<Route>> routesByNumber;
+    std::unordered_map<std::string, std::shared_ptr<Vehicle>> vehiclesByPlate;
+    std::unordered_map<std::string, std::shared_ptr<Driver>> driversByName;
+
+public:
+    explicit TripLinker(TransportSystem& sys);
+
+    std::shared_ptr<Trip> link(ParsedTrip& parsed);
+
+    void rememberRoute(const std::shared_ptr<Route>& route);
+    void forgetRoute(int routeNumber);
+    void rememberVehicle(const std::shared_ptr<Vehicle>& vehicle);
+    void forgetVehicle(const std::string& licensePlate);
+    void rememberDriver(const std::shared_ptr<Driver>& driver);
+    void forgetDriver(const Driver& driver);
+};
+
+// Итоги загрузки одного файла
+struct FileLoadStats {
+    int loaded = 0;     // добавлено записей
+    int duplicates = 0; // записи с уже существующим ключом (ID, номер, госномер, ФИО)
+    int skipped = 0;    // строки с ошибками или чужого формата
+};
+
+// Итоги последней загрузки данных
+struct LoadSummary {
+    bool fromSnapshot = false;
+    bool lazyTrips = false; // рейсы не разобраны, загружен только индекс trips.idx
+    std::vector<std::pair<std::string, FileLoadStats>> files; // в порядке загрузки
+    std::string error; // причина прерывания загрузки, если она была
+};
 
 class DataManager {
 private:
     std::string dataDirectory;
+    int loadThreadCount = 0; // 0 - по числу потоков планировщика системы
+    LoadSummary lastLoadSummary;
+    bool tripsFileOutdated = false; // trips.txt прочитан в старом формате и будет перезаписан
+    bool lazyTripLoading = false;   // рейсы разбираются по маршрутам при первом обращении
+
+    // Журнал изменений journal.txt: после загрузки каждое изменение сети дописывается в него,
+    // а полная перезапись файлов выполняется только при уплотнении журнала
+    ChangeJournal journal;
+    bool journalEnabled = false;
+
+    // Наблюдение за заменой файлов извне (горячая перезагрузка).
+    // Объявлено до saver: запись, которую он завершает при разрушении, приостанавливает наблюдение
+    DataWatcher watcher;
+
+    // Полные сохранения выполняются в фоновом потоке по копии сети.
+    // Объявлен после журнала: при разрушении сначала дожидается записи, которая может обрезать журнал
+    BackgroundSaver saver;
+    unsigned long long reportedSaves = 0; // завершенных сохранений, о которых уже сообщено
+
+    // Кусок trips.txt меньше этого размера не выделяется в отдельный поток
+    static const size_t MIN_PARSE_CHUNK_BYTES = 256 * 1024;
+    static const size_t MAX_REPORTED_BAD_LINES = 10;
+    // Столько записей журнала накапливается до уплотнения в полное сохранение
+    static const size_t JOURNAL_COMPACTION_RECORDS = 500;
 
 public:
+    // Первая строка trips.txt в нормализованном формате (версия 2).
+    // Файл без этой строки читается как файл старого формата
+    static constexpr std::string_view TRIPS_FORMAT_HEADER = "#trips v2";
+    // Первая строка индекса trips.idx (участки trips.txt по маршрутам)
+    static constexpr std::string_view TRIPS_INDEX_HEADER = "#trips-index v1";
+
     DataManager(const std::string& dir = "data/");
 
-    void saveAllData(TransportSystem& system);
+    // Число задач разбора trips.txt (выполняются потоками планировщика системы)
+    void setLoadThreads(int threads);
+    // Загрузка рейсов по требованию: loadAllData читает только индекс trips.idx,
+    // а рейсы маршрута разбираются при первом обращении к нему (см. LazyTripStore).
+    // Если индекс устарел или в журнале есть изменения, рейсы загружаются полностью
+    void setLazyTripLoading(bool enabled);
+
+    // Сохраняет текстовые файлы и бинарный снимок network.bin одним поколением
+    // (см. SaveTransaction): после сбоя на диске остается либо старый, либо новый набор файлов.
+    // Дожидается окончания записи; false при ошибке
+    bool saveAllData(TransportSystem& system);
+    // Загружает сеть из снимка, если он не старше текстовых файлов,
+    // иначе импортирует текстовые файлы. Затем применяет журнал изменений и открывает его
     void loadAllData(TransportSystem& system);
+    // Загрузка для горячей перезагрузки: файлы и журнал читаются, но журнал не открывается
+    // и прерванное сохранение не восстанавливается. Возвращает число примененных записей журнала
+    size_t loadForReload(TransportSystem& system);
+
+    const std::string& getDataDirectory() const;
+    // Опрос каталога данных; onChange вызывается в потоке наблюдения, когда файлы
+    // заменены извне и перестали меняться (см. DataWatcher)
+    void startWatching(std::chrono::milliseconds pollInterval, std::function<void()> onChange);
+    void stopWatching();
+    bool isWatching() const;
+    // Повторить загрузку при ближайшем опросе
+    void requestReload();
+    size_t journalRecordCount() const;
+
+    // Сохранение по запросу пользователя: изменения уже лежат в журнале,
+    // поэтому файлы перезаписываются в фоне, только если журнал пора уплотнить
+    // или он недоступен. Без загрузки через loadAllData сохраняет сразу
+    void saveChanges(TransportSystem& system);
+    // Полное сохранение с ожиданием и очистка журнала
+    void compact(TransportSystem& system);
+    // Ставит копию сети в очередь фоновой записи; после успешной записи из журнала
+    // удаляются записи, сделанные до копирования
+    void requestSave(TransportSystem& system);
+    void waitForSave();
+    // Печатает итог сохранения, завершившегося после предыдущего вызова
+    void reportSaveStatus();
+    SaveStatus getSaveStatus() const;
+
+    // Сжатая копия текущего состояния сети в каталоге archive/ (см. CompressedSnapshot).
+    // Возвращает путь к созданному файлу
+    std::string archive(TransportSystem& system);
+    // Загружает архив в пустую систему; журнал при этом не открывается
+    void loadArchive(TransportSystem& system, const std::string& path);
+
+    bool isJournalOpen() const;
+    // Закрывает журнал до следующего compact (например, на время импорта,
+    // когда каждое изменение писать в журнал слишком дорого)
+    void suspendJournal();
+    // Дописывает запись об изменении сети (формат описан в ОПИСАНИЕ_ФАЙЛОВ_ДАННЫХ.md)
+    void recordChange(TransportSystem& system, const std::string& record);
+    // Группа из count изменений; record(i) - текст i-й записи. Группа не меньше порога уплотнения
+    // в журнал не пишется: вместо этого сразу запрашивается полное сохранение в фоне
+    void recordChanges(TransportSystem& system, size_t count, const std::function<std::string(size_t)>& record);
+
+    // Рейс из строки формата журнала (+trip) с маршрутом, транспортом и водителем системы;
+    // недостающие транспорт и водитель полной строки добавляются в систему.
+    // linker создается один раз на весь проход, а не на каждую строку
+    std::shared_ptr<Trip> linkTrip(TripLinker& linker, std::string_view line);
+
+    const LoadSummary& getLastLoadSummary() const;
+    void printLoadSummary() const;
 
 private:
-    void saveStops(TransportSystem& system);
-    void saveVehicles(TransportSystem& system);
-    void saveDrivers(TransportSystem& system);
-    void saveRoutes(TransportSystem& system);
-    void saveTrips(TransportSystem& system);
-    void saveAdminCredentials(TransportSystem& system);
+    FileLoadStats& fileStats(const std::string& fileName);
+    static void reportBadLines(const std::string& fileName, const std::vector<std::pair<int, std::string>>& badLines);
+
+    void openJournal(TransportSystem& system);
+    size_t replayJournal(TransportSystem& system);
+    void applyJournalRecord(TransportSystem& system, const std::string& record, TripLinker& linker);
+
+    // Записывает копию сети одним поколением; выполняется в потоке BackgroundSaver
+    SaveStats writeState(const NetworkState& state);
+    // commit, во время которого наблюдение за файлами приостановлено
+    size_t commitWatched(SaveTransaction& transaction);
+
+    void saveStops(const NetworkState& state, std::string& out) const;
+    void saveVehicles(const NetworkState& state, std::string& out) const;
+    void saveDrivers(const NetworkState& state, std::string& out) const;
+    void saveRoutes(const NetworkState& state, std::string& out) const;
+    // index - содержимое trips.idx; индекс строится, только если все рейсы записаны ссылками
+    void saveTrips(const NetworkState& state, std::string& out, std::string* index = nullptr) const;
+    void saveAdminCredentials(const NetworkState& state, std::string& out) const;
+    void saveTransfers(const NetworkState& state, std::string& out) const;
+    void saveFootpaths(const NetworkState& state, std::string& out) const;
+    void saveSnapshot(const NetworkState& state, std::string& out) const;
 
+    // Снимок или текстовые файлы без журнала
+    void loadFiles(TransportSystem& system, bool allowLazyTrips);
     void loadStops(TransportSystem& system);
     void loadVehicles(TransportSystem& system);
     void loadDrivers(TransportSystem& system);
     void loadRoutes(TransportSystem& system);
     void loadTrips(TransportSystem& system);
+    // Читает trips.idx, если он построен для текущего trips.txt
+    bool readTripIndex(TripFileStamp& stamp, std::unordered_map<int, LazyTripStore::RouteEntry>& entries) const;
+    // Передает системе рейсы по индексу; false, если в индексе есть маршрут, которого нет в системе
+    bool installLazyTrips(TransportSystem& system, TripFileStamp stamp,
+                          std::unordered_map<int, LazyTripStore::RouteEntry> entries);
+    void upgradeTripsFile(TransportSystem& system);
     void loadAdminCredentials(TransportSystem& system);
+    void loadTransfers(TransportSystem& system);
+    void loadFootpaths(TransportSystem& system);
+    // segments.txt только читается: программа его не изменяет и не сохраняет
+    void loadSegments(TransportSystem& system);
+    bool loadSnapshot(TransportSystem& system);
 };
 
 #endif // DATA_MANAGER_H
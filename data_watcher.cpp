@@ -0,0 +1,127 @@
+#include "data_watcher.h"
+#include <filesystem>
+
+DataWatcher::DataWatcher(std::string dataDirectory, std::vector<std::string> watchedFiles)
+    : directory(std::move(dataDirectory)), fileNames(std::move(watchedFiles)) {}
+
+DataWatcher::~DataWatcher() {
+    stop();
+}
+
+std::string DataWatcher::fingerprint() const {
+    namespace fs = std::filesystem;
+    std::string result;
+    for (const auto& name : fileNames) {
+        const fs::path path = directory + name;
+        std::error_code error;
+        auto size = fs::file_size(path, error);
+        if (error) {
+            result += "-;"; // файла нет
+            continue;
+        }
+        auto time = fs::last_write_time(path, error);
+        result += std::to_string(size) + ":" + std::to_string(time.time_since_epoch().count()) + ";";
+    }
+    return result;
+}
+
+void DataWatcher::start(std::chrono::milliseconds pollInterval, ChangeFunction changeFunction) {
+    stop();
+    std::lock_guard<std::mutex> lock(mutex);
+    interval = pollInterval;
+    onChange = std::move(changeFunction);
+    baseline = fingerprint();
+    stopping = false;
+    triggered = false;
+    worker = std::thread(&DataWatcher::run, this);
+}
+
+void DataWatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool DataWatcher::isRunning() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return worker.joinable() && !stopping;
+}
+
+void DataWatcher::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::string candidate; // отпечаток, который должен повториться при следующем опросе
+    while (true) {
+        wake.wait_for(lock, interval, [this] { return stopping || (triggered && paused == 0); });
+        if (stopping) {
+            return;
+        }
+        if (paused > 0) {
+            candidate.clear();
+            continue;
+        }
+        bool forced = triggered;
+        triggered = false;
+
+        lock.unlock();
+        std::string current = fingerprint();
+        lock.lock();
+        // Во время опроса могла начаться или завершиться запись программой
+        if (stopping || paused > 0) {
+            candidate.clear();
+            continue;
+        }
+        if (!forced) {
+            if (current == baseline) {
+                candidate.clear();
+                continue;
+            }
+            if (current != candidate) {
+                candidate = current; // файлы еще меняются
+                continue;
+            }
+        }
+
+        baseline = current;
+        candidate.clear();
+        reloading = true;
+        lock.unlock();
+        try {
+            onChange();
+        } catch (...) {
+            // Ошибки загрузки обрабатывает onChange; поток наблюдения не должен завершаться
+        }
+        lock.lock();
+        reloading = false;
+        wake.notify_all();
+    }
+}
+
+void DataWatcher::pause() {
+    std::unique_lock<std::mutex> lock(mutex);
+    wake.wait(lock, [this] { return !reloading; });
+    paused++;
+}
+
+void DataWatcher::resume() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (paused > 0) {
+        paused--;
+    }
+    if (paused == 0) {
+        baseline = fingerprint();
+    }
+    wake.notify_all();
+}
+
+void DataWatcher::trigger() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        triggered = true;
+    }
+    wake.notify_all();
+}
@@ -0,0 +1,69 @@
+#ifndef DATA_WATCHER_H
+#define DATA_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "network_state.h"
+
+// Результат фоновой загрузки файлов, замененных извне
+struct ReloadResult {
+    std::shared_ptr<const NetworkState> state; // проверенная сеть; пусто при ошибке
+    std::string error;                         // почему новые файлы не приняты
+    size_t journalRecords = 0;                 // записей журнала, примененных к новым файлам
+    double milliseconds = 0.0;                 // загрузка, проверка и построение индекса
+};
+
+// Наблюдение за файлами каталога данных опросом (одинаково работает в Windows и Linux).
+// Отпечаток каталога - размер и время изменения каждого отслеживаемого файла.
+// Об изменении сообщается, когда новый отпечаток продержался два опроса подряд,
+// поэтому файлы, которые еще копируются, не читаются.
+// Собственные сохранения программы выполняются между pause и resume и изменением не считаются.
+class DataWatcher {
+public:
+    using ChangeFunction = std::function<void()>;
+
+private:
+    std::string directory;
+    std::vector<std::string> fileNames;
+    ChangeFunction onChange;
+    std::chrono::milliseconds interval{2000};
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool triggered = false; // загрузить при следующем опросе независимо от отпечатка
+    bool reloading = false; // выполняется onChange
+    int paused = 0;
+    std::string baseline;   // отпечаток загруженных или записанных программой файлов
+
+    std::string fingerprint() const;
+    void run();
+
+public:
+    DataWatcher(std::string dataDirectory, std::vector<std::string> watchedFiles);
+    ~DataWatcher();
+
+    DataWatcher(const DataWatcher&) = delete;
+    DataWatcher& operator=(const DataWatcher&) = delete;
+
+    // Текущее состояние файлов принимается за исходное; onChange вызывается в потоке наблюдения
+    void start(std::chrono::milliseconds pollInterval, ChangeFunction changeFunction);
+    void stop();
+    bool isRunning() const;
+
+    // На время записи файлов программой. pause дожидается окончания загрузки в onChange,
+    // чтобы она не прочитала наполовину записанное поколение
+    void pause();
+    void resume();
+    // Повторная загрузка при ближайшем опросе (например, если результат устарел до подмены)
+    void trigger();
+};
+
+#endif // DATA_WATCHER_H
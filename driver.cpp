@@ -1,8 +1,8 @@
 #include "driver.h"
-#include <sstream>
+#include "text_parser.h"
 
-Driver::Driver(const std::string& fname, const std::string& lname, const std::string& mname, const std::string& cat)
-    : firstName(fname), lastName(lname), middleName(mname), category(cat) {}
+Driver::Driver(std::string fname, std::string lname, std::string mname, std::string cat)
+    : firstName(std::move(fname)), lastName(std::move(lname)), middleName(std::move(mname)), category(std::move(cat)) {}
 
 std::string Driver::getFullName() const {
     return lastName + " " + firstName + (middleName.empty() ? "" : " " + middleName);
@@ -38,14 +38,14 @@ std::string Driver::serialize() const {
     return firstName + "|" + lastName + "|" + middleName + "|" + category;
 }
 
-std::shared_ptr<Driver> Driver::deserialize(const std::string& data) {
-    std::istringstream ss(data);
-    std::string firstName, lastName, middleName, category;
-    std::getline(ss, firstName, '|');
-    std::getline(ss, lastName, '|');
-    std::getline(ss, middleName, '|');
-    std::getline(ss, category);
+std::shared_ptr<Driver> Driver::deserialize(std::string_view data) {
+    FieldTokenizer fields(data, '|');
+    std::string_view firstName, lastName, middleName;
+    fields.next(firstName);
+    fields.next(lastName);
+    fields.next(middleName);
     // Если категория не указана в старых данных, оставляем пустой строкой
-    return std::make_shared<Driver>(firstName, lastName, middleName, category);
+    return std::make_shared<Driver>(std::string(firstName), std::string(lastName),
+                                    std::string(middleName), std::string(fields.rest()));
 }
 
@@ -2,6 +2,7 @@
 #define DRIVER_H
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <sstream>
 
@@ -12,7 +13,7 @@ private:
     std::string middleName;
     std::string category; // Категория водительских прав (D, T, и т.д.)
 public:
-    Driver(const std::string& fname, const std::string& lname, const std::string& mname = "", const std::string& cat = "");
+    Driver(std::string fname, std::string lname, std::string mname = "", std::string cat = "");
 
     std::string getFullName() const;
     std::string getFirstName() const;
@@ -24,7 +25,7 @@ public:
     bool operator==(const Driver& other) const;
 
     std::string serialize() const;
-    static std::shared_ptr<Driver> deserialize(const std::string& data);
+    static std::shared_ptr<Driver> deserialize(std::string_view data);
 };
 
 #endif // DRIVER_H
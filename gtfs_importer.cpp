@@ -0,0 +1,728 @@
+#include "gtfs_importer.h"
+#include "transport_system.h"
+#include "bus.h"
+#include "tram.h"
+#include "trolleybus.h"
+#include "exceptions.h"
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <charconv>
+#include <algorithm>
+#include <cstdint>
+#include <atomic>
+
+namespace {
+
+// Строка stop_times.txt после сопоставления идентификаторов GTFS с номерами
+struct StopTimeRecord {
+    int32_t trip;     // индекс рейса GTFS
+    int32_t sequence; // stop_sequence
+    int32_t stop;     // индекс остановки GTFS
+    int32_t minutes;  // время прибытия от начала суток, -1 - время не задано
+
+    bool operator<(const StopTimeRecord& other) const {
+        return trip != other.trip ? trip < other.trip : sequence < other.sequence;
+    }
+};
+
+// Поиск по std::string_view без создания временной строки
+struct StringViewHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view text) const {
+        return std::hash<std::string_view>{}(text);
+    }
+};
+using IdMap = std::unordered_map<std::string, int, StringViewHash, std::equal_to<>>;
+
+int lookup(const IdMap& map, std::string_view key) {
+    auto it = map.find(key);
+    return it != map.end() ? it->second : -1;
+}
+
+// Поля одной строки CSV. Поля без экранированных кавычек указывают прямо в строку
+class CsvRow {
+private:
+    std::vector<std::string_view> fields;
+    std::vector<std::string> unescaped;
+
+public:
+    void split(std::string_view line) {
+        fields.clear();
+        unescaped.clear();
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        // Строки храним заранее выделенными, чтобы указатели на них не сдвигались
+        unescaped.reserve(std::count(line.begin(), line.end(), '"'));
+
+        size_t position = 0;
+        while (true) {
+            if (position < line.size() && line[position] == '"') {
+                size_t start = position + 1;
+                std::string value;
+                bool escaped = false;
+                size_t i = start;
+                for (; i < line.size(); ++i) {
+                    if (line[i] != '"') {
+                        continue;
+                    }
+                    if (i + 1 < line.size() && line[i + 1] == '"') {
+                        escaped = true;
+                        ++i;
+                        continue;
+                    }
+                    break;
+                }
+                std::string_view raw = line.substr(start, i - start);
+                if (escaped) {
+                    for (size_t k = 0; k < raw.size(); ++k) {
+                        value += raw[k];
+                        if (raw[k] == '"') {
+                            ++k;
+                        }
+                    }
+                    unescaped.push_back(std::move(value));
+                    fields.push_back(unescaped.back());
+                } else {
+                    fields.push_back(raw);
+                }
+                position = line.find(',', i);
+            } else {
+                size_t comma = line.find(',', position);
+                fields.push_back(line.substr(position, comma == std::string_view::npos ? std::string_view::npos
+                                                                                        : comma - position));
+                position = comma;
+            }
+            if (position == std::string_view::npos || position >= line.size()) {
+                break;
+            }
+            ++position;
+        }
+    }
+
+    size_t size() const {
+        return fields.size();
+    }
+
+    std::string_view operator[](int column) const {
+        if (column < 0 || column >= static_cast<int>(fields.size())) {
+            return {};
+        }
+        std::string_view field = fields[column];
+        while (!field.empty() && field.front() == ' ') field.remove_prefix(1);
+        while (!field.empty() && field.back() == ' ') field.remove_suffix(1);
+        return field;
+    }
+};
+
+// Файл GTFS с заголовком: столбцы ищутся по имени
+class CsvFile {
+private:
+    std::string name;
+    std::ifstream file;
+    std::vector<std::string> header;
+    std::string line;
+
+public:
+    CsvFile(const std::string& directory, const std::string& fileName, bool required) : name(fileName) {
+        file.open((std::filesystem::path(directory) / fileName).string(), std::ios::binary);
+        if (!file.is_open()) {
+            if (required) {
+                throw FileException(fileName, "открытие файла GTFS");
+            }
+            return;
+        }
+        if (std::getline(file, line)) {
+            // Метка порядка байтов UTF-8 в начале файла
+            if (line.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+                line.erase(0, 3);
+            }
+            CsvRow row;
+            row.split(line);
+            for (size_t c = 0; c < row.size(); ++c) {
+                header.emplace_back(row[static_cast<int>(c)]);
+            }
+        }
+    }
+
+    bool isOpen() const {
+        return file.is_open();
+    }
+
+    int column(const std::string& columnName, bool required) const {
+        auto it = std::find(header.begin(), header.end(), columnName);
+        if (it == header.end()) {
+            if (required) {
+                throw FileException(name, "нет столбца " + columnName);
+            }
+            return -1;
+        }
+        return static_cast<int>(it - header.begin());
+    }
+
+    bool next(CsvRow& row) {
+        while (std::getline(file, line)) {
+            if (line.empty() || line == "\r") {
+                continue;
+            }
+            row.split(line);
+            return true;
+        }
+        return false;
+    }
+
+    // Поток сразу после заголовка - для блочного чтения stop_times.txt
+    std::ifstream& stream() {
+        return file;
+    }
+};
+
+int parseNumber(std::string_view field) {
+    int value = 0;
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    if (error != std::errc() || end != field.data() + field.size()) {
+        throw InputException("неверное число '" + std::string(field) + "'");
+    }
+    return value;
+}
+
+// ЧЧ:ММ:СС, часы могут быть больше 24 (рейсы после полуночи). -1 для пустого поля
+int parseGtfsTime(std::string_view field) {
+    if (field.empty()) {
+        return -1;
+    }
+    size_t first = field.find(':');
+    size_t second = first == std::string_view::npos ? first : field.find(':', first + 1);
+    if (second == std::string_view::npos) {
+        throw InputException("неверное время '" + std::string(field) + "'");
+    }
+    int hours = parseNumber(field.substr(0, first));
+    int minutes = parseNumber(field.substr(first + 1, second - first - 1));
+    parseNumber(field.substr(second + 1));
+    return (hours * 60 + minutes) % (24 * 60);
+}
+
+std::string vehicleTypeFor(int routeType) {
+    switch (routeType) {
+        case 0: return "Трамвай";
+        case 11:
+        case 800: return "Троллейбус";
+        default: return "Автобус";
+    }
+}
+
+// Отсортированная часть stop_times.txt во временном файле; файл удаляется вместе с объектом
+class RunFile {
+private:
+    std::filesystem::path path;
+
+public:
+    explicit RunFile(std::filesystem::path filePath) : path(std::move(filePath)) {}
+    ~RunFile() {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+    RunFile(const RunFile&) = delete;
+    RunFile& operator=(const RunFile&) = delete;
+
+    const std::filesystem::path& getPath() const {
+        return path;
+    }
+
+    void write(const std::vector<StopTimeRecord>& records) const {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(records.data()),
+                  static_cast<std::streamsize>(records.size() * sizeof(StopTimeRecord)));
+        if (!out) {
+            throw FileException(path.string(), "запись временного файла импорта");
+        }
+    }
+};
+
+// Последовательное чтение одной отсортированной части при слиянии
+class RunReader {
+private:
+    static const size_t BUFFER_RECORDS = 4096;
+
+    std::ifstream file;
+    std::vector<StopTimeRecord> buffer;
+    size_t position = 0;
+
+public:
+    explicit RunReader(const std::filesystem::path& path) : file(path, std::ios::binary) {
+        refill();
+    }
+    explicit RunReader(std::vector<StopTimeRecord> records) : buffer(std::move(records)) {}
+
+    bool empty() const {
+        return position >= buffer.size();
+    }
+
+    const StopTimeRecord& current() const {
+        return buffer[position];
+    }
+
+    void advance() {
+        if (++position >= buffer.size() && file.is_open()) {
+            refill();
+        }
+    }
+
+private:
+    void refill() {
+        buffer.resize(BUFFER_RECORDS);
+        file.read(reinterpret_cast<char*>(buffer.data()),
+                  static_cast<std::streamsize>(BUFFER_RECORDS * sizeof(StopTimeRecord)));
+        buffer.resize(static_cast<size_t>(file.gcount()) / sizeof(StopTimeRecord));
+        position = 0;
+    }
+};
+
+struct GtfsRoute {
+    std::string shortName;
+    std::string vehicleType;
+    unsigned dayMask = 0; // дни всех рейсов маршрута (бит 0 - понедельник)
+    bool numberUsed = false;
+};
+
+struct GtfsTrip {
+    int route;
+    unsigned dayMask;
+};
+
+} // namespace
+
+double GtfsImportStats::rowsPerSecond() const {
+    return milliseconds > 0 ? rows / (milliseconds / 1000.0) : 0.0;
+}
+
+void GtfsImporter::setBlockBytes(size_t bytes) {
+    blockBytes = std::max<size_t>(bytes, 4096);
+}
+
+void GtfsImporter::setThreads(int threads) {
+    threadCount = threads;
+}
+
+void GtfsImporter::setTempDirectory(const std::string& directory) {
+    tempDirectory = directory;
+}
+
+GtfsImportStats GtfsImporter::import(TransportSystem& system, const std::string& feedDirectory) const {
+    auto start = std::chrono::steady_clock::now();
+    GtfsImportStats stats;
+    CsvRow row;
+
+    // calendar.txt: service_id -> дни недели
+    const unsigned ALL_DAYS = 0x7F;
+    IdMap serviceIndex;
+    std::vector<unsigned> serviceDays;
+    {
+        CsvFile calendar(feedDirectory, "calendar.txt", false);
+        if (calendar.isOpen()) {
+            static const char* DAY_COLUMNS[] = {"monday", "tuesday", "wednesday", "thursday",
+                                                "friday", "saturday", "sunday"};
+            int idColumn = calendar.column("service_id", true);
+            int dayColumns[7];
+            for (int d = 0; d < 7; ++d) {
+                dayColumns[d] = calendar.column(DAY_COLUMNS[d], true);
+            }
+            while (calendar.next(row)) {
+                stats.rows++;
+                unsigned mask = 0;
+                for (int d = 0; d < 7; ++d) {
+                    if (row[dayColumns[d]] == "1") {
+                        mask |= 1u << d;
+                    }
+                }
+                serviceIndex.emplace(std::string(row[idColumn]), static_cast<int>(serviceDays.size()));
+                serviceDays.push_back(mask);
+            }
+        }
+    }
+
+    // stops.txt: названия остановок (станции и входы без посадки пропускаются)
+    IdMap stopIndex;
+    std::vector<std::string> stopNames;
+    {
+        CsvFile stopsFile(feedDirectory, "stops.txt", true);
+        int idColumn = stopsFile.column("stop_id", true);
+        int nameColumn = stopsFile.column("stop_name", false);
+        int typeColumn = stopsFile.column("location_type", false);
+        while (stopsFile.next(row)) {
+            stats.rows++;
+            std::string_view type = row[typeColumn];
+            if (!type.empty() && type != "0") {
+                continue;
+            }
+            std::string_view id = row[idColumn];
+            std::string_view name = row[nameColumn];
+            if (!stopIndex.emplace(std::string(id), static_cast<int>(stopNames.size())).second) {
+                stats.skippedRows++;
+                continue;
+            }
+            // Разделители полей файлов данных в названии заменяются запятой
+            std::string stopName(name.empty() ? id : name);
+            std::replace_if(stopName.begin(), stopName.end(),
+                            [](char c) { return c == '|' || c == ';' || c == '='; }, ',');
+            stopNames.push_back(std::move(stopName));
+        }
+    }
+
+    // routes.txt
+    IdMap routeIndex;
+    std::vector<GtfsRoute> gtfsRoutes;
+    {
+        CsvFile routesFile(feedDirectory, "routes.txt", true);
+        int idColumn = routesFile.column("route_id", true);
+        int shortNameColumn = routesFile.column("route_short_name", false);
+        int typeColumn = routesFile.column("route_type", true);
+        while (routesFile.next(row)) {
+            stats.rows++;
+            try {
+                GtfsRoute route;
+                route.shortName = std::string(row[shortNameColumn]);
+                route.vehicleType = vehicleTypeFor(parseNumber(row[typeColumn]));
+                if (!routeIndex.emplace(std::string(row[idColumn]), static_cast<int>(gtfsRoutes.size())).second) {
+                    stats.skippedRows++;
+                    continue;
+                }
+                gtfsRoutes.push_back(std::move(route));
+            } catch (const std::exception&) {
+                stats.skippedRows++;
+            }
+        }
+    }
+
+    // trips.txt: рейс -> маршрут и дни обслуживания
+    IdMap tripIndex;
+    std::vector<GtfsTrip> gtfsTrips;
+    {
+        CsvFile tripsFile(feedDirectory, "trips.txt", true);
+        int idColumn = tripsFile.column("trip_id", true);
+        int routeColumn = tripsFile.column("route_id", true);
+        int serviceColumn = tripsFile.column("service_id", true);
+        while (tripsFile.next(row)) {
+            stats.rows++;
+            int route = lookup(routeIndex, row[routeColumn]);
+            if (route == -1) {
+                stats.skippedRows++;
+                continue;
+            }
+            int service = lookup(serviceIndex, row[serviceColumn]);
+            unsigned mask = service == -1 ? ALL_DAYS : serviceDays[service];
+            if (!tripIndex.emplace(std::string(row[idColumn]), static_cast<int>(gtfsTrips.size())).second) {
+                stats.skippedRows++;
+                continue;
+            }
+            gtfsRoutes[route].dayMask |= mask;
+            gtfsTrips.push_back({route, mask});
+        }
+    }
+
+    // stop_times.txt: блоки текста разбираются и сортируются параллельно,
+    // все блоки, кроме последнего, сбрасываются во временные файлы
+    CsvFile stopTimesFile(feedDirectory, "stop_times.txt", true);
+    const int tripColumn = stopTimesFile.column("trip_id", true);
+    const int arrivalColumn = stopTimesFile.column("arrival_time", true);
+    const int departureColumn = stopTimesFile.column("departure_time", false);
+    const int stopColumn = stopTimesFile.column("stop_id", true);
+    const int sequenceColumn = stopTimesFile.column("stop_sequence", true);
+
+    TaskScheduler& scheduler = system.getScheduler();
+    const int workers = std::max(1, threadCount > 0 ? threadCount : scheduler.getWorkerCount() + 1);
+    const std::filesystem::path runDirectory = tempDirectory.empty()
+        ? std::filesystem::temp_directory_path() : std::filesystem::path(tempDirectory);
+    const std::string runPrefix = "gtfs_import_" +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "_";
+
+    std::vector<std::unique_ptr<RunFile>> runFiles;
+    std::vector<std::vector<StopTimeRecord>> memoryRuns;
+    std::atomic<size_t> stopTimeRows{0};
+    std::atomic<size_t> skippedStopTimes{0};
+
+    std::istream& input = stopTimesFile.stream();
+    std::string block;
+    std::string carry;
+    bool finished = false;
+    while (!finished) {
+        block.swap(carry);
+        carry.clear();
+        size_t filled = block.size();
+        block.resize(std::max(blockBytes, filled * 2));
+        input.read(block.data() + filled, static_cast<std::streamsize>(block.size() - filled));
+        block.resize(filled + static_cast<size_t>(input.gcount()));
+        finished = !input;
+
+        // Неполная последняя строка переносится в следующий блок
+        if (!finished) {
+            size_t lastNewline = block.rfind('\n');
+            if (lastNewline == std::string::npos) {
+                carry.swap(block); // строка длиннее блока - дочитываем
+                continue;
+            }
+            carry.assign(block, lastNewline + 1);
+            block.resize(lastNewline + 1);
+        }
+
+        std::string_view content(block);
+        size_t chunkCount = std::clamp<size_t>(content.size() / (1024 * 1024), 1, static_cast<size_t>(workers));
+        std::vector<size_t> chunkStart(chunkCount + 1, content.size());
+        chunkStart[0] = 0;
+        for (size_t c = 1; c < chunkCount; ++c) {
+            size_t newline = content.find('\n', content.size() * c / chunkCount);
+            chunkStart[c] = std::max(chunkStart[c - 1],
+                                     newline == std::string_view::npos ? content.size() : newline + 1);
+        }
+
+        std::vector<std::vector<StopTimeRecord>> chunks(chunkCount);
+        std::vector<std::unique_ptr<RunFile>> chunkFiles(chunkCount);
+        std::vector<std::string> chunkErrors(chunkCount);
+        const bool spill = !finished;
+        const size_t runNumber = runFiles.size() + memoryRuns.size();
+
+        // Каждая задача пишет только в свой кусок; таблицы идентификаторов только читаются
+        auto parseChunk = [&](size_t c) {
+            try {
+                CsvRow fields;
+                auto& records = chunks[c];
+                size_t rows = 0, skipped = 0;
+                size_t position = chunkStart[c];
+                while (position < chunkStart[c + 1]) {
+                    size_t lineEnd = content.find('\n', position);
+                    if (lineEnd == std::string_view::npos || lineEnd > chunkStart[c + 1]) {
+                        lineEnd = chunkStart[c + 1];
+                    }
+                    std::string_view line = content.substr(position, lineEnd - position);
+                    position = lineEnd + 1;
+                    if (line.empty() || line == "\r") {
+                        continue;
+                    }
+                    rows++;
+                    fields.split(line);
+                    try {
+                        int trip = lookup(tripIndex, fields[tripColumn]);
+                        int stop = lookup(stopIndex, fields[stopColumn]);
+                        if (trip == -1 || stop == -1) {
+                            skipped++;
+                            continue;
+                        }
+                        int minutes = parseGtfsTime(fields[arrivalColumn]);
+                        if (minutes == -1) {
+                            minutes = parseGtfsTime(fields[departureColumn]);
+                        }
+                        records.push_back({trip, parseNumber(fields[sequenceColumn]), stop, minutes});
+                    } catch (const InputException&) {
+                        skipped++;
+                    }
+                }
+                std::sort(records.begin(), records.end());
+                stopTimeRows += rows;
+                skippedStopTimes += skipped;
+
+                if (spill && !records.empty()) {
+                    chunkFiles[c] = std::make_unique<RunFile>(
+                        runDirectory / (runPrefix + std::to_string(runNumber + c) + ".bin"));
+                    chunkFiles[c]->write(records);
+                    records.clear();
+                    records.shrink_to_fit();
+                }
+            } catch (const std::exception& e) {
+                chunkErrors[c] = e.what();
+            }
+        };
+
+        scheduler.parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                parseChunk(c);
+            }
+        }, static_cast<int>(chunkCount));
+
+        for (size_t c = 0; c < chunkCount; ++c) {
+            if (!chunkErrors[c].empty()) {
+                throw FileException("stop_times.txt", chunkErrors[c]);
+            }
+            if (chunkFiles[c]) {
+                runFiles.push_back(std::move(chunkFiles[c]));
+            } else if (!chunks[c].empty()) {
+                memoryRuns.push_back(std::move(chunks[c]));
+            }
+        }
+    }
+    block.clear();
+    block.shrink_to_fit();
+    stats.stopTimes = stopTimeRows;
+    stats.rows += stopTimeRows;
+    stats.skippedRows += skippedStopTimes;
+    stats.runs = static_cast<int>(runFiles.size() + memoryRuns.size());
+
+    // Объекты системы, к которым привязываются новые рейсы
+    std::unordered_map<std::string, int> systemStops;
+    int nextStopId = 1;
+    for (const auto& stop : system.getStops()) {
+        systemStops.emplace(stop.getName(), stop.getId());
+        nextStopId = std::max(nextStopId, stop.getId() + 1);
+    }
+    std::unordered_set<int> usedNumbers;
+    int nextRouteNumber = 1;
+    for (const auto& route : system.getRoutes()) {
+        usedNumbers.insert(route->getNumber());
+        nextRouteNumber = std::max(nextRouteNumber, route->getNumber() + 1);
+    }
+    for (const auto& route : gtfsRoutes) {
+        int number = 0;
+        auto [end, error] = std::from_chars(route.shortName.data(), route.shortName.data() + route.shortName.size(), number);
+        if (error == std::errc() && end == route.shortName.data() + route.shortName.size() && number > 0) {
+            nextRouteNumber = std::max(nextRouteNumber, number + 1);
+        }
+    }
+    int nextTripId = 1;
+    for (const auto& trip : system.getTrips()) {
+        nextTripId = std::max(nextTripId, trip->getTripId() + 1);
+    }
+
+    auto driver = system.findDriverByName("Импорт", "GTFS");
+    if (!driver) {
+        driver = std::make_shared<Driver>("Импорт", "GTFS");
+        system.addDriverDirect(driver);
+    }
+    std::unordered_map<std::string, std::shared_ptr<Vehicle>> vehicles;
+    auto vehicleFor = [&](const std::string& type) {
+        auto& vehicle = vehicles[type];
+        if (!vehicle) {
+            const std::string plate = "GTFS " + type;
+            vehicle = system.findVehicleByLicensePlate(plate);
+            if (!vehicle) {
+                if (type == "Трамвай") {
+                    vehicle = std::make_shared<Tram>("GTFS", plate);
+                } else if (type == "Троллейбус") {
+                    vehicle = std::make_shared<Trolleybus>("GTFS", plate);
+                } else {
+                    vehicle = std::make_shared<Bus>("GTFS", plate);
+                }
+                system.addVehicleDirect(vehicle);
+            }
+        }
+        return vehicle;
+    };
+
+    auto stopNameFor = [&](int stop) -> const std::string& {
+        const std::string& name = stopNames[stop];
+        if (systemStops.emplace(name, nextStopId).second) {
+            system.addStopDirect(Stop(nextStopId++, name));
+            stats.stops++;
+        }
+        return name;
+    };
+
+    // Маршрут на каждую последовательность остановок маршрута GTFS
+    std::unordered_map<std::string, std::shared_ptr<Route>> patterns;
+    auto routeFor = [&](int gtfsRoute, const std::vector<StopTimeRecord>& records) {
+        std::string key(reinterpret_cast<const char*>(&gtfsRoute), sizeof(gtfsRoute));
+        for (const auto& record : records) {
+            key.append(reinterpret_cast<const char*>(&record.stop), sizeof(record.stop));
+        }
+        auto& route = patterns[key];
+        if (!route) {
+            GtfsRoute& source = gtfsRoutes[gtfsRoute];
+            int number = 0;
+            auto [end, error] = std::from_chars(source.shortName.data(),
+                                                source.shortName.data() + source.shortName.size(), number);
+            bool numeric = error == std::errc() && end == source.shortName.data() + source.shortName.size();
+            if (!numeric || number <= 0 || source.numberUsed || usedNumbers.count(number)) {
+                number = nextRouteNumber++;
+            }
+            source.numberUsed = true;
+            usedNumbers.insert(number);
+
+            std::vector<std::string> routeStops;
+            routeStops.reserve(records.size());
+            for (const auto& record : records) {
+                routeStops.push_back(stopNameFor(record.stop));
+            }
+            std::set<int> days;
+            for (int d = 0; d < 7; ++d) {
+                if (source.dayMask & (1u << d)) {
+                    days.insert(d + 1);
+                }
+            }
+            route = std::make_shared<Route>(number, source.vehicleType, std::move(routeStops), days);
+            system.addRouteDirect(route);
+            stats.routes++;
+        }
+        return route;
+    };
+
+    auto buildTrip = [&](const std::vector<StopTimeRecord>& records) {
+        const GtfsTrip& source = gtfsTrips[records.front().trip];
+        auto firstTimed = std::find_if(records.begin(), records.end(),
+                                       [](const StopTimeRecord& r) { return r.minutes != -1; });
+        if (records.size() < 2 || firstTimed == records.end() || source.dayMask == 0) {
+            stats.skippedRows += records.size();
+            return;
+        }
+        auto route = routeFor(source.route, records);
+        auto vehicle = vehicleFor(route->getVehicleType());
+        for (int d = 0; d < 7; ++d) {
+            if (!(source.dayMask & (1u << d))) {
+                continue;
+            }
+            auto trip = std::make_shared<Trip>(nextTripId++, route, vehicle, driver, Time(0, firstTimed->minutes), d + 1);
+            for (const auto& record : records) {
+                if (record.minutes != -1) {
+                    trip->setArrivalTime(stopNames[record.stop], Time(0, record.minutes));
+                }
+            }
+            trip->shareSchedule();
+            system.addTripDirect(trip);
+            stats.trips++;
+        }
+    };
+
+    // Слияние отсортированных частей: строки одного рейса идут подряд
+    std::vector<RunReader> readers;
+    readers.reserve(runFiles.size() + memoryRuns.size());
+    for (const auto& runFile : runFiles) {
+        readers.emplace_back(runFile->getPath());
+    }
+    for (auto& run : memoryRuns) {
+        readers.emplace_back(std::move(run));
+    }
+    memoryRuns.clear();
+
+    auto later = [&readers](size_t a, size_t b) {
+        return readers[b].current() < readers[a].current();
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+    for (size_t r = 0; r < readers.size(); ++r) {
+        if (!readers[r].empty()) {
+            heap.push(r);
+        }
+    }
+
+    std::vector<StopTimeRecord> tripRecords;
+    while (!heap.empty()) {
+        size_t r = heap.top();
+        heap.pop();
+        const StopTimeRecord& record = readers[r].current();
+        if (!tripRecords.empty() && tripRecords.front().trip != record.trip) {
+            buildTrip(tripRecords);
+            tripRecords.clear();
+        }
+        tripRecords.push_back(record);
+        readers[r].advance();
+        if (!readers[r].empty()) {
+            heap.push(r);
+        }
+    }
+    if (!tripRecords.empty()) {
+        buildTrip(tripRecords);
+    }
+
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
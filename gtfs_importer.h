@@ -0,0 +1,56 @@
+#ifndef GTFS_IMPORTER_H
+#define GTFS_IMPORTER_H
+
+#include <string>
+#include <cstddef>
+
+class TransportSystem;
+
+// Итоги импорта расписания GTFS
+struct GtfsImportStats {
+    size_t stops = 0;       // добавлено остановок
+    size_t routes = 0;      // добавлено маршрутов (по одному на каждую последовательность остановок)
+    size_t trips = 0;       // добавлено рейсов (по одному на каждый день обслуживания)
+    size_t rows = 0;        // прочитано строк во всех файлах
+    size_t stopTimes = 0;   // строк stop_times.txt
+    size_t skippedRows = 0; // строки с ошибками или ссылками на неизвестные объекты
+    int runs = 0;           // отсортированных частей stop_times.txt
+    double milliseconds = 0.0;
+
+    double rowsPerSecond() const;
+};
+
+// Потоковый импорт расписания в формате GTFS (stops.txt, routes.txt, trips.txt,
+// stop_times.txt, calendar.txt) в систему.
+// stop_times.txt не загружается целиком: файл читается блоками ограниченного размера,
+// строки каждого блока разбираются и сортируются по рейсу в нескольких потоках
+// и при необходимости сбрасываются во временные файлы, после чего части сливаются
+// (внешняя сортировка) и рейсы собираются по одному.
+//
+// Соответствие GTFS и модели системы:
+//  - остановки сопоставляются по названию, существующие остановки не дублируются;
+//  - маршрут GTFS превращается в один Route на каждую различную последовательность остановок;
+//    номер берется из route_short_name, если он числовой и свободен, иначе выделяется новый;
+//  - рейс GTFS превращается в Trip на каждый день недели из calendar.txt
+//    (сервис без записи в calendar.txt считается ежедневным);
+//  - время берется из arrival_time (или departure_time) по модулю суток;
+//  - транспорт и водитель в GTFS не задаются: рейсы получают общий транспорт
+//    своего типа (госномер "GTFS <тип>") и водителя "Импорт GTFS".
+// Поля в кавычках поддерживаются, переводы строк внутри полей - нет.
+class GtfsImporter {
+private:
+    size_t blockBytes = 64 * 1024 * 1024; // размер блока stop_times.txt в памяти
+    int threadCount = 0;                  // задач разбора; 0 - по числу потоков планировщика
+    std::string tempDirectory;            // пусто - системный каталог временных файлов
+
+public:
+    void setBlockBytes(size_t bytes);
+    void setThreads(int threads);
+    void setTempDirectory(const std::string& directory);
+
+    // Добавляет расписание из каталога feedDirectory в систему.
+    // FileException, если нет обязательного файла или столбца
+    GtfsImportStats import(TransportSystem& system, const std::string& feedDirectory) const;
+};
+
+#endif // GTFS_IMPORTER_H
@@ -4,9 +4,11 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <optional>
 #include "journey.h"
 #include "time.h"
 #include "algorithm.h"
+#include "journey_stream.h"
 
 class TransportSystem;
 
@@ -19,18 +21,30 @@ private:
     std::unique_ptr<BFSAlgorithm> bfsAlgorithm;
     std::unique_ptr<FastestPathAlgorithm> fastestAlgorithm;
     std::unique_ptr<MinimalTransfersAlgorithm> minimalTransfersAlgorithm;
+    std::unique_ptr<LatestDepartureAlgorithm> latestDepartureAlgorithm;
 
 public:
     JourneyPlanner(TransportSystem* sys);
 
+    // limit - сколько лучших поездок вернуть (0 - все)
     std::vector<Journey> findJourneysWithTransfers(const std::string& startStop,
                                                    const std::string& endStop,
                                                    const Time& departureTime,
-                                                   int maxTransfers = 2) const;
+                                                   int maxTransfers = 2,
+                                                   size_t limit = 0) const;
 
     std::vector<Journey> findAllJourneysWithTransfers(const std::string& startStop,
                                                       const std::string& endStop,
-                                                      int maxTransfers = 2) const;
+                                                      int maxTransfers = 2,
+                                                      size_t limit = 0) const;
+
+    // Поток поездок в заданном порядке; поиск выполняется по мере чтения результатов.
+    // Без времени отправления поездка может начинаться любым рейсом.
+    JourneyStream streamJourneys(const std::string& startStop,
+                                 const std::string& endStop,
+                                 std::optional<Time> departureTime,
+                                 JourneyOrder order = JourneyOrder::ByArrival,
+                                 int maxTransfers = 2) const;
 
     Journey findFastestJourney(const std::string& startStop,
                                const std::string& endStop,
@@ -40,6 +54,12 @@ public:
                                           const std::string& endStop,
                                           const Time& departureTime);
 
+    // Поездка с самым поздним отправлением и прибытием не позже deadline
+    Journey findLatestDepartureJourney(const std::string& startStop,
+                                       const std::string& endStop,
+                                       const Time& deadline,
+                                       int weekDay = 0);
+
     void displayJourney(const Journey& journey) const;
 };
 
@@ -0,0 +1,208 @@
+#include "journey_stream.h"
+#include "transport_system.h"
+
+bool JourneyStream::NodeCompare::operator()(const SearchNode& a, const SearchNode& b) const {
+    // std::priority_queue извлекает "наибольший" элемент, поэтому сравнение обратное
+    if (a.primaryKey != b.primaryKey) return a.primaryKey > b.primaryKey;
+    if (a.secondaryKey != b.secondaryKey) return a.secondaryKey > b.secondaryKey;
+    return a.sequence > b.sequence;
+}
+
+JourneyStream::JourneyStream(TransportSystem* sys,
+                             const std::string& start,
+                             const std::string& end,
+                             std::optional<Time> departure,
+                             JourneyOrder journeyOrder,
+                             int transfersLimit)
+    : network(sys->getSnapshot()), startStop(start), endStop(end), departureTime(departure),
+      order(journeyOrder), maxTransfers(transfersLimit) {
+    // Недостижимые пары отсекаются по предрассчитанному замыканию без запуска поиска
+    if (!network->getReachabilityIndex().mayReach(startStop, endStop, maxTransfers)) {
+        return;
+    }
+
+    Time initialTime = departureTime.value_or(Time());
+    push({startStop, initialTime, initialTime, {}, {}, 0, false, {}, 0, 0, 0});
+}
+
+void JourneyStream::assignKey(SearchNode& node) const {
+    if (node.pathTrips.empty()) {
+        node.primaryKey = -1;
+        node.secondaryKey = -1;
+        return;
+    }
+
+    int elapsed = node.currentTime - node.startTime;
+    switch (order) {
+        case JourneyOrder::ByArrival:
+            node.primaryKey = node.currentTime.getTotalMinutes();
+            node.secondaryKey = 0;
+            break;
+        case JourneyOrder::ByDuration:
+            node.primaryKey = elapsed;
+            node.secondaryKey = 0;
+            break;
+        case JourneyOrder::ByDeparture:
+            node.primaryKey = node.startTime.getTotalMinutes();
+            node.secondaryKey = elapsed;
+            break;
+    }
+}
+
+void JourneyStream::push(SearchNode node) {
+    assignKey(node);
+    node.sequence = nextSequence++;
+    frontier.push(std::move(node));
+}
+
+void JourneyStream::expand(const SearchNode& node) {
+    const auto& reachability = network->getReachabilityIndex();
+    const auto& timetable = network->getTimetableIndex();
+    int stopIndex = timetable.findStop(node.currentStop);
+    bool boarded = !node.pathTrips.empty();
+
+    // Пеший переход к соседней остановке: после поездки или в начале пути,
+    // если время отправления задано (иначе момент выхода не определен)
+    if (stopIndex != -1 && !node.justWalked && (boarded || departureTime)) {
+        int walkBudget = boarded ? maxTransfers - node.transfers - 1 : maxTransfers;
+        for (const auto& edge : timetable.getFootpathsFrom(stopIndex)) {
+            const std::string& walkStop = timetable.getStopName(edge.stop);
+            if (walkStop != endStop && !reachability.mayReach(walkStop, endStop, walkBudget)) {
+                continue;
+            }
+
+            SearchNode walkNode = node;
+            walkNode.currentStop = walkStop;
+            walkNode.currentTime = node.currentTime + edge.minutes;
+            walkNode.justWalked = true;
+            walkNode.walkedFrom = node.currentStop;
+            push(std::move(walkNode));
+        }
+    }
+
+    if (node.transfers >= maxTransfers) {
+        return;
+    }
+
+    // После высадки на той же остановке нужно выдержать минимальное время пересадки
+    Time readyTime = node.currentTime;
+    if (boarded && !node.justWalked && stopIndex != -1) {
+        readyTime = readyTime + timetable.getMinTransferTime(stopIndex);
+    }
+
+    auto trips = network->getTripsThroughStop(node.currentStop);
+
+    for (const auto& trip : trips) {
+        const auto& routeStops = trip->getRoute()->getAllStops();
+        int currentPos = trip->getRoute()->getStopPosition(node.currentStop);
+
+        if (currentPos == -1) continue;
+
+        Time arrivalAtStop = trip->getArrivalTimeAt(currentPos);
+
+        // Без заданного времени отправления первый рейс можно выбрать любой
+        if ((boarded || departureTime) && arrivalAtStop < readyTime) {
+            continue;
+        }
+
+        if (boarded && node.pathTrips.back() == trip) {
+            continue;
+        }
+
+        int childTransfers = boarded ? node.transfers + 1 : node.transfers;
+
+        for (size_t i = currentPos + 1; i < routeStops.size(); ++i) {
+            const std::string& nextStop = routeStops[i];
+            if (!trip->hasStopAt(i)) {
+                continue;
+            }
+            Time arrivalAtNext = trip->getArrivalTimeAt(i);
+
+            // Переходы назад во времени (через полночь) нарушили бы порядок выдачи
+            if (arrivalAtNext < arrivalAtStop) {
+                continue;
+            }
+
+            // Остановки, откуда цель недостижима оставшимся числом пересадок, не добавляются
+            if (nextStop != endStop &&
+                !reachability.mayReach(nextStop, endStop, maxTransfers - childTransfers - 1)) {
+                continue;
+            }
+
+            SearchNode nextNode = node;
+            nextNode.currentStop = nextStop;
+            nextNode.currentTime = arrivalAtNext;
+            nextNode.pathTrips.push_back(trip);
+            nextNode.transfers = childTransfers;
+            nextNode.justWalked = false;
+
+            if (!boarded && !departureTime) {
+                nextNode.startTime = arrivalAtStop;
+            }
+
+            if (boarded && node.justWalked) {
+                nextNode.transferPoints.push_back(node.walkedFrom + " → " + node.currentStop + " (пешком)");
+            } else if (boarded) {
+                nextNode.transferPoints.push_back(node.currentStop);
+            }
+
+            push(std::move(nextNode));
+        }
+    }
+}
+
+std::optional<Journey> JourneyStream::next() {
+    while (!frontier.empty()) {
+        SearchNode node = frontier.top();
+        frontier.pop();
+
+        if (node.currentStop == endStop) {
+            // Путь целиком пешком поездкой не считается
+            if (node.justWalked && node.pathTrips.empty()) {
+                continue;
+            }
+            return Journey(node.pathTrips, node.transferPoints, node.startTime, node.currentTime);
+        }
+
+        expand(node);
+    }
+    return std::nullopt;
+}
+
+std::vector<Journey> JourneyStream::take(size_t k) {
+    std::vector<Journey> result;
+    while (k == 0 || result.size() < k) {
+        auto journey = next();
+        if (!journey) {
+            break;
+        }
+        result.push_back(std::move(*journey));
+    }
+    return result;
+}
+
+JourneyStream::Iterator::Iterator(JourneyStream* s) : stream(s) {
+    if (stream) {
+        ++(*this);
+    }
+}
+
+JourneyStream::Iterator& JourneyStream::Iterator::operator++() {
+    current = stream->next();
+    if (!current) {
+        stream = nullptr;
+    }
+    return *this;
+}
+
+bool JourneyStream::Iterator::operator==(const Iterator& other) const {
+    return stream == other.stream;
+}
+
+JourneyStream::Iterator JourneyStream::begin() {
+    return Iterator(this);
+}
+
+JourneyStream::Iterator JourneyStream::end() {
+    return Iterator();
+}
@@ -0,0 +1,106 @@
+#ifndef JOURNEY_STREAM_H
+#define JOURNEY_STREAM_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <queue>
+#include <optional>
+#include <iterator>
+#include "journey.h"
+#include "time.h"
+#include "trip.h"
+
+class TransportSystem;
+class NetworkSnapshot;
+
+// Порядок, в котором поток выдает поездки
+enum class JourneyOrder {
+    ByArrival,   // по времени прибытия
+    ByDuration,  // по общей длительности
+    ByDeparture  // по времени отправления, затем по длительности
+};
+
+// Генератор поездок с пересадками (поиск "лучший-первый").
+// Вершины поиска извлекаются из очереди с приоритетом в порядке неубывания ключа,
+// поэтому каждая выданная поездка гарантированно лучше всех еще не найденных.
+// Поиск продолжается только при запросе следующей поездки и останавливается,
+// как только вызывающему коду достаточно результатов.
+// Между поездками учитывается минимальное время пересадки, а пешие переходы
+// к соседним остановкам пересадкой не считаются.
+// Поиск идет по снимку сети, взятому при создании потока: изменения сети,
+// внесенные между запросами следующих поездок, на результат не влияют.
+class JourneyStream {
+private:
+    struct SearchNode {
+        std::string currentStop;
+        Time currentTime;
+        Time startTime;
+        std::vector<std::shared_ptr<Trip>> pathTrips;
+        std::vector<std::string> transferPoints;
+        int transfers;
+        bool justWalked;         // последний шаг - пеший переход (подряд два не делаются)
+        std::string walkedFrom;  // откуда начат этот переход
+        int primaryKey;
+        int secondaryKey;
+        long long sequence; // порядок добавления для детерминированного выбора при равных ключах
+    };
+
+    struct NodeCompare {
+        bool operator()(const SearchNode& a, const SearchNode& b) const;
+    };
+
+    std::shared_ptr<const NetworkSnapshot> network;
+    std::string startStop;
+    std::string endStop;
+    std::optional<Time> departureTime;
+    JourneyOrder order;
+    int maxTransfers;
+    long long nextSequence = 0;
+    std::priority_queue<SearchNode, std::vector<SearchNode>, NodeCompare> frontier;
+
+    void assignKey(SearchNode& node) const;
+    void push(SearchNode node);
+    void expand(const SearchNode& node);
+
+public:
+    // departure не задано - поездка может начинаться любым рейсом через начальную остановку
+    JourneyStream(TransportSystem* sys,
+                  const std::string& start,
+                  const std::string& end,
+                  std::optional<Time> departure,
+                  JourneyOrder journeyOrder = JourneyOrder::ByArrival,
+                  int transfersLimit = 2);
+
+    // Следующая по порядку поездка или пустое значение, если поездок больше нет
+    std::optional<Journey> next();
+
+    // Первые k поездок (k = 0 - все)
+    std::vector<Journey> take(size_t k);
+
+    class Iterator {
+    private:
+        JourneyStream* stream;
+        std::optional<Journey> current;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Journey;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Journey*;
+        using reference = const Journey&;
+
+        explicit Iterator(JourneyStream* s = nullptr);
+
+        const Journey& operator*() const { return *current; }
+        const Journey* operator->() const { return &*current; }
+        Iterator& operator++();
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+    };
+
+    Iterator begin();
+    Iterator end();
+};
+
+#endif // JOURNEY_STREAM_H
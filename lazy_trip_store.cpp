@@ -0,0 +1,130 @@
+#include "lazy_trip_store.h"
+#include "exceptions.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+
+LazyTripStore::LazyTripStore(std::string tripsPath, TripFileStamp fileStamp,
+                             std::unordered_map<int, RouteEntry> routeEntries, LinkFunction linkFunction)
+    : path(std::move(tripsPath)), stamp(fileStamp), link(std::move(linkFunction)), entries(std::move(routeEntries)) {
+}
+
+const std::vector<std::pair<size_t, std::shared_ptr<Trip>>>& LazyTripStore::loadRouteUnlocked(int routeNumber) {
+    auto loadedIt = loaded.find(routeNumber);
+    if (loadedIt != loaded.end()) {
+        return loadedIt->second;
+    }
+
+    std::vector<std::pair<size_t, std::shared_ptr<Trip>>> trips;
+    auto entryIt = entries.find(routeNumber);
+    if (entryIt != entries.end()) {
+        // Участки индекса верны только для того же файла: файл того же размера,
+        // записанный позже, отличается временем изменения
+        std::error_code error;
+        if (std::filesystem::file_size(path, error) != stamp.size || error ||
+            std::filesystem::last_write_time(path, error) != stamp.modified || error) {
+            throw FileException("trips.txt", "файл изменен после загрузки индекса");
+        }
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw FileException("trips.txt", "открытие для чтения");
+        }
+
+        trips.reserve(entryIt->second.tripCount);
+        std::string buffer;
+        for (const auto& range : entryIt->second.ranges) {
+            buffer.resize(range.length);
+            file.seekg(static_cast<std::streamoff>(range.offset));
+            if (!file.read(buffer.data(), static_cast<std::streamsize>(range.length))) {
+                throw FileException("trips.txt", "чтение рейсов маршрута " + std::to_string(routeNumber));
+            }
+
+            std::string_view content(buffer);
+            size_t position = 0;
+            while (position < content.size()) {
+                size_t lineEnd = content.find('\n', position);
+                if (lineEnd == std::string_view::npos) {
+                    lineEnd = content.size();
+                }
+                std::string_view line = content.substr(position, lineEnd - position);
+                size_t lineOffset = range.offset + position;
+                position = lineEnd + 1;
+                if (line.empty()) {
+                    continue;
+                }
+                try {
+                    ParsedTrip parsed = Trip::parse(line, 2);
+                    trips.emplace_back(lineOffset, link(parsed));
+                } catch (const std::exception& e) {
+                    skippedLines++;
+                    std::cout << "trips.txt: пропущен рейс маршрута " << routeNumber
+                              << " (смещение " << lineOffset << "): " << e.what() << "\n";
+                }
+            }
+        }
+    }
+    return loaded.emplace(routeNumber, std::move(trips)).first->second;
+}
+
+std::vector<int> LazyTripStore::findRoutes(const std::function<bool(const Route&)>& predicate) const {
+    // Индекс не изменяется после создания, поэтому читается без блокировки
+    std::vector<int> result;
+    for (const auto& [number, entry] : entries) {
+        if (predicate(*entry.route)) {
+            result.push_back(number);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<std::shared_ptr<Trip>> LazyTripStore::getRouteTrips(int routeNumber) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::shared_ptr<Trip>> result;
+    for (const auto& [offset, trip] : loadRouteUnlocked(routeNumber)) {
+        result.push_back(trip);
+    }
+    return result;
+}
+
+std::vector<std::shared_ptr<Trip>> LazyTripStore::loadAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::pair<size_t, std::shared_ptr<Trip>>> all;
+    for (const auto& [number, entry] : entries) {
+        const auto& trips = loadRouteUnlocked(number);
+        all.insert(all.end(), trips.begin(), trips.end());
+    }
+    std::sort(all.begin(), all.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<std::shared_ptr<Trip>> result;
+    result.reserve(all.size());
+    for (auto& [offset, trip] : all) {
+        result.push_back(std::move(trip));
+    }
+    return result;
+}
+
+size_t LazyTripStore::tripCount() const {
+    size_t count = 0;
+    for (const auto& [number, entry] : entries) {
+        count += entry.tripCount;
+    }
+    return count;
+}
+
+size_t LazyTripStore::loadedRouteCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return loaded.size();
+}
+
+size_t LazyTripStore::routeCount() const {
+    return entries.size();
+}
+
+size_t LazyTripStore::skippedLineCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return skippedLines;
+}
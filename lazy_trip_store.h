@@ -0,0 +1,78 @@
+#ifndef LAZY_TRIP_STORE_H
+#define LAZY_TRIP_STORE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <cstddef>
+#include <filesystem>
+#include "trip.h"
+#include "route.h"
+
+// Участок trips.txt с подряд идущими строками рейсов одного маршрута
+struct TripFileRange {
+    size_t offset = 0;
+    size_t length = 0;
+};
+
+// Размер и время изменения trips.txt, для которых построен индекс
+struct TripFileStamp {
+    size_t size = 0;
+    std::filesystem::file_time_type modified;
+};
+
+// Рейсы trips.txt, разбираемые по маршрутам при первом обращении.
+// При загрузке читается только индекс trips.idx (маршрут -> участки файла);
+// строки рейсов маршрута разбираются, когда они впервые понадобились, и остаются в кэше.
+// Маршрут, транспорт и водители связываются с объектами, которые были в системе при загрузке,
+// поэтому результат совпадает с полной загрузкой файла.
+// Методы можно вызывать из разных потоков: маршрут разбирается один раз под общей блокировкой.
+// trips.txt не должен заменяться, пока в хранилище есть неразобранные маршруты: сохранение
+// сначала разбирает все рейсы, а при наблюдении за файлами хранилище не используется.
+// Замененный файл обнаруживается по размеру и времени изменения (FileException).
+class LazyTripStore {
+public:
+    // Связывает разобранную строку с объектами системы (бросает исключение, если не удалось)
+    using LinkFunction = std::function<std::shared_ptr<Trip>(ParsedTrip&)>;
+
+    struct RouteEntry {
+        std::shared_ptr<Route> route; // маршрут системы на момент загрузки
+        size_t tripCount = 0;
+        std::vector<TripFileRange> ranges;
+    };
+
+private:
+    std::string path;
+    TripFileStamp stamp;
+    LinkFunction link;
+
+    mutable std::mutex mutex;
+    std::unordered_map<int, RouteEntry> entries;
+    // Разобранные рейсы маршрута вместе со смещением строки (для восстановления порядка файла)
+    std::unordered_map<int, std::vector<std::pair<size_t, std::shared_ptr<Trip>>>> loaded;
+    size_t skippedLines = 0;
+
+    const std::vector<std::pair<size_t, std::shared_ptr<Trip>>>& loadRouteUnlocked(int routeNumber);
+
+public:
+    LazyTripStore(std::string tripsPath, TripFileStamp fileStamp,
+                  std::unordered_map<int, RouteEntry> routeEntries, LinkFunction linkFunction);
+
+    // Номера маршрутов индекса, для маршрутов которых выполняется условие
+    std::vector<int> findRoutes(const std::function<bool(const Route&)>& predicate) const;
+    // Рейсы маршрута в порядке файла; при первом обращении маршрут разбирается
+    std::vector<std::shared_ptr<Trip>> getRouteTrips(int routeNumber);
+    // Разбирает все маршруты и возвращает все рейсы в порядке файла
+    std::vector<std::shared_ptr<Trip>> loadAll();
+
+    size_t tripCount() const;
+    size_t loadedRouteCount() const;
+    size_t routeCount() const;
+    size_t skippedLineCount() const;
+};
+
+#endif // LAZY_TRIP_STORE_H
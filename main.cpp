@@ -20,23 +20,34 @@ int main() {
     try {
         TransportSystem system;
 
+        // Рейсы маршрута разбираются при первом обращении - запуск не зависит от их числа
+        system.setLazyTripLoading(true);
         system.loadData();
 
         // Если данных нет вообще (файлы не существуют или пустые), инициализируем тестовые данные
         // Но только если ВСЕ категории пустые, чтобы не добавлять дубликаты
         if (system.getStops().empty() && system.getDrivers().empty() && 
             system.getVehicles().empty() && system.getRoutes().empty() && 
-            system.getTrips().empty()) {
+            system.getTripCount() == 0) {
             std::cout << "Инициализация тестовых данных...\n";
             initializeTestData(system);
-            // Сохраняем сразу после инициализации
-            system.saveData();
+            // Сохраняем сразу после инициализации полностью, а не только в журнал
+            system.compactData();
         }
 
         int choice;
         bool running = true;
 
+        // Файлы, замененные извне, подхватываются без перезапуска
+        system.startHotReload();
+        // Оперативные задержки и отмены из data/realtime.txt (файл или именованный канал)
+        system.startRealtimeFeed();
+
         while (running) {
+            system.applyPendingReload();
+            system.applyRealtimeUpdates();
+            // Запросы следующей команды идут по снимку с результатом предыдущей
+            system.publishSnapshot();
             displayLoginMenu();
             if (!(std::cin >> choice)) {
                 std::cin.clear();
@@ -59,6 +70,9 @@ int main() {
         }
         
         system.saveData();
+        // Фоновая запись должна завершиться до выхода
+        system.waitForSave();
+        system.reportSaveStatus();
 
     } catch (const InputException& e) {
         std::cerr << "Критическая ошибка ввода: " << e.what() << std::endl;
@@ -0,0 +1,158 @@
+#include "network_snapshot.h"
+#include <algorithm>
+
+NetworkSnapshot::NetworkSnapshot(Contents contents)
+    : contentVersion(contents.contentVersion),
+      networkVersion(contents.networkVersion),
+      routes(std::move(contents.routes)),
+      trips(std::move(contents.trips)),
+      lazyTrips(std::move(contents.lazyTrips)),
+      stops(std::move(contents.stops)),
+      stopIdToName(std::move(contents.stopIdToName)),
+      transferNetwork(std::move(contents.transferNetwork)),
+      segmentTable(std::move(contents.segmentTable)),
+      reachabilityTransfers(contents.reachabilityTransfers),
+      timetableIndex(std::move(contents.timetableIndex)),
+      reachabilityIndex(std::move(contents.reachabilityIndex)) {
+    if (!lazyTrips) {
+        allTrips.store(std::make_shared<const std::vector<std::shared_ptr<Trip>>>(trips));
+    }
+}
+
+unsigned long long NetworkSnapshot::getContentVersion() const {
+    return contentVersion;
+}
+
+unsigned long long NetworkSnapshot::getNetworkVersion() const {
+    return networkVersion;
+}
+
+const std::vector<std::shared_ptr<Route>>& NetworkSnapshot::getRoutes() const {
+    return routes;
+}
+
+std::shared_ptr<Route> NetworkSnapshot::findRoute(int number) const {
+    for (const auto& route : routes) {
+        if (route->getNumber() == number) {
+            return route;
+        }
+    }
+    return nullptr;
+}
+
+const std::vector<std::shared_ptr<Trip>>& NetworkSnapshot::getTrips() const {
+    // Указатель на готовый список живет, пока жив снимок: он заменяется только с пустого
+    if (auto ready = allTrips.load(std::memory_order_acquire)) {
+        return *ready;
+    }
+    std::lock_guard<std::mutex> lock(buildMutex);
+    if (!allTrips.load(std::memory_order_acquire)) {
+        // Отложенные рейсы идут в файле раньше добавленных после загрузки
+        auto all = std::make_shared<std::vector<std::shared_ptr<Trip>>>(lazyTrips->loadAll());
+        all->insert(all->end(), trips.begin(), trips.end());
+        allTrips.store(std::move(all), std::memory_order_release);
+    }
+    return *allTrips.load(std::memory_order_acquire);
+}
+
+std::shared_ptr<Trip> NetworkSnapshot::findTrip(int tripId) const {
+    const auto& all = getTrips();
+    auto it = std::find_if(all.begin(), all.end(), [tripId](const auto& t) { return t->getTripId() == tripId; });
+    return it != all.end() ? *it : nullptr;
+}
+
+std::vector<std::shared_ptr<Trip>> NetworkSnapshot::collectTrips(
+    const std::function<bool(const Route&)>& routeFilter,
+    const std::function<bool(const Trip&)>& tripFilter) const {
+    std::vector<std::shared_ptr<Trip>> result;
+    if (lazyTrips && !allTrips.load(std::memory_order_acquire)) {
+        for (int routeNumber : lazyTrips->findRoutes(routeFilter)) {
+            for (auto& trip : lazyTrips->getRouteTrips(routeNumber)) {
+                if (tripFilter(*trip)) {
+                    result.push_back(std::move(trip));
+                }
+            }
+        }
+        for (const auto& trip : trips) {
+            if (tripFilter(*trip)) {
+                result.push_back(trip);
+            }
+        }
+        return result;
+    }
+    for (const auto& trip : getTrips()) {
+        if (tripFilter(*trip)) {
+            result.push_back(trip);
+        }
+    }
+    return result;
+}
+
+std::vector<std::shared_ptr<Trip>> NetworkSnapshot::getTripsThroughStop(const std::string& stopName) const {
+    // Отложенные рейсы записаны ссылкой на маршрут и останавливаются только на его остановках
+    return collectTrips(
+        [&stopName](const Route& route) {
+            const auto& routeStops = route.getAllStops();
+            return std::find(routeStops.begin(), routeStops.end(), stopName) != routeStops.end();
+        },
+        [&stopName](const Trip& trip) { return trip.hasStop(stopName); });
+}
+
+std::vector<std::shared_ptr<Trip>> NetworkSnapshot::getTripsByVehicleType(const std::string& vehicleType) const {
+    return collectTrips(
+        [&vehicleType](const Route& route) { return route.getVehicleType() == vehicleType; },
+        [&vehicleType](const Trip& trip) { return trip.getRoute()->getVehicleType() == vehicleType; });
+}
+
+const DynamicArray<Stop>& NetworkSnapshot::getStops() const {
+    return stops;
+}
+
+std::string NetworkSnapshot::getStopNameById(int id) const {
+    auto it = stopIdToName.find(id);
+    return it != stopIdToName.end() ? it->second : "";
+}
+
+const TransferNetwork& NetworkSnapshot::getTransferNetwork() const {
+    return transferNetwork;
+}
+
+const SegmentTable& NetworkSnapshot::getSegmentTable() const {
+    return *segmentTable;
+}
+
+const TimetableIndex& NetworkSnapshot::getTimetableIndex() const {
+    if (auto ready = timetableIndex.load(std::memory_order_acquire)) {
+        return *ready;
+    }
+    const auto& all = getTrips();
+    std::lock_guard<std::mutex> lock(buildMutex);
+    if (!timetableIndex.load(std::memory_order_acquire)) {
+        auto index = std::make_shared<TimetableIndex>();
+        index->build(all, stops, transferNetwork);
+        timetableIndex.store(std::move(index), std::memory_order_release);
+    }
+    return *timetableIndex.load(std::memory_order_acquire);
+}
+
+const ReachabilityIndex& NetworkSnapshot::getReachabilityIndex() const {
+    if (auto ready = reachabilityIndex.load(std::memory_order_acquire)) {
+        return *ready;
+    }
+    const TimetableIndex& timetable = getTimetableIndex();
+    std::lock_guard<std::mutex> lock(buildMutex);
+    if (!reachabilityIndex.load(std::memory_order_acquire)) {
+        auto index = std::make_shared<ReachabilityIndex>();
+        index->build(timetable, reachabilityTransfers);
+        reachabilityIndex.store(std::move(index), std::memory_order_release);
+    }
+    return *reachabilityIndex.load(std::memory_order_acquire);
+}
+
+std::shared_ptr<const TimetableIndex> NetworkSnapshot::builtTimetableIndex() const {
+    return timetableIndex.load(std::memory_order_acquire);
+}
+
+std::shared_ptr<const ReachabilityIndex> NetworkSnapshot::builtReachabilityIndex() const {
+    return reachabilityIndex.load(std::memory_order_acquire);
+}
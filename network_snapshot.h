@@ -0,0 +1,98 @@
+#ifndef NETWORK_SNAPSHOT_H
+#define NETWORK_SNAPSHOT_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include "dynamic_array.h"
+#include "stop.h"
+#include "route.h"
+#include "trip.h"
+#include "transfer_network.h"
+#include "segment_table.h"
+#include "timetable.h"
+#include "reachability.h"
+#include "lazy_trip_store.h"
+
+// Неизменяемый снимок сети для запросов. TransportSystem публикует новый снимок
+// атомарной заменой указателя после изменения сети (см. TransportSystem::getSnapshot);
+// запрос держит свой снимок до конца, поэтому правки администратора в это время
+// его не затрагивают, а прежний снимок освобождается с последним запросом.
+// Объекты маршрутов и рейсов общие с системой: они не изменяются на месте.
+// Индексы расписания и достижимости передаются системой, если они актуальны,
+// иначе строятся при первом обращении один раз; готовый индекс читается без блокировок.
+// Все методы можно вызывать из разных потоков.
+class NetworkSnapshot {
+private:
+    unsigned long long contentVersion;
+    unsigned long long networkVersion;
+    std::vector<std::shared_ptr<Route>> routes;
+    std::vector<std::shared_ptr<Trip>> trips;
+    // Рейсы trips.txt, еще не разобранные системой (кэш общий и потокобезопасный)
+    std::shared_ptr<LazyTripStore> lazyTrips;
+    DynamicArray<Stop> stops;
+    std::unordered_map<int, std::string> stopIdToName;
+    TransferNetwork transferNetwork;
+    std::shared_ptr<const SegmentTable> segmentTable;
+    int reachabilityTransfers;
+
+    mutable std::mutex buildMutex; // только для однократного построения ленивых частей
+    mutable std::atomic<std::shared_ptr<const std::vector<std::shared_ptr<Trip>>>> allTrips;
+    mutable std::atomic<std::shared_ptr<const TimetableIndex>> timetableIndex;
+    mutable std::atomic<std::shared_ptr<const ReachabilityIndex>> reachabilityIndex;
+
+    std::vector<std::shared_ptr<Trip>> collectTrips(const std::function<bool(const Route&)>& routeFilter,
+                                                    const std::function<bool(const Trip&)>& tripFilter) const;
+
+public:
+    struct Contents {
+        unsigned long long contentVersion = 0;
+        unsigned long long networkVersion = 0;
+        std::vector<std::shared_ptr<Route>> routes;
+        std::vector<std::shared_ptr<Trip>> trips;
+        std::shared_ptr<LazyTripStore> lazyTrips;
+        DynamicArray<Stop> stops;
+        std::unordered_map<int, std::string> stopIdToName;
+        TransferNetwork transferNetwork;
+        std::shared_ptr<const SegmentTable> segmentTable;
+        std::shared_ptr<const TimetableIndex> timetableIndex;       // пусто - построить при обращении
+        std::shared_ptr<const ReachabilityIndex> reachabilityIndex; // пусто - построить при обращении
+        int reachabilityTransfers = 2;
+    };
+
+    explicit NetworkSnapshot(Contents contents);
+
+    NetworkSnapshot(const NetworkSnapshot&) = delete;
+    NetworkSnapshot& operator=(const NetworkSnapshot&) = delete;
+
+    // Номер состояния, с которого сделан снимок (растет при каждом изменении данных снимка)
+    unsigned long long getContentVersion() const;
+    // Версия сети системы (без учета задержек рейсов): от нее зависит замыкание достижимости
+    unsigned long long getNetworkVersion() const;
+
+    const std::vector<std::shared_ptr<Route>>& getRoutes() const;
+    std::shared_ptr<Route> findRoute(int number) const;
+    // Все рейсы (отложенные разбираются при первом обращении)
+    const std::vector<std::shared_ptr<Trip>>& getTrips() const;
+    std::shared_ptr<Trip> findTrip(int tripId) const;
+    // Без разбора всех отложенных рейсов: читаются только подходящие маршруты
+    std::vector<std::shared_ptr<Trip>> getTripsThroughStop(const std::string& stopName) const;
+    std::vector<std::shared_ptr<Trip>> getTripsByVehicleType(const std::string& vehicleType) const;
+
+    const DynamicArray<Stop>& getStops() const;
+    std::string getStopNameById(int id) const;
+    const TransferNetwork& getTransferNetwork() const;
+    const SegmentTable& getSegmentTable() const;
+
+    const TimetableIndex& getTimetableIndex() const;
+    const ReachabilityIndex& getReachabilityIndex() const;
+    // Уже построенные индексы (пусто, если к ним еще не обращались) - для передачи системе
+    std::shared_ptr<const TimetableIndex> builtTimetableIndex() const;
+    std::shared_ptr<const ReachabilityIndex> builtReachabilityIndex() const;
+};
+
+#endif // NETWORK_SNAPSHOT_H
@@ -0,0 +1,36 @@
+#ifndef NETWORK_STATE_H
+#define NETWORK_STATE_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include "dynamic_array.h"
+#include "stop.h"
+#include "route.h"
+#include "trip.h"
+#include "vehicle.h"
+#include "driver.h"
+#include "transfer_network.h"
+#include "timetable.h"
+#include "segment_table.h"
+
+// Копия данных сети на момент запроса сохранения.
+// Объекты маршрутов, рейсов, транспорта и водителей не изменяются на месте
+// (изменение рейса создает новый объект), поэтому копируются только указатели,
+// и копию можно читать в фоновом потоке, пока основная система продолжает меняться.
+struct NetworkState {
+    std::vector<std::shared_ptr<Route>> routes;
+    std::vector<std::shared_ptr<Trip>> trips;
+    std::vector<std::shared_ptr<Vehicle>> vehicles;
+    std::vector<std::shared_ptr<Driver>> drivers;
+    DynamicArray<Stop> stops;
+    std::unordered_map<std::string, std::string> adminCredentials;
+    TransferNetwork transferNetwork;
+    // Таблица перегонов только читается, поэтому копия делит ее с системой
+    std::shared_ptr<const SegmentTable> segmentTable;
+    // Индекс перегонов, если он актуален на момент копирования; иначе строится при записи
+    std::shared_ptr<const TimetableIndex> timetableIndex;
+};
+
+#endif // NETWORK_STATE_H
@@ -0,0 +1,170 @@
+#include "reachability.h"
+#include "timetable.h"
+#include <set>
+#include <bit>
+#include <utility>
+#include <algorithm>
+
+uint64_t* ReachabilityIndex::row(int day, int stop) {
+    return closure.data() + (static_cast<size_t>(day) * stopCount + stop) * wordsPerRow;
+}
+
+const uint64_t* ReachabilityIndex::row(int day, int stop) const {
+    return closure.data() + (static_cast<size_t>(day) * stopCount + stop) * wordsPerRow;
+}
+
+void ReachabilityIndex::build(const TimetableIndex& timetable, int transfers) {
+    maxTransfers = std::max(0, transfers);
+    stopCount = timetable.getStopCount();
+    wordsPerRow = (static_cast<size_t>(stopCount) + 63) / 64;
+
+    stopIndex.clear();
+    for (int s = 0; s < stopCount; ++s) {
+        stopIndex.emplace(timetable.getStopName(s), s);
+    }
+
+    // Прямая достижимость (без пересадок): с каждой остановки рейса
+    // можно доехать до всех следующих остановок того же рейса
+    closure.assign(static_cast<size_t>(DAY_SLOTS) * stopCount * wordsPerRow, 0);
+    std::set<std::pair<const Route*, int>> fullPatterns;
+    std::vector<int> sequence;
+    std::vector<uint64_t> suffix(wordsPerRow);
+
+    for (int t = 0; t < timetable.getTripCount(); ++t) {
+        auto trip = timetable.getTrip(t);
+        const auto& routeStops = trip->getRoute()->getAllStops();
+        int day = trip->getWeekDay();
+
+        sequence.clear();
+        for (size_t i = 0; i < routeStops.size(); ++i) {
+            if (trip->hasStopAt(i)) {
+                sequence.push_back(timetable.findStop(routeStops[i]));
+            }
+        }
+
+        // Рейсы одного маршрута с полным расписанием дают одинаковые множества
+        if (sequence.size() == routeStops.size() &&
+            !fullPatterns.insert({trip->getRoute().get(), day}).second) {
+            continue;
+        }
+
+        std::fill(suffix.begin(), suffix.end(), 0);
+        for (auto it = sequence.rbegin(); it != sequence.rend(); ++it) {
+            int stop = *it;
+            uint64_t* dayRow = row(day, stop);
+            uint64_t* anyRow = row(0, stop);
+            for (size_t w = 0; w < wordsPerRow; ++w) {
+                dayRow[w] |= suffix[w];
+                anyRow[w] |= suffix[w];
+            }
+            suffix[stop / 64] |= uint64_t(1) << (stop % 64);
+        }
+    }
+
+    // Пешие переходы до и после поездки: direct[s] = W(R0(W(s))), где W - шаг пешком или на месте
+    walkable.assign(static_cast<size_t>(stopCount) * wordsPerRow, 0);
+    bool hasWalks = false;
+    for (int s = 0; s < stopCount; ++s) {
+        for (const auto& edge : timetable.getFootpathsFrom(s)) {
+            walkable[s * wordsPerRow + edge.stop / 64] |= uint64_t(1) << (edge.stop % 64);
+            hasWalks = true;
+        }
+    }
+    if (hasWalks) {
+        auto orRows = [this](uint64_t* target, const uint64_t* source) {
+            for (size_t w = 0; w < wordsPerRow; ++w) {
+                target[w] |= source[w];
+            }
+        };
+        auto forEachBit = [this](const uint64_t* bits, auto&& visit) {
+            for (size_t w = 0; w < wordsPerRow; ++w) {
+                uint64_t word = bits[w];
+                while (word) {
+                    visit(static_cast<int>(w * 64) + std::countr_zero(word));
+                    word &= word - 1;
+                }
+            }
+        };
+
+        std::vector<uint64_t> rideThenWalk = closure;
+        for (int day = 0; day < DAY_SLOTS; ++day) {
+            for (int s = 0; s < stopCount; ++s) {
+                uint64_t* target = rideThenWalk.data() + (static_cast<size_t>(day) * stopCount + s) * wordsPerRow;
+                forEachBit(row(day, s), [&](int t) {
+                    orRows(target, walkable.data() + t * wordsPerRow);
+                });
+            }
+        }
+        closure = rideThenWalk;
+        for (int day = 0; day < DAY_SLOTS; ++day) {
+            for (int s = 0; s < stopCount; ++s) {
+                uint64_t* target = row(day, s);
+                forEachBit(walkable.data() + s * wordsPerRow, [&](int t) {
+                    orRows(target, rideThenWalk.data() + (static_cast<size_t>(day) * stopCount + t) * wordsPerRow);
+                });
+            }
+        }
+    }
+
+    // Замыкание: на каждом уровне добавляется еще одна поездка (одна пересадка)
+    const std::vector<uint64_t> direct = closure;
+    std::vector<uint64_t> next;
+    for (int level = 0; level < maxTransfers; ++level) {
+        next = closure;
+        for (int day = 0; day < DAY_SLOTS; ++day) {
+            for (int s = 0; s < stopCount; ++s) {
+                const uint64_t* current = row(day, s);
+                uint64_t* target = next.data() + (static_cast<size_t>(day) * stopCount + s) * wordsPerRow;
+                for (size_t w = 0; w < wordsPerRow; ++w) {
+                    uint64_t bits = current[w];
+                    while (bits) {
+                        int t = static_cast<int>(w * 64) + std::countr_zero(bits);
+                        bits &= bits - 1;
+                        const uint64_t* reach = direct.data() +
+                            (static_cast<size_t>(day) * stopCount + t) * wordsPerRow;
+                        for (size_t k = 0; k < wordsPerRow; ++k) {
+                            target[k] |= reach[k];
+                        }
+                    }
+                }
+            }
+        }
+        closure.swap(next);
+    }
+}
+
+int ReachabilityIndex::getMaxTransfers() const {
+    return maxTransfers;
+}
+
+bool ReachabilityIndex::mayReach(const std::string& from, const std::string& to,
+                                 int transfers, int weekDay) const {
+    if (from == to) {
+        return true;
+    }
+    auto fromIt = stopIndex.find(from);
+    auto toIt = stopIndex.find(to);
+    if (fromIt == stopIndex.end() || toIt == stopIndex.end()) {
+        // Через неизвестную остановку не проходит ни один рейс
+        return false;
+    }
+    return mayReach(fromIt->second, toIt->second, transfers, weekDay);
+}
+
+bool ReachabilityIndex::mayReach(int from, int to, int transfers, int weekDay) const {
+    if (from == to || transfers > maxTransfers) {
+        return true;
+    }
+    if (from < 0 || to < 0 || from >= stopCount || to >= stopCount ||
+        weekDay < 0 || weekDay >= DAY_SLOTS) {
+        return false;
+    }
+    if ((walkable[from * wordsPerRow + to / 64] >> (to % 64)) & 1) {
+        return true;
+    }
+    if (transfers < 0) {
+        // Пересадок больше не осталось, а дойти пешком нельзя
+        return false;
+    }
+    return (row(weekDay, from)[to / 64] >> (to % 64)) & 1;
+}
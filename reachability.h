@@ -0,0 +1,44 @@
+#ifndef REACHABILITY_H
+#define REACHABILITY_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+class TimetableIndex;
+
+// Предрассчитанное транзитивное замыкание достижимости остановок.
+// Для каждого дня недели и каждой остановки хранится битовое множество остановок,
+// до которых можно доехать не более чем с maxTransfers пересадками (без учета времени).
+// Если остановка не входит в множество, маршрута между ними гарантированно нет,
+// и поиск можно не запускать. Пешие переходы пересадкой не считаются
+// и допускаются в начале, в конце и между поездками.
+class ReachabilityIndex {
+private:
+    static const int DAY_SLOTS = 8; // 0 - любой день, 1..7 - дни недели
+
+    std::unordered_map<std::string, int> stopIndex;
+    int stopCount = 0;
+    size_t wordsPerRow = 0;
+    int maxTransfers = 0;
+    std::vector<uint64_t> closure; // [день][остановка][слово]
+    std::vector<uint64_t> walkable; // [остановка][слово] - пешие переходы, не зависят от дня
+
+    uint64_t* row(int day, int stop);
+    const uint64_t* row(int day, int stop) const;
+
+public:
+    void build(const TimetableIndex& timetable, int transfers);
+
+    int getMaxTransfers() const;
+
+    // false означает, что маршрута с не более чем transfers пересадками точно нет.
+    // Если transfers больше глубины замыкания, ответ всегда true (проверка невозможна),
+    // при отрицательном transfers достижимы только сама остановка и соседние пешком.
+    bool mayReach(const std::string& from, const std::string& to,
+                  int transfers, int weekDay = 0) const;
+    bool mayReach(int from, int to, int transfers, int weekDay = 0) const;
+};
+
+#endif // REACHABILITY_H
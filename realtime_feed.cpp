@@ -0,0 +1,295 @@
+#include "realtime_feed.h"
+#include "text_parser.h"
+#include "exceptions.h"
+#include "trip.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+RealtimeFeed::RealtimeFeed(std::string sourcePath) : source(std::move(sourcePath)) {}
+
+RealtimeFeed::~RealtimeFeed() {
+    stop();
+}
+
+void RealtimeFeed::start(std::chrono::milliseconds pollInterval) {
+    stop();
+    std::lock_guard<std::mutex> lock(mutex);
+    interval = pollInterval;
+    stopping = false;
+    worker = std::thread(&RealtimeFeed::run, this);
+}
+
+void RealtimeFeed::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (!worker.joinable()) {
+        return;
+    }
+#ifndef _WIN32
+    // Поток может ждать пишущую сторону канала: пустое открытие на запись его отпускает.
+    // Без читателя открытие сразу завершается ошибкой, и тогда будить некого
+    std::error_code error;
+    if (std::filesystem::is_fifo(source, error)) {
+        int descriptor = ::open(source.c_str(), O_WRONLY | O_NONBLOCK);
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+    }
+#endif
+    worker.join();
+}
+
+bool RealtimeFeed::isRunning() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return worker.joinable() && !stopping;
+}
+
+const std::string& RealtimeFeed::getSource() const {
+    return source;
+}
+
+std::shared_ptr<const RealtimeOverlay> RealtimeFeed::current() const {
+    return overlay.load(std::memory_order_acquire);
+}
+
+RealtimeFeedStats RealtimeFeed::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void RealtimeFeed::recordMerge(const RealtimeOverlay& merged, double microseconds, size_t rejected,
+                               const std::string& error) {
+    const double lag = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - merged.receivedAt).count();
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.mergedBatch = merged.batch;
+    stats.rejected += rejected;
+    if (!error.empty()) {
+        stats.lastError = error;
+    }
+    stats.lastMergeMicroseconds = microseconds;
+    stats.lastLagMilliseconds = lag;
+    stats.maxLagMilliseconds = std::max(stats.maxLagMilliseconds, lag);
+    stats.lastSourceLagMilliseconds =
+        merged.hasSourceTime
+            ? std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - merged.sourceTime).count()
+            : -1.0;
+}
+
+void RealtimeFeed::run() {
+    namespace fs = std::filesystem;
+    std::string partial;     // строка без перевода строки в конце прочитанных данных
+    std::uintmax_t position = 0;
+    Batch batch;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        lock.unlock();
+        std::error_code error;
+        if (fs::is_fifo(source, error)) {
+            // Открытие ждет пишущую сторону; данные читаются до ее закрытия
+            std::ifstream input(source, std::ios::binary);
+            while (input && readAvailable(input, partial, batch)) {
+                std::lock_guard<std::mutex> stopLock(mutex);
+                if (stopping) {
+                    break;
+                }
+            }
+            if (!partial.empty()) {
+                // Пишущая сторона закрыла канал: последняя строка завершена
+                batch.lines.push_back(std::move(partial));
+                partial.clear();
+            }
+            publish(batch);
+            lock.lock();
+            continue;
+        }
+
+        std::uintmax_t size = fs::file_size(source, error);
+        if (!error) {
+            if (size < position) {
+                // Файл заменен более коротким: читается с начала
+                position = 0;
+                partial.clear();
+            }
+            if (size > position) {
+                std::ifstream input(source, std::ios::binary);
+                input.seekg(static_cast<std::streamoff>(position));
+                const std::uintmax_t before = position;
+                std::string chunk(static_cast<size_t>(size - before), '\0');
+                input.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+                chunk.resize(static_cast<size_t>(input.gcount()));
+                position = before + chunk.size();
+                std::istringstream lines(chunk);
+                while (readAvailable(lines, partial, batch)) {
+                }
+                publish(batch);
+            }
+        }
+        lock.lock();
+        wake.wait_for(lock, interval, [this] { return stopping; });
+    }
+}
+
+bool RealtimeFeed::readAvailable(std::istream& input, std::string& partial, Batch& batch) {
+    std::string line;
+    if (!std::getline(input, line)) {
+        return false;
+    }
+    if (input.eof()) {
+        // Строка еще дописывается
+        partial += line;
+        return false;
+    }
+    if (!partial.empty()) {
+        line = partial + line;
+        partial.clear();
+    }
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    if (line.empty()) {
+        publish(batch);
+        return true;
+    }
+    if (batch.lines.empty() && !batch.hasSourceTime) {
+        batch.receivedAt = std::chrono::steady_clock::now();
+    }
+    if (line.rfind("batch|", 0) == 0) {
+        publish(batch);
+        batch.receivedAt = std::chrono::steady_clock::now();
+        try {
+            long long milliseconds = std::stoll(line.substr(6));
+            batch.sourceTime = std::chrono::system_clock::time_point(std::chrono::milliseconds(milliseconds));
+            batch.hasSourceTime = true;
+        } catch (const std::exception&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.rejected++;
+            stats.lastError = "Некорректное время пакета: " + line;
+        }
+        return true;
+    }
+    batch.lines.push_back(std::move(line));
+    // Строки пакета читаются не дольше одного опроса
+    if (std::chrono::steady_clock::now() - batch.receivedAt >= interval) {
+        publish(batch);
+    }
+    return true;
+}
+
+void RealtimeFeed::publish(Batch& batch) {
+    if (batch.lines.empty()) {
+        batch.hasSourceTime = false;
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    // Пишет только этот поток, поэтому между чтением и заменой копия не устаревает
+    auto previous = overlay.load(std::memory_order_acquire);
+    auto next = previous ? std::make_shared<RealtimeOverlay>(*previous) : std::make_shared<RealtimeOverlay>();
+    next->batch++;
+    next->receivedAt = batch.receivedAt;
+    next->sourceTime = batch.sourceTime;
+    next->hasSourceTime = batch.hasSourceTime;
+
+    size_t applied = 0;
+    size_t rejected = 0;
+    std::string lastError;
+    for (const auto& line : batch.lines) {
+        try {
+            applyLine(line, next->batch, *next);
+            applied++;
+        } catch (const std::exception& e) {
+            rejected++;
+            lastError = std::string(e.what()) + ": " + line;
+        }
+    }
+    overlay.store(std::move(next), std::memory_order_release);
+    const double microseconds =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    batch.lines.clear();
+    batch.hasSourceTime = false;
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.batches++;
+    stats.updates += applied;
+    stats.rejected += rejected;
+    if (!lastError.empty()) {
+        stats.lastError = std::move(lastError);
+    }
+    stats.lastApplyMicroseconds = microseconds;
+    stats.maxApplyMicroseconds = std::max(stats.maxApplyMicroseconds, microseconds);
+}
+
+void RealtimeFeed::applyLine(std::string_view line, unsigned long long batchNumber, RealtimeOverlay& next) {
+    FieldTokenizer fields(line, '|');
+    std::string_view kind;
+    fields.next(kind);
+    kind = trimField(kind);
+
+    // Состояние рейса копируется: прежнюю копию могут читать другие потоки
+    auto modify = [&next, batchNumber](int tripId) {
+        auto it = next.trips.find(tripId);
+        auto state = it != next.trips.end() ? std::make_shared<RealtimeTripState>(*it->second)
+                                            : std::make_shared<RealtimeTripState>();
+        state->batch = batchNumber;
+        next.trips[tripId] = state;
+        return state;
+    };
+
+    if (kind == "delay") {
+        // delay|ID рейса|остановка|минут[|нагон на остановку]
+        std::string_view idField, stopField, minutesField, recoveryField;
+        if (!fields.next(idField) || !fields.next(stopField) || !fields.next(minutesField)) {
+            throw InputException("Недостаточно полей задержки");
+        }
+        int tripId = parseIntField(idField);
+        int minutes = parseIntField(minutesField);
+        int recovery = -1;
+        if (fields.next(recoveryField) && !trimField(recoveryField).empty()) {
+            recovery = parseIntField(recoveryField);
+            if (recovery < 0) {
+                throw InputException("Нагон задержки не может быть отрицательным");
+            }
+        }
+        auto state = modify(tripId);
+        state->delayed = true;
+        state->stop = std::string(trimField(stopField));
+        state->delayMinutes = minutes;
+        state->recoveryMinutes = recovery;
+        return;
+    }
+
+    if (kind == "cancel") {
+        // cancel|ID рейса
+        std::string_view idField;
+        if (!fields.next(idField)) {
+            throw InputException("Не указан рейс для отмены");
+        }
+        auto state = modify(parseIntField(idField));
+        state->cancelled = true;
+        state->delayed = false;
+        return;
+    }
+
+    if (kind == "trip") {
+        // trip|строка рейса в формате журнала; рейс добавляется или заменяет прежний
+        const std::string_view payload = fields.rest();
+        ParsedTrip parsed = Trip::parse(payload, 2);
+        auto state = modify(parsed.tripId);
+        state->cancelled = false;
+        state->delayed = false;
+        state->addedTrip = std::string(payload);
+        return;
+    }
+
+    throw InputException("Неизвестный вид обновления: " + std::string(kind));
+}
@@ -0,0 +1,106 @@
+#ifndef REALTIME_FEED_H
+#define REALTIME_FEED_H
+
+#include <string>
+#include <string_view>
+#include <iosfwd>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <unordered_map>
+
+// Оперативное состояние одного рейса по данным потока обновлений
+struct RealtimeTripState {
+    unsigned long long batch = 0; // пакет, в котором состояние изменилось последним
+    bool cancelled = false;
+    std::string addedTrip;        // строка рейса в формате журнала (trip|...); пусто - рейс из расписания
+    bool delayed = false;
+    std::string stop;             // остановка, на которой известна задержка
+    int delayMinutes = 0;
+    int recoveryMinutes = -1;     // нагон на следующих остановках; -1 - значение системы
+};
+
+// Накопленные оперативные данные. После публикации не изменяются: пакет применяется
+// к копии (копируются только указатели на состояния рейсов), и копия заменяет
+// прежнюю одной атомарной операцией. Читатели не берут блокировок
+struct RealtimeOverlay {
+    unsigned long long batch = 0; // номер последнего примененного пакета
+    std::unordered_map<int, std::shared_ptr<const RealtimeTripState>> trips;
+    std::chrono::steady_clock::time_point receivedAt;   // прочитан последний пакет
+    std::chrono::system_clock::time_point sourceTime;   // время из заголовка пакета (если было)
+    bool hasSourceTime = false;
+};
+
+struct RealtimeFeedStats {
+    size_t batches = 0;
+    size_t updates = 0;
+    size_t rejected = 0;                  // строк с ошибками и обновлений, не примененных к сети
+    double lastApplyMicroseconds = 0.0;   // построение и публикация копии в потоке чтения
+    double maxApplyMicroseconds = 0.0;
+    unsigned long long mergedBatch = 0;   // последний пакет, перенесенный в сеть
+    double lastMergeMicroseconds = 0.0;   // перенос в сеть (рейсы и индекс расписания)
+    double lastLagMilliseconds = 0.0;     // от чтения пакета до переноса в сеть
+    double maxLagMilliseconds = 0.0;
+    double lastSourceLagMilliseconds = -1.0; // от времени в заголовке пакета; -1 - заголовка не было
+    std::string lastError;
+};
+
+// Чтение оперативных обновлений из файла или именованного канала в отдельном потоке.
+// Файл читается с запомненной позиции при каждом опросе (дописанные строки), незавершенная
+// последняя строка дочитывается при следующем опросе. Канал читается до закрытия пишущей
+// стороной и открывается снова. Пакет - строки до пустой строки или до конца доступных данных.
+class RealtimeFeed {
+private:
+    std::string source;
+    std::chrono::milliseconds interval{500};
+
+    std::atomic<std::shared_ptr<const RealtimeOverlay>> overlay;
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    RealtimeFeedStats stats;
+
+    struct Batch {
+        std::vector<std::string> lines;
+        std::chrono::steady_clock::time_point receivedAt;
+        std::chrono::system_clock::time_point sourceTime;
+        bool hasSourceTime = false;
+    };
+
+    void run();
+    // false, если читать больше нечего до следующего опроса
+    bool readAvailable(std::istream& input, std::string& partial, Batch& batch);
+    void publish(Batch& batch);
+    // Разбор одной строки и изменение состояния рейса в копии; бросает InputException
+    static void applyLine(std::string_view line, unsigned long long batchNumber, RealtimeOverlay& next);
+
+public:
+    explicit RealtimeFeed(std::string sourcePath);
+    ~RealtimeFeed();
+
+    RealtimeFeed(const RealtimeFeed&) = delete;
+    RealtimeFeed& operator=(const RealtimeFeed&) = delete;
+
+    void start(std::chrono::milliseconds pollInterval);
+    // Поток, ждущий данных в именованном канале, завершается после следующей строки или
+    // закрытия канала пишущей стороной (в Linux его будит пустое открытие канала на запись)
+    void stop();
+    bool isRunning() const;
+    const std::string& getSource() const;
+
+    // Текущие оперативные данные (пустой указатель до первого пакета); без блокировок
+    std::shared_ptr<const RealtimeOverlay> current() const;
+
+    RealtimeFeedStats getStats() const;
+    // Отметка о переносе пакетов до merged.batch включительно в сеть;
+    // rejected - обновлений, которые не удалось применить к сети (например, рейса нет)
+    void recordMerge(const RealtimeOverlay& merged, double microseconds, size_t rejected, const std::string& error);
+};
+
+#endif // REALTIME_FEED_H
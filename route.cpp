@@ -1,14 +1,21 @@
 #include "route.h"
-#include <sstream>
+#include "text_parser.h"
 
-Route::Route(int num, const std::string& vType, const std::vector<std::string>& stops, 
+Route::Route(int num, const std::string& vType, std::vector<std::string> stops, 
           const std::set<int>& days)
-    : number(num), vehicleType(vType), allStops(stops), weekDays(days) {
-    if (stops.empty()) {
+    : number(num), vehicleType(vType), allStops(std::move(stops)), weekDays(days) {
+    if (allStops.empty()) {
         throw ContainerException("Маршрут не может быть пустым");
     }
-    startStop = stops.front();
-    endStop = stops.back();
+    startStop = allStops.front();
+    endStop = allStops.back();
+    std::set<std::string_view> seen;
+    for (const auto& stop : allStops) {
+        if (!seen.insert(stop).second) {
+            repeatedStops = true;
+            break;
+        }
+    }
 }
 
 bool Route::containsStop(const std::string& stop) const {
@@ -57,6 +64,10 @@ bool Route::operatesOnDay(int day) const {
     return weekDays.find(day) != weekDays.end();
 }
 
+bool Route::hasRepeatedStops() const {
+    return repeatedStops;
+}
+
 std::string Route::serialize() const {
     std::string result = std::to_string(number) + "|" + vehicleType + "|";
     for (size_t i = 0; i < allStops.size(); ++i) {
@@ -71,32 +82,36 @@ std::string Route::serialize() const {
     return result;
 }
 
-std::shared_ptr<Route> Route::deserialize(const std::string& data) {
-    std::istringstream ss(data);
-    std::string numberStr, vehicleType, stopsStr, daysStr;
-    std::getline(ss, numberStr, '|');
-    std::getline(ss, vehicleType, '|');
-    std::getline(ss, stopsStr, '|');
-    std::getline(ss, daysStr);
+std::shared_ptr<Route> Route::deserialize(std::string_view data) {
+    FieldTokenizer fields(data, '|');
+    std::string_view numberField, vehicleTypeField, stopsField;
+    fields.next(numberField);
+    fields.next(vehicleTypeField);
+    fields.next(stopsField);
+    return fromFields(numberField, vehicleTypeField, stopsField, fields.rest());
+}
 
+std::shared_ptr<Route> Route::fromFields(std::string_view numberField, std::string_view vehicleTypeField,
+                                         std::string_view stopsField, std::string_view daysField) {
     std::vector<std::string> stops;
-    std::istringstream stopsStream(stopsStr);
-    std::string stop;
-    while (std::getline(stopsStream, stop, ';')) {
-        stops.push_back(stop);
+    FieldTokenizer stopFields(stopsField, ';');
+    std::string_view stop;
+    while (stopFields.next(stop)) {
+        stops.emplace_back(stop);
     }
 
     std::set<int> weekDays;
-    if (!daysStr.empty()) {
-        std::istringstream daysStream(daysStr);
-        std::string day;
-        while (std::getline(daysStream, day, ',')) {
-            weekDays.insert(std::stoi(day));
+    if (!daysField.empty()) {
+        FieldTokenizer dayFields(daysField, ',');
+        std::string_view day;
+        while (dayFields.next(day)) {
+            weekDays.insert(parseIntField(day));
         }
     } else {
         weekDays = {1,2,3,4,5,6,7};
     }
 
-    return std::make_shared<Route>(std::stoi(numberStr), vehicleType, stops, weekDays);
+    return std::make_shared<Route>(parseIntField(numberField), std::string(vehicleTypeField),
+                                   std::move(stops), weekDays);
 }
 
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <set>
 #include <memory>
 #include <algorithm>
@@ -16,9 +17,10 @@ private:
     std::string endStop;
     std::vector<std::string> allStops;
     std::set<int> weekDays; // Дни недели: 1-понедельник, 2-вторник, ..., 7-воскресенье
+    bool repeatedStops = false; // кольцевой маршрут проходит остановку несколько раз
 
 public:
-    Route(int num, const std::string& vType, const std::vector<std::string>& stops, 
+    Route(int num, const std::string& vType, std::vector<std::string> stops, 
           const std::set<int>& days = {1,2,3,4,5,6,7});
 
     bool containsStop(const std::string& stop) const;
@@ -32,9 +34,13 @@ public:
     const std::vector<std::string>& getAllStops() const;
     const std::set<int>& getWeekDays() const;
     bool operatesOnDay(int day) const;
+    bool hasRepeatedStops() const;
 
     std::string serialize() const;
-    static std::shared_ptr<Route> deserialize(const std::string& data);
+    static std::shared_ptr<Route> deserialize(std::string_view data);
+    // Маршрут из уже выделенных полей строки (номер, тип, остановки через ';', дни через ',')
+    static std::shared_ptr<Route> fromFields(std::string_view numberField, std::string_view vehicleTypeField,
+                                             std::string_view stopsField, std::string_view daysField);
 };
 
 #endif // ROUTE_H
@@ -0,0 +1,237 @@
+#include "save_transaction.h"
+#include "exceptions.h"
+#include "text_parser.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <charconv>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* const TEMP_SUFFIX = ".tmp";
+
+struct ManifestEntry {
+    uint64_t size = 0;
+    uint64_t checksum = 0;
+};
+
+struct Manifest {
+    uint64_t generation = 0;
+    std::map<std::string, ManifestEntry> files;
+};
+
+// FNV-1a: быстрая контрольная сумма для сверки временного файла с манифестом
+uint64_t checksum(std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string readWholeFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+uint64_t parseUnsigned(std::string_view field, int base = 10) {
+    field = trimField(field);
+    uint64_t value = 0;
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value, base);
+    if (error != std::errc() || end != field.data() + field.size()) {
+        throw InputException("Некорректное число в манифесте: " + std::string(field));
+    }
+    return value;
+}
+
+// Формат: первая строка "generation|N", далее "имя|размер|контрольная сумма (hex)"
+Manifest readManifest(const std::string& path) {
+    Manifest manifest;
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return manifest;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        FieldTokenizer fields(line, '|');
+        std::string_view name, first, second;
+        fields.next(name);
+        fields.next(first);
+        if (name == "generation") {
+            manifest.generation = parseUnsigned(first);
+        } else {
+            fields.next(second);
+            manifest.files[std::string(name)] = {parseUnsigned(first), parseUnsigned(second, 16)};
+        }
+    }
+    return manifest;
+}
+
+std::string formatManifest(const Manifest& manifest) {
+    std::string result = "generation|" + std::to_string(manifest.generation) + "\n";
+    char hex[17];
+    for (const auto& [name, entry] : manifest.files) {
+        auto [end, error] = std::to_chars(hex, hex + sizeof(hex), entry.checksum, 16);
+        result += name + "|" + std::to_string(entry.size) + "|" + std::string(hex, end) + "\n";
+    }
+    return result;
+}
+
+#ifdef _WIN32
+
+void writeDurably(const std::string& path, std::string_view data) {
+    int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    if (fd == -1) {
+        throw FileException(path, "открытие для записи");
+    }
+    bool ok = _write(fd, data.data(), static_cast<unsigned int>(data.size())) == static_cast<int>(data.size()) &&
+              _commit(fd) == 0;
+    _close(fd);
+    if (!ok) {
+        throw FileException(path, "запись на диск");
+    }
+}
+
+void replaceFile(const std::string& from, const std::string& to) {
+    if (!MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        throw FileException(to, "замена файла");
+    }
+}
+
+void syncDirectory(const std::string&) {
+    // MOVEFILE_WRITE_THROUGH уже дожидается записи переименования на диск
+}
+
+#else
+
+void writeDurably(const std::string& path, std::string_view data) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        throw FileException(path, "открытие для записи");
+    }
+    const char* position = data.data();
+    size_t remaining = data.size();
+    bool ok = true;
+    while (ok && remaining > 0) {
+        ssize_t written = ::write(fd, position, remaining);
+        ok = written > 0;
+        if (ok) {
+            position += written;
+            remaining -= static_cast<size_t>(written);
+        }
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok) {
+        throw FileException(path, "запись на диск");
+    }
+}
+
+void replaceFile(const std::string& from, const std::string& to) {
+    if (::rename(from.c_str(), to.c_str()) != 0) {
+        throw FileException(to, "замена файла");
+    }
+}
+
+// Переименование становится устойчивым к сбою только после fsync каталога
+void syncDirectory(const std::string& directory) {
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd != -1) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+#endif
+
+} // namespace
+
+SaveTransaction::SaveTransaction(std::string dataDirectory) : directory(std::move(dataDirectory)) {}
+
+std::string& SaveTransaction::file(const std::string& name) {
+    for (auto& [fileName, content] : files) {
+        if (fileName == name) {
+            return content;
+        }
+    }
+    files.emplace_back(name, std::string());
+    return files.back().second;
+}
+
+size_t SaveTransaction::commit() {
+    const std::string manifestPath = directory + MANIFEST_NAME;
+    Manifest manifest = readManifest(manifestPath);
+    manifest.generation++;
+
+    size_t bytes = 0;
+    for (const auto& [name, content] : files) {
+        writeDurably(directory + name + TEMP_SUFFIX, content);
+        manifest.files[name] = {content.size(), checksum(content)};
+        bytes += content.size();
+    }
+
+    // Точка фиксации: после замены манифеста новое поколение считается записанным
+    std::string manifestContent = formatManifest(manifest);
+    writeDurably(manifestPath + TEMP_SUFFIX, manifestContent);
+    replaceFile(manifestPath + TEMP_SUFFIX, manifestPath);
+    syncDirectory(directory);
+    bytes += manifestContent.size();
+
+    for (const auto& [name, content] : files) {
+        replaceFile(directory + name + TEMP_SUFFIX, directory + name);
+    }
+    syncDirectory(directory);
+    return bytes;
+}
+
+void SaveTransaction::recover(const std::string& dataDirectory) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    if (!fs::is_directory(dataDirectory, error)) {
+        return;
+    }
+
+    const Manifest manifest = readManifest(dataDirectory + MANIFEST_NAME);
+    bool completed = false;
+    for (const auto& [name, entry] : manifest.files) {
+        const std::string tempPath = dataDirectory + name + TEMP_SUFFIX;
+        if (!fs::exists(tempPath, error)) {
+            continue;
+        }
+        // Временный файл, совпадающий с манифестом, - зафиксированное, но не переименованное содержимое
+        std::string content = readWholeFile(tempPath);
+        if (content.size() == entry.size && checksum(content) == entry.checksum) {
+            replaceFile(tempPath, dataDirectory + name);
+            completed = true;
+        }
+    }
+    if (completed) {
+        syncDirectory(dataDirectory);
+    }
+
+    // Остальные временные файлы принадлежат незафиксированному сохранению
+    for (const auto& item : fs::directory_iterator(dataDirectory, error)) {
+        if (item.path().extension() == TEMP_SUFFIX) {
+            fs::remove(item.path(), error);
+        }
+    }
+}
+
+uint64_t SaveTransaction::currentGeneration(const std::string& dataDirectory) {
+    return readManifest(dataDirectory + MANIFEST_NAME).generation;
+}
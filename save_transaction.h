@@ -0,0 +1,42 @@
+#ifndef SAVE_TRANSACTION_H
+#define SAVE_TRANSACTION_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+// Атомарное сохранение набора файлов данных.
+// Содержимое каждого файла собирается в памяти, затем commit:
+//  1) пишет каждый файл во временный <имя>.tmp и сбрасывает его на диск (fsync);
+//  2) записывает manifest.txt (номер поколения, размеры и контрольные суммы файлов)
+//     через временный файл и переименование - это точка фиксации;
+//  3) переименовывает временные файлы поверх рабочих.
+// Если процесс прервется до шага 2, остаются старые файлы; если после -
+// recover при следующем запуске доводит переименование до конца.
+class SaveTransaction {
+private:
+    std::string directory;
+    std::vector<std::pair<std::string, std::string>> files; // имя, содержимое
+
+public:
+    static constexpr const char* MANIFEST_NAME = "manifest.txt";
+
+    explicit SaveTransaction(std::string dataDirectory);
+
+    // Буфер содержимого файла; файлы записываются в порядке первого обращения
+    std::string& file(const std::string& name);
+
+    // Записывает все файлы и возвращает число записанных байт
+    size_t commit();
+
+    // Завершает сохранение, прерванное после фиксации манифеста,
+    // и удаляет временные файлы незафиксированного сохранения
+    static void recover(const std::string& dataDirectory);
+
+    // Номер поколения из manifest.txt (0, если манифеста нет)
+    static uint64_t currentGeneration(const std::string& dataDirectory);
+};
+
+#endif // SAVE_TRANSACTION_H
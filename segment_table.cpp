@@ -0,0 +1,163 @@
+#include "segment_table.h"
+#include "text_parser.h"
+#include "exceptions.h"
+#include "trip.h"
+
+bool SegmentTable::addSegment(const std::string& fromStop, const std::string& toStop, SegmentInfo info) {
+    if (fromStop.empty() || toStop.empty() || fromStop == toStop) {
+        throw InputException("Перегон должен соединять две разные остановки");
+    }
+    if (!(info.distanceKm > 0)) {
+        throw InputException("Длина перегона должна быть положительной");
+    }
+    for (const auto& [vehicleType, speed] : info.speeds) {
+        if (!(speed > 0)) {
+            throw InputException("Скорость на перегоне должна быть положительной: " + vehicleType);
+        }
+    }
+    auto [it, inserted] = segments.insert_or_assign(std::make_pair(fromStop, toStop), std::move(info));
+    return inserted;
+}
+
+void SegmentTable::addPeriod(SpeedPeriod period) {
+    if (!(period.factor > 0)) {
+        throw InputException("Поправка времени в пути должна быть положительной");
+    }
+    periods.push_back(std::move(period));
+}
+
+const SegmentInfo* SegmentTable::findSegment(const std::string& fromStop, const std::string& toStop) const {
+    auto it = segments.find(std::make_pair(fromStop, toStop));
+    if (it == segments.end()) {
+        it = segments.find(std::make_pair(toStop, fromStop));
+    }
+    return it == segments.end() ? nullptr : &it->second;
+}
+
+double SegmentTable::periodFactor(const std::string& vehicleType, int departureMinute) const {
+    const int minute = ((departureMinute % (24 * 60)) + 24 * 60) % (24 * 60);
+    const SpeedPeriod* general = nullptr;
+    for (const auto& period : periods) {
+        bool inside = period.fromMinute <= period.toMinute
+                          ? minute >= period.fromMinute && minute < period.toMinute
+                          : minute >= period.fromMinute || minute < period.toMinute;
+        if (!inside) {
+            continue;
+        }
+        if (period.vehicleType == vehicleType) {
+            return period.factor;
+        }
+        if (period.vehicleType.empty() && !general) {
+            general = &period;
+        }
+    }
+    return general ? general->factor : 1.0;
+}
+
+int SegmentTable::segmentMinutes(const Route& route, size_t index, double averageSpeed, double factor) const {
+    const auto& stops = route.getAllStops();
+    double distance = DEFAULT_DISTANCE_KM;
+    double speed = averageSpeed;
+    if (const SegmentInfo* segment = findSegment(stops[index - 1], stops[index])) {
+        distance = segment->distanceKm;
+        auto speedIt = segment->speeds.find(route.getVehicleType());
+        if (speedIt != segment->speeds.end()) {
+            speed = speedIt->second;
+        }
+    }
+    return static_cast<int>((distance / speed) * 60 * factor + 0.5);
+}
+
+std::shared_ptr<const std::vector<int>> SegmentTable::routeOffsets(const std::shared_ptr<const Route>& route,
+                                                                   double averageSpeed, int departureMinute) const {
+    if (!(averageSpeed > 0)) {
+        throw InputException("Средняя скорость должна быть положительной");
+    }
+    const double factor = periodFactor(route->getVehicleType(), departureMinute);
+    const auto key = std::make_tuple(route.get(), averageSpeed, factor);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it != cache.end() && !it->second.route.expired()) {
+        return it->second.offsets;
+    }
+
+    // На каждой промежуточной остановке стоянка STOP_DWELL_MINUTES
+    const size_t stopCount = route->getAllStops().size();
+    std::vector<int> stopOffsets(stopCount, 0);
+    for (size_t i = 1; i < stopCount; ++i) {
+        stopOffsets[i] = stopOffsets[i - 1] + segmentMinutes(*route, i, averageSpeed, factor) +
+                         (i > 1 ? STOP_DWELL_MINUTES : 0);
+    }
+    // Одинаковые смещения разных маршрутов и скоростей хранятся одним массивом
+    auto offsets = Trip::shareOffsets(std::move(stopOffsets));
+    if (cache.size() >= CACHE_PRUNE_SIZE) {
+        // Смещения удаленных маршрутов больше не нужны
+        std::erase_if(cache, [](const auto& entry) { return entry.second.route.expired(); });
+    }
+    cache[key] = CachedOffsets{route, offsets};
+    return offsets;
+}
+
+size_t SegmentTable::segmentCount() const {
+    return segments.size();
+}
+
+size_t SegmentTable::periodCount() const {
+    return periods.size();
+}
+
+bool SegmentTable::empty() const {
+    return segments.empty() && periods.empty();
+}
+
+bool SegmentTable::parseLine(std::string_view line) {
+    FieldTokenizer fields(line, '|');
+    std::string_view kind;
+    fields.next(kind);
+    kind = trimField(kind);
+
+    if (kind == "segment") {
+        // segment|остановка|остановка|км[|тип:км/ч,тип:км/ч]
+        std::string_view fromField, toField, distanceField, speedsField;
+        if (!fields.next(fromField) || !fields.next(toField) || !fields.next(distanceField)) {
+            throw InputException("Недостаточно полей перегона");
+        }
+        SegmentInfo info;
+        info.distanceKm = parseDoubleField(distanceField);
+        if (fields.next(speedsField)) {
+            FieldTokenizer speeds(speedsField, ',');
+            std::string_view item;
+            while (speeds.next(item)) {
+                if (trimField(item).empty()) {
+                    continue;
+                }
+                size_t colon = item.find(':');
+                if (colon == std::string_view::npos) {
+                    throw InputException("Ожидается тип:скорость: " + std::string(item));
+                }
+                info.speeds[std::string(trimField(item.substr(0, colon)))] = parseDoubleField(item.substr(colon + 1));
+            }
+        }
+        return addSegment(std::string(trimField(fromField)), std::string(trimField(toField)), std::move(info));
+    }
+
+    if (kind == "period") {
+        // period|ЧЧ:ММ|ЧЧ:ММ|множитель[|тип]
+        std::string_view fromField, toField, factorField, typeField;
+        if (!fields.next(fromField) || !fields.next(toField) || !fields.next(factorField)) {
+            throw InputException("Недостаточно полей периода");
+        }
+        SpeedPeriod period;
+        period.fromMinute = parseTimeField(fromField).getTotalMinutes();
+        period.toMinute = parseTimeField(toField).getTotalMinutes();
+        period.factor = parseDoubleField(factorField);
+        if (fields.next(typeField)) {
+            period.vehicleType = std::string(trimField(typeField));
+        }
+        addPeriod(std::move(period));
+        return true;
+    }
+
+    throw InputException("Неизвестный вид записи: " + std::string(kind));
+}
@@ -0,0 +1,84 @@
+#ifndef SEGMENT_TABLE_H
+#define SEGMENT_TABLE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "route.h"
+
+// Перегон между соседними остановками маршрута
+struct SegmentInfo {
+    double distanceKm = 0.0;
+    // Скорость на перегоне по типу транспорта (км/ч); для остальных типов - средняя скорость рейса
+    std::unordered_map<std::string, double> speeds;
+};
+
+// Поправка времени в пути для рейсов, отправляющихся в интервале [fromMinute, toMinute)
+// (интервал может переходить через полночь). factor умножает время движения, стоянки не меняются
+struct SpeedPeriod {
+    int fromMinute = 0;
+    int toMinute = 0;
+    double factor = 1.0;
+    std::string vehicleType; // пусто - для всех типов транспорта
+};
+
+// Таблица перегонов (segments.txt): расстояние и скорости между парами остановок,
+// поправки на время суток. Для пар без записи используется DEFAULT_DISTANCE_KM,
+// поэтому пустая таблица дает прежний расчет (1.5 км между любыми остановками).
+// Смещения прибытия маршрута считаются один раз на (маршрут, скорость, поправка) и
+// хранятся в общем массиве: время рейса - время отправления плюс этот массив.
+// Таблица не изменяется после загрузки; кэш смещений защищен блокировкой.
+class SegmentTable {
+private:
+    std::map<std::pair<std::string, std::string>, SegmentInfo> segments;
+    std::vector<SpeedPeriod> periods;
+
+    struct CachedOffsets {
+        std::weak_ptr<const Route> route; // адрес маршрута мог достаться новому объекту
+        std::shared_ptr<const std::vector<int>> offsets;
+    };
+    static const size_t CACHE_PRUNE_SIZE = 4096;
+    mutable std::mutex cacheMutex;
+    mutable std::map<std::tuple<const Route*, double, double>, CachedOffsets> cache;
+
+    int segmentMinutes(const Route& route, size_t index, double averageSpeed, double factor) const;
+
+public:
+    static constexpr double DEFAULT_DISTANCE_KM = 1.5;
+    static const int STOP_DWELL_MINUTES = 1;
+
+    SegmentTable() = default;
+    SegmentTable(const SegmentTable&) = delete;
+    SegmentTable& operator=(const SegmentTable&) = delete;
+
+    // Перегон действует в обе стороны, если обратный не задан отдельно.
+    // false, если перегон уже был задан (запись заменяется)
+    bool addSegment(const std::string& fromStop, const std::string& toStop, SegmentInfo info);
+    void addPeriod(SpeedPeriod period);
+
+    // Перегон fromStop -> toStop (или обратный); nullptr, если не задан
+    const SegmentInfo* findSegment(const std::string& fromStop, const std::string& toStop) const;
+    // Поправка для типа транспорта и минуты отправления: сначала ищется период этого типа,
+    // затем общий; 1.0, если ни один не подходит
+    double periodFactor(const std::string& vehicleType, int departureMinute) const;
+
+    // Смещения прибытия на остановки маршрута от отправления (минуты, первое - 0)
+    std::shared_ptr<const std::vector<int>> routeOffsets(const std::shared_ptr<const Route>& route,
+                                                         double averageSpeed, int departureMinute) const;
+
+    size_t segmentCount() const;
+    size_t periodCount() const;
+    bool empty() const;
+
+    // Разбор строки segments.txt; бросает InputException при ошибке формата.
+    // false, если строка повторно задает уже известный перегон
+    bool parseLine(std::string_view line);
+};
+
+#endif // SEGMENT_TABLE_H
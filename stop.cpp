@@ -1,5 +1,5 @@
 #include "stop.h"
-#include <sstream>
+#include "text_parser.h"
 
 Stop::Stop(int stopId, std::string stopName) : id(stopId), name(std::move(stopName)) {}
 
@@ -19,11 +19,10 @@ std::string Stop::serialize() const {
     return std::to_string(id) + "|" + name;
 }
 
-Stop Stop::deserialize(const std::string& data) {
-    std::istringstream ss(data);
-    std::string idStr, name;
-    std::getline(ss, idStr, '|');
-    std::getline(ss, name);
-    return Stop(std::stoi(idStr), name);
+Stop Stop::deserialize(std::string_view data) {
+    FieldTokenizer fields(data, '|');
+    std::string_view idField;
+    fields.next(idField);
+    return Stop(parseIntField(idField), std::string(fields.rest()));
 }
 
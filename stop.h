@@ -2,6 +2,7 @@
 #define STOP_H
 
 #include <string>
+#include <string_view>
 
 class Stop {
 private:
@@ -16,7 +17,7 @@ public:
     bool operator==(const Stop& other) const;
 
     std::string serialize() const;
-    static Stop deserialize(const std::string& data);
+    static Stop deserialize(std::string_view data);
 };
 
 #endif // STOP_H
@@ -0,0 +1,284 @@
+#include "task_scheduler.h"
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Планировщик и номер рабочего потока, в котором выполняется код (nullptr - посторонний поток)
+thread_local const TaskScheduler* currentScheduler = nullptr;
+thread_local size_t currentIndex = 0;
+
+int defaultWorkerCount() {
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+}
+}
+
+TaskScheduler::TaskGroup::TaskGroup(TaskScheduler& owner) : scheduler(owner) {}
+
+TaskScheduler::TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+void TaskScheduler::TaskGroup::run(std::function<void()> task) {
+    pending.fetch_add(1);
+    scheduler.submit(Task{std::move(task), this});
+}
+
+void TaskScheduler::TaskGroup::complete(std::exception_ptr taskError) {
+    // Счетчик уменьшается под мьютексом: ожидающий поток берет его перед выходом из wait(),
+    // поэтому группа не уничтожается, пока последняя задача ее не отпустит
+    std::lock_guard<std::mutex> lock(mutex);
+    if (taskError && !error) {
+        error = taskError;
+    }
+    if (pending.fetch_sub(1) == 1) {
+        finished.notify_all();
+    }
+}
+
+void TaskScheduler::TaskGroup::wait() {
+    while (pending.load() > 0) {
+        Task task;
+        size_t victim;
+        if (scheduler.takeTask(task, victim)) {
+            scheduler.execute(task, victim);
+            continue;
+        }
+        // Очереди пусты: задачи группы выполняются другими потоками. Ожидание ограничено,
+        // чтобы вернуться к очередям, если задачи группы породят новые
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait_for(lock, std::chrono::milliseconds(1), [this] { return pending.load() == 0; });
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error) {
+        std::rethrow_exception(std::exchange(error, nullptr));
+    }
+}
+
+TaskScheduler::TaskScheduler(int workerThreads)
+    : workerCount(workerThreads > 0 ? workerThreads : defaultWorkerCount()),
+      statsStarted(std::chrono::steady_clock::now()) {}
+
+TaskScheduler::~TaskScheduler() {
+    stop();
+}
+
+void TaskScheduler::start() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (started.load()) {
+        return;
+    }
+    stopping = false;
+    for (int i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i);
+    }
+    started.store(true);
+}
+
+void TaskScheduler::stop() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (!started.load()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> sleepLock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+    workers.clear();
+    started.store(false);
+}
+
+void TaskScheduler::setWorkerCount(int workerThreads) {
+    stop();
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        workerCount = workerThreads > 0 ? workerThreads : defaultWorkerCount();
+    }
+    resetStats();
+}
+
+int TaskScheduler::getWorkerCount() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    return workerCount;
+}
+
+int TaskScheduler::currentWorker() const {
+    return currentScheduler == this ? static_cast<int>(currentIndex) : -1;
+}
+
+void TaskScheduler::submit(Task task) {
+    if (!started.load()) {
+        start();
+    }
+    int own = currentWorker();
+    size_t target = own >= 0 ? static_cast<size_t>(own) : nextQueue.fetch_add(1) % workers.size();
+    {
+        // Счетчик меняется под мьютексом очереди, поэтому совпадает с числом задач в очередях
+        std::lock_guard<std::mutex> lock(workers[target]->mutex);
+        workers[target]->tasks.push_back(std::move(task));
+        queued.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool TaskScheduler::takeTask(Task& task, size_t& victim) {
+    int own = currentWorker();
+    if (own >= 0) {
+        Worker& worker = *workers[own];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            queued.fetch_sub(1);
+            victim = static_cast<size_t>(own);
+            return true;
+        }
+    }
+    // Перехват: начало чужой очереди - самые старые и обычно самые крупные задачи
+    const size_t count = workers.size();
+    const size_t first = own >= 0 ? static_cast<size_t>(own) + 1 : 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t q = (first + i) % count;
+        if (static_cast<int>(q) == own) {
+            continue;
+        }
+        Worker& worker = *workers[q];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            queued.fetch_sub(1);
+            victim = q;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::execute(Task& task, size_t victim) {
+    auto begin = std::chrono::steady_clock::now();
+    std::exception_ptr error;
+    try {
+        task.body();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    int own = currentWorker();
+    if (own >= 0) {
+        Worker& worker = *workers[own];
+        worker.busyNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count(), std::memory_order_relaxed);
+        worker.executed.fetch_add(1, std::memory_order_relaxed);
+        if (victim != static_cast<size_t>(own)) {
+            worker.stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        callerTasks.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Захваченные задачей данные освобождаются до того, как группа станет завершенной
+    task.body = nullptr;
+    task.group->complete(error);
+}
+
+void TaskScheduler::workerLoop(size_t index) {
+    currentScheduler = this;
+    currentIndex = index;
+    while (true) {
+        Task task;
+        size_t victim;
+        if (takeTask(task, victim)) {
+            execute(task, victim);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+void TaskScheduler::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body,
+                                int maxTasks) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunks = (count + grain - 1) / grain;
+    size_t tasks = maxTasks > 0 ? static_cast<size_t>(maxTasks) : static_cast<size_t>(getWorkerCount()) + 1;
+    tasks = std::min(tasks, chunks);
+
+    std::atomic<size_t> nextChunk{0};
+    auto loop = [&] {
+        size_t begin;
+        while ((begin = nextChunk.fetch_add(grain)) < count) {
+            body(begin, std::min(count, begin + grain));
+        }
+    };
+    if (tasks <= 1) {
+        loop();
+        return;
+    }
+    TaskGroup group(*this);
+    for (size_t t = 1; t < tasks; ++t) {
+        group.run(loop);
+    }
+    loop();
+    group.wait();
+}
+
+std::vector<WorkerStats> TaskScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStarted).count();
+    std::vector<WorkerStats> result;
+    for (const auto& worker : workers) {
+        WorkerStats stats;
+        stats.tasks = worker->executed.load(std::memory_order_relaxed);
+        stats.stolen = worker->stolen.load(std::memory_order_relaxed);
+        stats.busySeconds = worker->busyNanoseconds.load(std::memory_order_relaxed) / 1e9;
+        stats.utilization = elapsed > 0 ? std::min(1.0, stats.busySeconds / elapsed) : 0.0;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void TaskScheduler::resetStats() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    for (auto& worker : workers) {
+        worker->executed.store(0);
+        worker->stolen.store(0);
+        worker->busyNanoseconds.store(0);
+    }
+    callerTasks.store(0);
+    statsStarted = std::chrono::steady_clock::now();
+}
+
+void TaskScheduler::printStats(std::ostream& os) const {
+    auto stats = getStats();
+    os << "Планировщик задач: потоков " << getWorkerCount()
+       << ", задач выполнено ожидающими потоками: " << callerTasks.load() << "\n";
+    if (stats.empty()) {
+        os << "  Потоки еще не запускались\n";
+        return;
+    }
+    for (size_t i = 0; i < stats.size(); ++i) {
+        os << "  Поток " << i << ": " << stats[i].tasks << " задач (перехвачено " << stats[i].stolen
+           << "), занят " << std::fixed << std::setprecision(3) << stats[i].busySeconds << " с, загрузка "
+           << std::setprecision(1) << stats[i].utilization * 100.0 << "%\n";
+    }
+    os << std::defaultfloat;
+}
@@ -0,0 +1,114 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <iosfwd>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <exception>
+
+// Загрузка одного рабочего потока планировщика
+struct WorkerStats {
+    size_t tasks = 0;          // выполнено задач
+    size_t stolen = 0;         // из них взято из очередей других потоков
+    double busySeconds = 0.0;  // время выполнения задач
+    double utilization = 0.0;  // доля занятого времени с запуска или сброса статистики
+};
+
+// Общий планировщик задач системы с перехватом работы: у каждого рабочего потока своя очередь,
+// новые задачи потока кладутся в ее конец и берутся им же оттуда, а простаивающие потоки
+// забирают задачи из начала чужих очередей. Поток, ожидающий группу задач, сам выполняет
+// задачи из очередей, поэтому группы можно запускать и изнутри задач.
+// Потоки создаются при первой задаче.
+class TaskScheduler {
+public:
+    // Группа задач с общим ожиданием. Первое исключение задачи повторно бросается из wait(),
+    // остальные задачи группы при этом выполняются до конца
+    class TaskGroup {
+    private:
+        TaskScheduler& scheduler;
+        std::atomic<size_t> pending{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+
+        friend class TaskScheduler;
+        void complete(std::exception_ptr taskError);
+
+    public:
+        explicit TaskGroup(TaskScheduler& owner);
+        // Дожидается задач группы (без повторного исключения)
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void run(std::function<void()> task);
+        void wait();
+    };
+
+private:
+    struct Task {
+        std::function<void()> body;
+        TaskGroup* group = nullptr;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+        std::atomic<size_t> executed{0};
+        std::atomic<size_t> stolen{0};
+        std::atomic<long long> busyNanoseconds{0};
+    };
+
+    int workerCount;
+    std::vector<std::unique_ptr<Worker>> workers;
+    mutable std::mutex controlMutex; // запуск и остановка потоков
+    std::atomic<bool> started{false};
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> nextQueue{0}; // очередь для задач из посторонних потоков
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::atomic<size_t> callerTasks{0}; // выполнено посторонними потоками во время ожидания
+    std::chrono::steady_clock::time_point statsStarted;
+
+    void start();
+    void stop();
+    void workerLoop(size_t index);
+    void submit(Task task);
+    // Задача из своей очереди (с конца) или из чужой (с начала); false - очереди пусты
+    bool takeTask(Task& task, size_t& victim);
+    void execute(Task& task, size_t victim);
+    int currentWorker() const;
+
+public:
+    // 0 - по числу ядер без одного (вызывающий поток помогает при ожидании)
+    explicit TaskScheduler(int workerThreads = 0);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Изменение числа потоков; вызывается, когда задачи не выполняются. Статистика сбрасывается
+    void setWorkerCount(int workerThreads);
+    int getWorkerCount() const;
+
+    // Обработка индексов [0, count) кусками по grain: не больше maxTasks задач
+    // (0 - по числу потоков вместе с вызывающим) берут куски из общего счетчика
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body,
+                     int maxTasks = 0);
+
+    std::vector<WorkerStats> getStats() const;
+    void resetStats();
+    void printStats(std::ostream& os) const;
+};
+
+#endif // TASK_SCHEDULER_H
@@ -0,0 +1,80 @@
+#include "text_parser.h"
+#include "exceptions.h"
+#include <charconv>
+#include <string>
+
+FieldTokenizer::FieldTokenizer(std::string_view line, char delim) : text(line), delimiter(delim) {}
+
+bool FieldTokenizer::next(std::string_view& field) {
+    if (position >= text.size()) {
+        return false;
+    }
+    size_t end = text.find(delimiter, position);
+    if (end == std::string_view::npos) {
+        end = text.size();
+    }
+    field = text.substr(position, end - position);
+    position = end + 1;
+    return true;
+}
+
+std::string_view FieldTokenizer::rest() const {
+    return position >= text.size() ? std::string_view() : text.substr(position);
+}
+
+std::string_view trimField(std::string_view field) {
+    const std::string_view spaces = " \t\r";
+    size_t first = field.find_first_not_of(spaces);
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    size_t last = field.find_last_not_of(spaces);
+    return field.substr(first, last - first + 1);
+}
+
+int parseIntField(std::string_view field) {
+    std::string_view value = trimField(field);
+    if (!value.empty() && value.front() == '+') {
+        value.remove_prefix(1);
+    }
+    int result = 0;
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (value.empty() || error != std::errc() || end != value.data() + value.size()) {
+        throw InputException("Некорректное число: " + std::string(field));
+    }
+    return result;
+}
+
+double parseDoubleField(std::string_view field) {
+    std::string_view value = trimField(field);
+    if (!value.empty() && value.front() == '+') {
+        value.remove_prefix(1);
+    }
+    double result = 0.0;
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (value.empty() || error != std::errc() || end != value.data() + value.size()) {
+        throw InputException("Некорректное число: " + std::string(field));
+    }
+    return result;
+}
+
+Time parseTimeField(std::string_view field) {
+    std::string_view value = trimField(field);
+    const char* begin = value.data();
+    const char* end = value.data() + value.size();
+
+    int h = 0;
+    int m = 0;
+    auto hoursResult = std::from_chars(begin, end, h);
+    if (value.empty() || hoursResult.ec != std::errc() || hoursResult.ptr == end || *hoursResult.ptr != ':') {
+        throw InputException("Неверный формат времени: " + std::string(field));
+    }
+    auto minutesResult = std::from_chars(hoursResult.ptr + 1, end, m);
+    if (minutesResult.ec != std::errc() || minutesResult.ptr != end) {
+        throw InputException("Неверный формат времени: " + std::string(field));
+    }
+    if (h < 0 || h > 23 || m < 0 || m > 59) {
+        throw InputException("Некорректное время: " + std::string(field));
+    }
+    return Time(h, m);
+}
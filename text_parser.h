@@ -0,0 +1,33 @@
+#ifndef TEXT_PARSER_H
+#define TEXT_PARSER_H
+
+#include <string_view>
+#include "time.h"
+
+// Разбиение строки текстового файла данных на поля без выделения памяти.
+// Поля возвращаются как std::string_view на исходную строку, поэтому строка
+// должна жить, пока используются поля. Правила совпадают с std::getline:
+// пустые поля между разделителями сохраняются, пустое поле в конце строки - нет.
+class FieldTokenizer {
+private:
+    std::string_view text;
+    size_t position = 0;
+    char delimiter;
+
+public:
+    FieldTokenizer(std::string_view line, char delim);
+
+    // Следующее поле; false, если поля закончились
+    bool next(std::string_view& field);
+    // Неразобранный остаток строки (последнее поле может содержать разделители)
+    std::string_view rest() const;
+};
+
+// Разбор чисел и времени через std::from_chars. Пробелы и '\r' по краям поля
+// допускаются, любые другие лишние символы - ошибка (InputException)
+int parseIntField(std::string_view field);
+double parseDoubleField(std::string_view field);
+Time parseTimeField(std::string_view field);
+std::string_view trimField(std::string_view field);
+
+#endif // TEXT_PARSER_H
@@ -1,4 +1,5 @@
 #include "time.h"
+#include "text_parser.h"
 #include <sstream>
 
 void Time::normalize(int totalMinutes) {
@@ -11,19 +12,7 @@ Time::Time(int h, int m) {
     normalize(h * 60 + m);
 }
 
-Time::Time(const std::string& timeStr) {
-    std::stringstream ss(timeStr);
-    char colon;
-    int h, m;
-    if (!(ss >> h >> colon >> m) || colon != ':' || ss.fail() || !ss.eof()) {
-        throw InputException("Неверный формат времени: " + timeStr);
-    }
-    if (h < 0 || h > 23 || m < 0 || m > 59) {
-        throw InputException("Некорректное время: " + timeStr);
-    }
-    hours = h;
-    minutes = m;
-}
+Time::Time(const std::string& timeStr) : Time(parseTimeField(timeStr)) {}
 
 int Time::getTotalMinutes() const {
     return hours * 60 + minutes;
@@ -91,7 +80,7 @@ std::string Time::serialize() const {
            (minutes < 10 ? "0" : "") + std::to_string(minutes);
 }
 
-Time Time::deserialize(const std::string& data) {
-    return Time(data);
+Time Time::deserialize(std::string_view data) {
+    return parseTimeField(data);
 }
 
@@ -2,6 +2,7 @@
 #define TIME_H
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include "exceptions.h"
 
@@ -35,7 +36,7 @@ public:
     friend std::istream& operator>>(std::istream& is, Time& time);
 
     std::string serialize() const;
-    static Time deserialize(const std::string& data);
+    static Time deserialize(std::string_view data);
 };
 
 #endif // TIME_H
@@ -0,0 +1,400 @@
+#include "timetable.h"
+#include <algorithm>
+#include <tuple>
+
+namespace {
+
+// Порядок перегонов после устойчивой сортировки при построении: по отправлению,
+// при равенстве - по индексу рейса, внутри рейса - по прибытию
+bool connectionBefore(const Connection& a, const Connection& b) {
+    return std::tie(a.departure, a.trip, a.arrival) < std::tie(b.departure, b.trip, b.arrival);
+}
+
+bool sameConnection(const Connection& a, const Connection& b) {
+    return a.fromStop == b.fromStop && a.toStop == b.toStop && a.departure == b.departure &&
+           a.arrival == b.arrival && a.trip == b.trip && a.weekDay == b.weekDay;
+}
+
+} // namespace
+
+int TimetableIndex::addStopName(const std::string& name) {
+    auto it = stopIndex.find(name);
+    if (it != stopIndex.end()) {
+        return it->second;
+    }
+    int index = static_cast<int>(stopNames.size());
+    stopNames.push_back(name);
+    stopIndex.emplace(name, index);
+    return index;
+}
+
+void TimetableIndex::build(const std::vector<std::shared_ptr<Trip>>& tripList, const DynamicArray<Stop>& stops,
+                           const TransferNetwork& transfers) {
+    clear();
+
+    for (const auto& stop : stops) {
+        addStopName(stop.getName());
+    }
+
+    trips = tripList;
+    std::vector<int> minutes;
+    for (size_t t = 0; t < trips.size(); ++t) {
+        const auto& trip = trips[t];
+        const auto& routeStops = trip->getRoute()->getAllStops();
+        trip->getRouteStopMinutes(minutes);
+
+        // Соединяем соседние остановки маршрута, для которых известно время прибытия.
+        // Остановки без времени в расписании рейса пропускаются.
+        int prevStop = -1;
+        int prevTime = 0;
+        for (size_t i = 0; i < routeStops.size(); ++i) {
+            if (minutes[i] == Trip::NO_STOP_TIME) {
+                continue;
+            }
+            int stop = addStopName(routeStops[i]);
+            int time = minutes[i];
+
+            // Перегоны через полночь не поддерживаются (время хранится в пределах суток)
+            if (prevStop != -1 && time >= prevTime) {
+                connections.push_back({prevStop, stop, prevTime, time,
+                                       static_cast<int>(t), trip->getWeekDay()});
+            }
+            prevStop = stop;
+            prevTime = time;
+        }
+    }
+
+    // Устойчивая сортировка сохраняет порядок перегонов внутри рейса
+    std::stable_sort(connections.begin(), connections.end(),
+                     [](const Connection& a, const Connection& b) {
+                         return a.departure < b.departure;
+                     });
+
+    indexTrips();
+    buildTransferData(stops, transfers);
+}
+
+void TimetableIndex::indexTrips() {
+    tripPositions.clear();
+    tripPositions.reserve(trips.size());
+    for (size_t t = 0; t < trips.size(); ++t) {
+        tripPositions.emplace(trips[t]->getTripId(), static_cast<int>(t));
+    }
+}
+
+bool TimetableIndex::tripConnections(int t, const std::vector<int>& minutes, std::vector<Connection>& out) const {
+    const auto& routeStops = trips[t]->getRoute()->getAllStops();
+    out.clear();
+    int prevStop = -1;
+    int prevTime = 0;
+    for (size_t i = 0; i < routeStops.size(); ++i) {
+        if (minutes[i] == Trip::NO_STOP_TIME) {
+            continue;
+        }
+        int stop = findStop(routeStops[i]);
+        if (stop == -1) {
+            return false;
+        }
+        if (prevStop != -1 && minutes[i] >= prevTime) {
+            out.push_back({prevStop, stop, prevTime, minutes[i], t, trips[t]->getWeekDay()});
+        }
+        prevStop = stop;
+        prevTime = minutes[i];
+    }
+    return true;
+}
+
+void TimetableIndex::ownConnections() {
+    if (mappedStorage) {
+        connections.assign(mappedConnections.begin(), mappedConnections.end());
+        mappedConnections = {};
+        mappedStorage.reset();
+    }
+}
+
+bool TimetableIndex::updateTrip(int t, std::shared_ptr<Trip> trip, const std::vector<int>& oldMinutes,
+                                size_t& changedConnections) {
+    changedConnections = 0;
+    if (t < 0 || t >= static_cast<int>(trips.size()) || trips[t]->getTripId() != trip->getTripId() ||
+        trips[t]->getRoute() != trip->getRoute()) {
+        return false;
+    }
+    std::vector<Connection> before;
+    std::vector<Connection> after;
+    std::vector<int> newMinutes;
+    trip->getRouteStopMinutes(newMinutes);
+    if (!tripConnections(t, oldMinutes, before)) {
+        return false;
+    }
+    trips[t] = std::move(trip);
+    if (!tripConnections(t, newMinutes, after)) {
+        return false;
+    }
+
+    ownConnections();
+    auto locate = [this](const Connection& c) {
+        auto [first, last] = std::equal_range(connections.begin(), connections.end(), c, connectionBefore);
+        auto it = std::find_if(first, last, [&c](const Connection& x) { return sameConnection(x, c); });
+        return it == last ? connections.end() : it;
+    };
+
+    // Перегоны рейса обрабатываются по порядку, поэтому внутри рейса порядок сохраняется
+    size_t pairs = std::min(before.size(), after.size());
+    for (size_t k = 0; k < std::max(before.size(), after.size()); ++k) {
+        if (k < pairs && sameConnection(before[k], after[k])) {
+            continue;
+        }
+        changedConnections++;
+        if (k < before.size()) {
+            auto it = locate(before[k]);
+            if (it == connections.end()) {
+                return false;
+            }
+            if (k < pairs) {
+                // Перемещение: сдвигаются только перегоны между прежним и новым местом
+                auto target = std::upper_bound(connections.begin(), connections.end(), after[k], connectionBefore);
+                if (target > it) {
+                    std::rotate(it, it + 1, target);
+                    *(target - 1) = after[k];
+                } else {
+                    std::rotate(target, it, it + 1);
+                    *target = after[k];
+                }
+                continue;
+            }
+            connections.erase(it);
+            continue;
+        }
+        connections.insert(std::upper_bound(connections.begin(), connections.end(), after[k], connectionBefore),
+                           after[k]);
+    }
+    // Перегоны нулевой длительности подряд имеют одинаковый ключ; их порядок - порядок остановок
+    for (size_t k = 0; k < after.size(); ++k) {
+        size_t end = k + 1;
+        while (end < after.size() && !connectionBefore(after[k], after[end]) && !connectionBefore(after[end], after[k])) {
+            ++end;
+        }
+        if (end - k > 1) {
+            auto [first, last] = std::equal_range(connections.begin(), connections.end(), after[k], connectionBefore);
+            if (static_cast<size_t>(last - first) == end - k) {
+                std::copy(after.begin() + k, after.begin() + end, first);
+            }
+        }
+        k = end - 1;
+    }
+    return true;
+}
+
+void TimetableIndex::adopt(const std::vector<std::shared_ptr<Trip>>& tripList, const DynamicArray<Stop>& stops,
+                           const TransferNetwork& transfers, const std::vector<std::string>& orderedStopNames,
+                           std::span<const Connection> prebuiltConnections,
+                           std::shared_ptr<const MappedFile> storage) {
+    clear();
+
+    for (const auto& name : orderedStopNames) {
+        addStopName(name);
+    }
+    trips = tripList;
+    mappedStorage = std::move(storage);
+    mappedConnections = prebuiltConnections;
+    indexTrips();
+
+    buildTransferData(stops, transfers);
+}
+
+void TimetableIndex::buildTransferData(const DynamicArray<Stop>& stops, const TransferNetwork& transfers) {
+    std::unordered_map<int, std::string> stopNamesById;
+    for (const auto& stop : stops) {
+        stopNamesById[stop.getId()] = stop.getName();
+    }
+
+    minTransferMinutes.assign(stopNames.size(), 0);
+    for (const auto& [stopId, minutes] : transfers.getMinTransferTimes()) {
+        auto nameIt = stopNamesById.find(stopId);
+        if (nameIt != stopNamesById.end()) {
+            minTransferMinutes[stopIndex[nameIt->second]] = minutes;
+        }
+    }
+
+    buildWalkArrays(transfers.computeClosure(), stopNamesById);
+}
+
+void TimetableIndex::buildWalkArrays(const std::vector<Footpath>& closure,
+                                     const std::unordered_map<int, std::string>& stopNamesById) {
+    const size_t stopCount = stopNames.size();
+    std::vector<std::pair<int, WalkEdge>> resolved;
+    for (const auto& f : closure) {
+        auto fromIt = stopNamesById.find(f.fromStopId);
+        auto toIt = stopNamesById.find(f.toStopId);
+        if (fromIt == stopNamesById.end() || toIt == stopNamesById.end()) {
+            continue;
+        }
+        resolved.push_back({stopIndex[fromIt->second], {stopIndex[toIt->second], f.minutes}});
+    }
+
+    // Подсчет, префиксные суммы и раскладка - классическое построение CSR
+    auto fill = [&](std::vector<int>& offsets, std::vector<WalkEdge>& edges, bool outgoing) {
+        offsets.assign(stopCount + 1, 0);
+        for (const auto& [from, edge] : resolved) {
+            offsets[(outgoing ? from : edge.stop) + 1]++;
+        }
+        for (size_t s = 0; s < stopCount; ++s) {
+            offsets[s + 1] += offsets[s];
+        }
+        edges.resize(resolved.size());
+        std::vector<int> position(offsets.begin(), offsets.end() - 1);
+        for (const auto& [from, edge] : resolved) {
+            if (outgoing) {
+                edges[position[from]++] = edge;
+            } else {
+                edges[position[edge.stop]++] = {from, edge.minutes};
+            }
+        }
+    };
+    fill(walkOffsets, walkEdges, true);
+    fill(incomingWalkOffsets, incomingWalkEdges, false);
+}
+
+void TimetableIndex::clear() {
+    stopNames.clear();
+    stopIndex.clear();
+    connections.clear();
+    trips.clear();
+    tripPositions.clear();
+    mappedStorage.reset();
+    mappedConnections = {};
+    minTransferMinutes.clear();
+    walkOffsets.clear();
+    walkEdges.clear();
+    incomingWalkOffsets.clear();
+    incomingWalkEdges.clear();
+}
+
+int TimetableIndex::getStopCount() const {
+    return static_cast<int>(stopNames.size());
+}
+
+int TimetableIndex::findStop(const std::string& name) const {
+    auto it = stopIndex.find(name);
+    return it != stopIndex.end() ? it->second : -1;
+}
+
+const std::string& TimetableIndex::getStopName(int index) const {
+    return stopNames[index];
+}
+
+const std::vector<std::string>& TimetableIndex::getStopNames() const {
+    return stopNames;
+}
+
+std::span<const Connection> TimetableIndex::getConnections() const {
+    if (mappedStorage) {
+        return mappedConnections;
+    }
+    return connections;
+}
+
+std::shared_ptr<Trip> TimetableIndex::getTrip(int index) const {
+    return trips[index];
+}
+
+int TimetableIndex::getTripCount() const {
+    return static_cast<int>(trips.size());
+}
+
+int TimetableIndex::findTrip(int tripId) const {
+    auto it = tripPositions.find(tripId);
+    return it != tripPositions.end() ? it->second : -1;
+}
+
+int TimetableIndex::getMinTransferTime(int stop) const {
+    return minTransferMinutes[stop];
+}
+
+std::span<const WalkEdge> TimetableIndex::getFootpathsFrom(int stop) const {
+    return std::span<const WalkEdge>(walkEdges.data() + walkOffsets[stop],
+                                     walkEdges.data() + walkOffsets[stop + 1]);
+}
+
+std::span<const WalkEdge> TimetableIndex::getFootpathsTo(int stop) const {
+    return std::span<const WalkEdge>(incomingWalkEdges.data() + incomingWalkOffsets[stop],
+                                     incomingWalkEdges.data() + incomingWalkOffsets[stop + 1]);
+}
+
+int TimetableIndex::getWalkMinutes(int from, int to) const {
+    for (const auto& edge : getFootpathsFrom(from)) {
+        if (edge.stop == to) {
+            return edge.minutes;
+        }
+    }
+    return -1;
+}
+
+void TimetableIndex::earliestArrivalFromStop(int origin, int departureTime, int weekDay,
+                                             std::vector<int>& arrival,
+                                             std::vector<int>& transfers) const {
+    const int stopCount = getStopCount();
+    arrival.assign(stopCount, UNREACHABLE);
+    transfers.assign(stopCount, UNREACHABLE);
+
+    if (origin < 0 || origin >= stopCount) {
+        return;
+    }
+
+    // transfers временно хранит число поездок (этапов), а не пересадок.
+    // ready[s] - момент, с которого на остановке s можно сесть в другой рейс:
+    // после высадки нужно выдержать минимальное время пересадки, после перехода пешком - нет
+    std::vector<int> tripLegs(trips.size(), UNREACHABLE);
+    std::vector<int> ready(stopCount, UNREACHABLE);
+
+    auto walkFrom = [&](int stop, int time, int legs) {
+        for (const auto& edge : getFootpathsFrom(stop)) {
+            int walkArrival = time + edge.minutes;
+            if (walkArrival < arrival[edge.stop] ||
+                (walkArrival == arrival[edge.stop] && legs < transfers[edge.stop])) {
+                arrival[edge.stop] = walkArrival;
+                transfers[edge.stop] = legs;
+            }
+            ready[edge.stop] = std::min(ready[edge.stop], walkArrival);
+        }
+    };
+
+    arrival[origin] = departureTime;
+    transfers[origin] = 0;
+    ready[origin] = departureTime;
+    walkFrom(origin, departureTime, 0);
+
+    const auto allConnections = getConnections();
+    auto first = std::lower_bound(allConnections.begin(), allConnections.end(), departureTime,
+                                  [](const Connection& c, int time) { return c.departure < time; });
+
+    for (auto it = first; it != allConnections.end(); ++it) {
+        const Connection& c = *it;
+        if (weekDay != 0 && c.weekDay != weekDay) {
+            continue;
+        }
+
+        int& legs = tripLegs[c.trip];
+        if (ready[c.fromStop] <= c.departure && transfers[c.fromStop] + 1 < legs) {
+            legs = transfers[c.fromStop] + 1;
+        }
+        if (legs == UNREACHABLE) {
+            continue;
+        }
+
+        ready[c.toStop] = std::min(ready[c.toStop], c.arrival + minTransferMinutes[c.toStop]);
+        if (c.arrival < arrival[c.toStop] ||
+            (c.arrival == arrival[c.toStop] && legs < transfers[c.toStop])) {
+            arrival[c.toStop] = c.arrival;
+            transfers[c.toStop] = legs;
+            walkFrom(c.toStop, c.arrival, legs);
+        }
+    }
+
+    // Остановки, достижимые только пешком от начальной, считаются без пересадок
+    for (int s = 0; s < stopCount; ++s) {
+        if (s != origin && transfers[s] != UNREACHABLE) {
+            transfers[s] = std::max(0, transfers[s] - 1);
+        }
+    }
+}
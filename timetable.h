@@ -0,0 +1,110 @@
+#ifndef TIMETABLE_H
+#define TIMETABLE_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include "dynamic_array.h"
+#include "stop.h"
+#include "trip.h"
+#include "transfer_network.h"
+#include "mapped_file.h"
+
+// Элементарное соединение: перегон рейса между двумя соседними остановками
+struct Connection {
+    int fromStop;   // индекс остановки отправления
+    int toStop;     // индекс остановки прибытия
+    int departure;  // время отправления (минуты от начала суток)
+    int arrival;    // время прибытия (минуты от начала суток)
+    int trip;       // индекс рейса в TimetableIndex
+    int weekDay;    // день недели рейса
+};
+
+// Пеший переход в списке смежности (индексы остановок TimetableIndex)
+struct WalkEdge {
+    int stop;
+    int minutes;
+};
+
+// Компактное представление расписания для быстрых поисковых алгоритмов.
+// Остановки пронумерованы подряд, все перегоны всех рейсов хранятся
+// в одном массиве, отсортированном по времени отправления.
+class TimetableIndex {
+private:
+    std::vector<std::string> stopNames;
+    std::unordered_map<std::string, int> stopIndex;
+    std::vector<Connection> connections;
+    std::vector<std::shared_ptr<Trip>> trips;
+    std::unordered_map<int, int> tripPositions; // id рейса -> индекс в trips
+
+    // Перегоны, принятые из бинарного снимка, читаются прямо из отображенного файла
+    std::shared_ptr<const MappedFile> mappedStorage;
+    std::span<const Connection> mappedConnections;
+
+    // Минимальное время пересадки по индексу остановки
+    std::vector<int> minTransferMinutes;
+    // Замкнутый пешеходный граф в виде массивов смежности:
+    // переходы из остановки s лежат в [walkOffsets[s], walkOffsets[s + 1])
+    std::vector<int> walkOffsets;
+    std::vector<WalkEdge> walkEdges;
+    std::vector<int> incomingWalkOffsets;
+    std::vector<WalkEdge> incomingWalkEdges;
+
+    int addStopName(const std::string& name);
+    void indexTrips();
+    // Перегоны рейса t по времени прибытия на остановки маршрута (как при построении).
+    // false, если какой-то остановки с временем нет в индексе
+    bool tripConnections(int t, const std::vector<int>& minutes, std::vector<Connection>& out) const;
+    // Перегоны из отображенного файла копируются в память перед первым изменением
+    void ownConnections();
+    void buildTransferData(const DynamicArray<Stop>& stops, const TransferNetwork& transfers);
+    void buildWalkArrays(const std::vector<Footpath>& closure,
+                         const std::unordered_map<int, std::string>& stopNamesById);
+
+public:
+    static constexpr int UNREACHABLE = std::numeric_limits<int>::max();
+
+    void build(const std::vector<std::shared_ptr<Trip>>& tripList, const DynamicArray<Stop>& stops,
+               const TransferNetwork& transfers = TransferNetwork());
+    // Готовый индекс из бинарного снимка: порядок остановок и перегоны уже рассчитаны,
+    // storage удерживает отображение файла, в котором лежат перегоны
+    void adopt(const std::vector<std::shared_ptr<Trip>>& tripList, const DynamicArray<Stop>& stops,
+               const TransferNetwork& transfers, const std::vector<std::string>& orderedStopNames,
+               std::span<const Connection> prebuiltConnections,
+               std::shared_ptr<const MappedFile> storage);
+    void clear();
+
+    int getStopCount() const;
+    int findStop(const std::string& name) const;
+    const std::string& getStopName(int index) const;
+    const std::vector<std::string>& getStopNames() const;
+    std::span<const Connection> getConnections() const;
+    std::shared_ptr<Trip> getTrip(int index) const;
+    int getTripCount() const;
+    int findTrip(int tripId) const; // -1, если рейса нет
+
+    // Замена рейса с индексом t новым объектом с измененным временем (маршрут тот же).
+    // Меняются только перегоны с другим временем: каждый переставляется в отсортированном
+    // массиве сдвигом перегонов между прежним и новым местом. oldMinutes - время прежнего
+    // объекта по остановкам маршрута. false, если так обновить нельзя (нужна полная перестройка)
+    bool updateTrip(int t, std::shared_ptr<Trip> trip, const std::vector<int>& oldMinutes,
+                    size_t& changedConnections);
+
+    int getMinTransferTime(int stop) const;
+    std::span<const WalkEdge> getFootpathsFrom(int stop) const;
+    std::span<const WalkEdge> getFootpathsTo(int stop) const;
+    int getWalkMinutes(int from, int to) const; // -1, если перехода нет
+
+    // Поиск от одной остановки до всех (Connection Scan Algorithm).
+    // arrival[s] - самое раннее время прибытия на остановку s (UNREACHABLE, если недостижима),
+    // transfers[s] - число пересадок на этом пути. weekDay = 0 означает любой день.
+    // Учитываются минимальное время пересадки и пешеходные переходы.
+    void earliestArrivalFromStop(int origin, int departureTime, int weekDay,
+                                 std::vector<int>& arrival,
+                                 std::vector<int>& transfers) const;
+};
+
+#endif // TIMETABLE_H
@@ -0,0 +1,39 @@
+#ifndef TOP_K_COLLECTOR_H
+#define TOP_K_COLLECTOR_H
+
+#include <vector>
+#include <cstddef>
+
+// Ограниченный сборщик k лучших результатов.
+// Хранит не более k элементов в куче, на вершине которой находится худший из принятых,
+// поэтому вставка стоит O(log k) вместо сортировки всех найденных результатов.
+// Compare(a, b) == true означает, что a лучше b.
+template<typename T, typename Compare>
+class TopKCollector {
+private:
+    std::vector<T> heap;
+    size_t limit;
+    Compare better;
+
+public:
+    explicit TopKCollector(size_t k, Compare cmp = Compare());
+
+    // Возвращает true, если элемент попал в число k лучших
+    bool offer(const T& value);
+
+    bool isFull() const;
+    bool empty() const;
+    size_t size() const;
+    size_t capacity() const;
+
+    // Худший из принятых элементов (только если сборщик не пуст)
+    const T& worst() const;
+
+    // Извлечение результатов от лучшего к худшему; сборщик становится пустым
+    std::vector<T> takeSorted();
+};
+
+// Реализация шаблонного класса
+#include "top_k_collector.tpp"
+
+#endif // TOP_K_COLLECTOR_H
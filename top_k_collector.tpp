@@ -0,0 +1,63 @@
+#ifndef TOP_K_COLLECTOR_TPP
+#define TOP_K_COLLECTOR_TPP
+
+#include <algorithm>
+
+template<typename T, typename Compare>
+TopKCollector<T, Compare>::TopKCollector(size_t k, Compare cmp) : limit(k), better(cmp) {
+    heap.reserve(k);
+}
+
+template<typename T, typename Compare>
+bool TopKCollector<T, Compare>::offer(const T& value) {
+    if (limit == 0) {
+        return false;
+    }
+    if (heap.size() < limit) {
+        heap.push_back(value);
+        std::push_heap(heap.begin(), heap.end(), better);
+        return true;
+    }
+    if (!better(value, heap.front())) {
+        return false;
+    }
+    std::pop_heap(heap.begin(), heap.end(), better);
+    heap.back() = value;
+    std::push_heap(heap.begin(), heap.end(), better);
+    return true;
+}
+
+template<typename T, typename Compare>
+bool TopKCollector<T, Compare>::isFull() const {
+    return heap.size() >= limit;
+}
+
+template<typename T, typename Compare>
+bool TopKCollector<T, Compare>::empty() const {
+    return heap.empty();
+}
+
+template<typename T, typename Compare>
+size_t TopKCollector<T, Compare>::size() const {
+    return heap.size();
+}
+
+template<typename T, typename Compare>
+size_t TopKCollector<T, Compare>::capacity() const {
+    return limit;
+}
+
+template<typename T, typename Compare>
+const T& TopKCollector<T, Compare>::worst() const {
+    return heap.front();
+}
+
+template<typename T, typename Compare>
+std::vector<T> TopKCollector<T, Compare>::takeSorted() {
+    std::sort_heap(heap.begin(), heap.end(), better);
+    std::vector<T> result;
+    result.swap(heap);
+    return result;
+}
+
+#endif // TOP_K_COLLECTOR_TPP
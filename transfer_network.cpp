@@ -0,0 +1,116 @@
+#include "transfer_network.h"
+#include "exceptions.h"
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+void TransferNetwork::setMinTransferTime(int stopId, int minutes) {
+    if (minutes < 0) {
+        throw InputException("Время пересадки не может быть отрицательным");
+    }
+    if (minutes == 0) {
+        minTransferMinutes.erase(stopId);
+    } else {
+        minTransferMinutes[stopId] = minutes;
+    }
+}
+
+int TransferNetwork::getMinTransferTime(int stopId) const {
+    auto it = minTransferMinutes.find(stopId);
+    return it != minTransferMinutes.end() ? it->second : 0;
+}
+
+const std::unordered_map<int, int>& TransferNetwork::getMinTransferTimes() const {
+    return minTransferMinutes;
+}
+
+void TransferNetwork::addFootpath(int fromStopId, int toStopId, int minutes) {
+    if (minutes < 0) {
+        throw InputException("Время перехода не может быть отрицательным");
+    }
+    if (fromStopId == toStopId) {
+        throw InputException("Переход должен соединять разные остановки");
+    }
+    // Повторное задание того же перехода заменяет его время
+    for (auto& f : footpaths) {
+        if ((f.fromStopId == fromStopId && f.toStopId == toStopId) ||
+            (f.fromStopId == toStopId && f.toStopId == fromStopId)) {
+            f.minutes = minutes;
+            return;
+        }
+    }
+    footpaths.push_back({fromStopId, toStopId, minutes});
+}
+
+const std::vector<Footpath>& TransferNetwork::getFootpaths() const {
+    return footpaths;
+}
+
+void TransferNetwork::removeStop(int stopId) {
+    minTransferMinutes.erase(stopId);
+    footpaths.erase(std::remove_if(footpaths.begin(), footpaths.end(),
+                                   [stopId](const Footpath& f) {
+                                       return f.fromStopId == stopId || f.toStopId == stopId;
+                                   }), footpaths.end());
+}
+
+void TransferNetwork::clear() {
+    minTransferMinutes.clear();
+    footpaths.clear();
+}
+
+bool TransferNetwork::empty() const {
+    return minTransferMinutes.empty() && footpaths.empty();
+}
+
+std::vector<Footpath> TransferNetwork::computeClosure() const {
+    // Пешеходный граф неориентированный: переход можно пройти в обе стороны
+    std::unordered_map<int, std::vector<std::pair<int, int>>> graph;
+    for (const auto& f : footpaths) {
+        graph[f.fromStopId].push_back({f.toStopId, f.minutes});
+        graph[f.toStopId].push_back({f.fromStopId, f.minutes});
+    }
+
+    std::vector<Footpath> closure;
+    using Entry = std::pair<int, int>; // минуты, остановка
+    for (const auto& [origin, edges] : graph) {
+        std::unordered_map<int, int> best;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        best[origin] = 0;
+        queue.push({0, origin});
+
+        while (!queue.empty()) {
+            auto [minutes, stop] = queue.top();
+            queue.pop();
+            if (minutes > best[stop]) {
+                continue;
+            }
+            for (const auto& [next, walk] : graph.find(stop)->second) {
+                int total = minutes + walk;
+                // Прямой переход сохраняется всегда, составной - только в пределах лимита
+                if (stop != origin && total > MAX_WALK_MINUTES) {
+                    continue;
+                }
+                auto it = best.find(next);
+                if (it == best.end() || total < it->second) {
+                    best[next] = total;
+                    queue.push({total, next});
+                }
+            }
+        }
+
+        for (const auto& [stop, minutes] : best) {
+            if (stop != origin) {
+                closure.push_back({origin, stop, minutes});
+            }
+        }
+    }
+
+    // Детерминированный порядок независимо от порядка обхода хеш-таблиц
+    std::sort(closure.begin(), closure.end(), [](const Footpath& a, const Footpath& b) {
+        if (a.fromStopId != b.fromStopId) return a.fromStopId < b.fromStopId;
+        return a.toStopId < b.toStopId;
+    });
+    return closure;
+}
@@ -0,0 +1,42 @@
+#ifndef TRANSFER_NETWORK_H
+#define TRANSFER_NETWORK_H
+
+#include <vector>
+#include <unordered_map>
+
+// Пешеходный переход между остановками (идентификаторы остановок)
+struct Footpath {
+    int fromStopId;
+    int toStopId;
+    int minutes;
+};
+
+// Правила пересадок: минимальное время пересадки на остановке
+// и пешеходные переходы между близкими остановками.
+class TransferNetwork {
+private:
+    std::unordered_map<int, int> minTransferMinutes; // id остановки -> минуты
+    std::vector<Footpath> footpaths;                 // переходы в том виде, как заданы
+
+public:
+    // Составные пешие пути длиннее этого значения в замыкание не попадают
+    static const int MAX_WALK_MINUTES = 30;
+
+    void setMinTransferTime(int stopId, int minutes);
+    int getMinTransferTime(int stopId) const;
+    const std::unordered_map<int, int>& getMinTransferTimes() const;
+
+    // Переход действует в обе стороны; повторное добавление обновляет время
+    void addFootpath(int fromStopId, int toStopId, int minutes);
+    const std::vector<Footpath>& getFootpaths() const;
+
+    void removeStop(int stopId);
+    void clear();
+    bool empty() const;
+
+    // Транзитивное замыкание пешеходного графа: кратчайшее время пешком
+    // для каждой пары остановок, связанных цепочкой переходов
+    std::vector<Footpath> computeClosure() const;
+};
+
+#endif // TRANSFER_NETWORK_H
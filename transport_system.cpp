@@ -1,21 +1,58 @@
 #include "transport_system.h"
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <unordered_set>
 
-TransportSystem::TransportSystem() 
+namespace {
+// Версия сети после последнего изменения, сделанного этим потоком: запрос того же потока
+// должен видеть свои изменения, даже если сеть в это время изменяет другой поток
+thread_local unsigned long long lastOwnWriteVersion = 0;
+}
+
+TransportSystem::TransportSystem() : TransportSystem("data/") {}
+
+TransportSystem::TransportSystem(const std::string& dataDirectory)
     : journeyPlanner(this), 
-      dataManager(),
+      dataManager(dataDirectory),
       arrivalTimeAlgorithm(std::make_unique<ArrivalTimeCalculationAlgorithm>(this)),
-      routeSearchAlgorithm(std::make_unique<RouteSearchAlgorithm>(this)) {
+      routeSearchAlgorithm(std::make_unique<RouteSearchAlgorithm>(this)),
+      travelMatrixAlgorithm(std::make_unique<TravelTimeMatrixAlgorithm>(this)),
+      delayAlgorithm(std::make_unique<DelayPropagationAlgorithm>(this)) {
     adminCredentials["admin"] = "admin123";
     adminCredentials["manager"] = "manager123";
+    publishSnapshot();
+}
+
+TransportSystem::WriteGuard::WriteGuard(const TransportSystem& owner) : system(owner) {
+    // Вложенное изменение (команда вызывает прямые методы) уже под блокировкой
+    if (system.writerThread.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        return;
+    }
+    lock = std::unique_lock<std::shared_mutex>(system.networkMutex);
+    system.writerThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+}
+
+TransportSystem::WriteGuard::~WriteGuard() {
+    if (lock.owns_lock()) {
+        lastOwnWriteVersion = system.contentVersion.load(std::memory_order_relaxed);
+        system.writerThread.store(std::thread::id(), std::memory_order_relaxed);
+    }
+}
+
+TransportSystem::ReadGuard::ReadGuard(const TransportSystem& owner) {
+    if (owner.writerThread.load(std::memory_order_relaxed) != std::this_thread::get_id()) {
+        lock = std::shared_lock<std::shared_mutex>(owner.networkMutex);
+    }
 }
 
 bool TransportSystem::canUndo() const {
+    ReadGuard guard(*this);
     return commandHistory.canUndo();
 }
 
 void TransportSystem::undo() {
+    WriteGuard guard(*this);
     if (!canUndo()) {
         throw ContainerException("Нет действий для отмены");
     }
@@ -24,10 +61,12 @@ void TransportSystem::undo() {
 }
 
 bool TransportSystem::canRedo() const {
+    ReadGuard guard(*this);
     return commandHistory.canRedo();
 }
 
 void TransportSystem::redo() {
+    WriteGuard guard(*this);
     if (!canRedo()) {
         throw ContainerException("Нет действий для повтора");
     }
@@ -36,20 +75,27 @@ void TransportSystem::redo() {
 }
 
 std::string TransportSystem::getLastCommandDescription() const {
+    ReadGuard guard(*this);
     return commandHistory.getLastCommandDescription();
 }
 
 std::string TransportSystem::getNextCommandDescription() const {
+    ReadGuard guard(*this);
     return commandHistory.getNextCommandDescription();
 }
 
 bool TransportSystem::authenticateAdmin(const std::string& username, const std::string& password) {
+    ReadGuard guard(*this);
     auto it = adminCredentials.find(username);
     return it != adminCredentials.end() && it->second == password;
 }
 
 void TransportSystem::addAdmin(const std::string& username, const std::string& password) {
+    WriteGuard guard(*this);
     adminCredentials[username] = password;
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "admin|" + username + "|" + password);
+    }
 }
 
 const std::unordered_map<std::string, std::string>& TransportSystem::getAdminCredentials() const {
@@ -57,37 +103,217 @@ const std::unordered_map<std::string, std::string>& TransportSystem::getAdminCre
 }
 
 void TransportSystem::setAdminCredentials(const std::unordered_map<std::string, std::string>& creds) {
+    WriteGuard guard(*this);
     adminCredentials = creds;
 }
 
 void TransportSystem::saveData() {
-    dataManager.saveAllData(*this);
+    WriteGuard guard(*this);
+    dataManager.saveChanges(*this);
+}
+
+void TransportSystem::compactData() {
+    WriteGuard guard(*this);
+    dataManager.compact(*this);
+}
+
+std::string TransportSystem::archiveData() {
+    WriteGuard guard(*this);
+    std::string path = dataManager.archive(*this);
+    std::cout << "Расписание сохранено в архив " << path << "\n";
+    return path;
+}
+
+void TransportSystem::loadArchive(const std::string& path) {
+    WriteGuard guard(*this);
+    dataManager.loadArchive(*this, path);
+}
+
+GtfsImportStats TransportSystem::importGtfs(const std::string& feedDirectory) {
+    WriteGuard guard(*this);
+    // Импорт добавляет тысячи объектов: вместо записи каждого в журнал
+    // данные после импорта сохраняются целиком, и журнал начинается заново
+    dataManager.suspendJournal();
+    GtfsImportStats stats;
+    try {
+        stats = GtfsImporter().import(*this, feedDirectory);
+    } catch (...) {
+        compactData();
+        throw;
+    }
+    std::cout << "Импорт GTFS: остановок " << stats.stops << ", маршрутов " << stats.routes
+              << ", рейсов " << stats.trips << "\n";
+    std::cout << "  строк " << stats.rows << " (stop_times " << stats.stopTimes << ", пропущено "
+              << stats.skippedRows << "), частей сортировки " << stats.runs << ", "
+              << static_cast<int>(stats.milliseconds + 0.5) << " мс, "
+              << static_cast<long long>(stats.rowsPerSecond()) << " строк/с\n";
+    compactData();
+    return stats;
+}
+
+void TransportSystem::waitForSave() {
+    dataManager.waitForSave();
+}
+
+void TransportSystem::reportSaveStatus() {
+    dataManager.reportSaveStatus();
+}
+
+SaveStatus TransportSystem::getSaveStatus() const {
+    return dataManager.getSaveStatus();
 }
 
 void TransportSystem::loadData() {
+    WriteGuard guard(*this);
     dataManager.loadAllData(*this);
 }
 
+void TransportSystem::setLazyTripLoading(bool enabled) {
+    WriteGuard guard(*this);
+    dataManager.setLazyTripLoading(enabled);
+}
+
+void TransportSystem::installLazyTrips(std::shared_ptr<LazyTripStore> store) {
+    WriteGuard guard(*this);
+    lazyTrips = std::move(store);
+    markNetworkChanged();
+}
+
+void TransportSystem::startHotReload(std::chrono::milliseconds pollInterval) {
+    {
+        // Отложенные рейсы читаются из trips.txt по смещениям индекса, а наблюдение нужно
+        // как раз для файлов, замененных извне: рейсы разбираются до его начала
+        WriteGuard guard(*this);
+        ensureAllTrips();
+    }
+    dataManager.startWatching(pollInterval, [this] { prepareReload(); });
+}
+
+void TransportSystem::stopHotReload() {
+    dataManager.stopWatching();
+}
+
+void TransportSystem::prepareReload() {
+    auto start = std::chrono::steady_clock::now();
+    auto result = std::make_shared<ReloadResult>();
+    try {
+        TransportSystem fresh(dataManager.getDataDirectory());
+        result->journalRecords = fresh.dataManager.loadForReload(fresh);
+
+        // Файлы, которые не удалось прочитать целиком, не подменяют рабочую сеть
+        const LoadSummary& summary = fresh.dataManager.getLastLoadSummary();
+        if (!summary.error.empty()) {
+            throw TransportException("загрузка прервана: " + summary.error);
+        }
+        for (const auto& [name, stats] : summary.files) {
+            if (stats.skipped > 0 && name != "journal.txt") {
+                throw TransportException(name + ": строк с ошибками " + std::to_string(stats.skipped));
+            }
+        }
+        if (fresh.getStops().empty() || fresh.getRoutes().empty()) {
+            throw TransportException("в новых данных нет остановок или маршрутов");
+        }
+        // Индекс строится здесь, чтобы первый запрос после подмены не ждал его
+        fresh.getTimetableIndex();
+        result->state = std::make_shared<const NetworkState>(fresh.captureState());
+    } catch (const std::exception& e) {
+        result->error = e.what();
+    }
+    result->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    pendingReload = std::move(result);
+}
+
+bool TransportSystem::applyPendingReload() {
+    WriteGuard guard(*this);
+    std::shared_ptr<ReloadResult> result;
+    {
+        std::lock_guard<std::mutex> lock(reloadMutex);
+        result = std::move(pendingReload);
+    }
+    if (!result) {
+        return false;
+    }
+    if (!result->state) {
+        std::cout << "Новые файлы данных не загружены: " << result->error << "\n";
+        return false;
+    }
+    // Несохраненные изменения переносятся в новую сеть только через журнал
+    if (!dataManager.isJournalOpen()) {
+        std::cout << "Новые файлы данных не применены: журнал изменений закрыт, "
+                     "несохраненные изменения были бы потеряны\n";
+        return false;
+    }
+    // Изменения, сделанные во время фоновой загрузки, в нее не вошли - загрузка повторяется
+    if (dataManager.journalRecordCount() != result->journalRecords) {
+        dataManager.requestReload();
+        return false;
+    }
+
+    installNetwork(*result->state);
+    // Команды истории ссылаются на объекты прежней сети
+    commandHistory.clear();
+    std::cout << "Загружена новая версия данных: маршрутов " << routes.size() << ", рейсов " << trips.size()
+              << " (" << static_cast<int>(result->milliseconds) << " мс)\n";
+    return true;
+}
+
+void TransportSystem::installNetwork(const NetworkState& state) {
+    routes = state.routes;
+    trips = state.trips;
+    lazyTrips.reset();
+    vehicles = state.vehicles;
+    drivers = state.drivers;
+    stops = state.stops;
+    stopIdToName.clear();
+    for (const auto& stop : stops) {
+        stopIdToName[stop.getId()] = stop.getName();
+    }
+    adminCredentials = state.adminCredentials;
+    transferNetwork = state.transferNetwork;
+    if (state.segmentTable) {
+        segmentTable = state.segmentTable;
+    }
+    // Оперативные данные переносятся в новую сеть заново при следующем applyRealtimeUpdates
+    realtimeOriginals.clear();
+    realtimeMergedBatch = 0;
+    markNetworkChanged();
+    if (state.timetableIndex) {
+        timetableIndex = state.timetableIndex;
+        timetableIndexVersion = networkVersion;
+    }
+}
+
+void TransportSystem::ensureAllTrips() const {
+    std::lock_guard<std::mutex> lock(lazyMutex);
+    if (!lazyTrips) {
+        return;
+    }
+    // Отложенные рейсы идут в файле раньше добавленных после загрузки
+    std::vector<std::shared_ptr<Trip>> loaded = lazyTrips->loadAll();
+    trips.insert(trips.begin(), loaded.begin(), loaded.end());
+    lazyTrips.reset();
+}
+
 std::vector<std::shared_ptr<Route>> TransportSystem::findRoutes(const std::string& stopA, const std::string& stopB) {
     // Используем алгоритм поиска маршрутов
     return routeSearchAlgorithm->findRoutes(stopA, stopB);
 }
 
 void TransportSystem::getStopTimetable(int stopId, const Time& startTime, const Time& endTime) {
-    auto it = stopIdToName.find(stopId);
-    if (it == stopIdToName.end()) {
+    auto network = getSnapshot();
+    const std::string stopName = network->getStopNameById(stopId);
+    if (stopName.empty()) {
         throw ContainerException("Остановка с ID " + std::to_string(stopId) + " не найдена");
     }
-    const std::string& stopName = it->second;
 
     std::vector<std::pair<int, Time>> relevantTrips;
 
-    for (const auto& trip : trips) {
-        if (trip->hasStop(stopName)) {
-            Time arrivalTime = trip->getArrivalTime(stopName);
-            if (startTime <= arrivalTime && arrivalTime <= endTime) {
-                relevantTrips.push_back({trip->getRoute()->getNumber(), arrivalTime});
-            }
+    for (const auto& trip : network->getTripsThroughStop(stopName)) {
+        Time arrivalTime = trip->getArrivalTime(stopName);
+        if (startTime <= arrivalTime && arrivalTime <= endTime) {
+            relevantTrips.push_back({trip->getRoute()->getNumber(), arrivalTime});
         }
     }
 
@@ -108,11 +334,8 @@ void TransportSystem::getStopTimetable(int stopId, const Time& startTime, const
 void TransportSystem::getStopTimetableAll(const std::string& stopName) {
     std::vector<std::pair<int, Time>> relevantTrips;
 
-    for (const auto& trip : trips) {
-        if (trip->hasStop(stopName)) {
-            Time arrivalTime = trip->getArrivalTime(stopName);
-            relevantTrips.push_back({trip->getRoute()->getNumber(), arrivalTime});
-        }
+    for (const auto& trip : getSnapshot()->getTripsThroughStop(stopName)) {
+        relevantTrips.push_back({trip->getRoute()->getNumber(), trip->getArrivalTime(stopName)});
     }
 
     std::sort(relevantTrips.begin(), relevantTrips.end(),
@@ -129,8 +352,290 @@ void TransportSystem::getStopTimetableAll(const std::string& stopName) {
 }
 
 void TransportSystem::calculateArrivalTimes(int tripId, double averageSpeed) {
+    WriteGuard guard(*this);
+    ensureAllTrips();
+    auto tripIt = std::find_if(trips.begin(), trips.end(),
+                               [tripId](const auto& t) { return t->getTripId() == tripId; });
+    if (tripIt == trips.end()) {
+        throw ContainerException("Рейс с ID " + std::to_string(tripId) + " не найден");
+    }
+    // Рейс пересчитывается в копии: прежний объект может читать фоновое сохранение
+    auto trip = std::make_shared<Trip>(**tripIt);
     // Используем алгоритм расчета времени прибытия
-    arrivalTimeAlgorithm->calculateArrivalTimes(tripId, averageSpeed);
+    arrivalTimeAlgorithm->calculateArrivalTimes(*trip, averageSpeed);
+    *tripIt = trip;
+    realtimeOriginals.erase(tripId);
+    markNetworkChanged();
+    // Пересчитанный рейс записывается целиком и при восстановлении заменяет прежний
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "+trip|" + trip->serialize());
+    }
+}
+
+ArrivalBatchStats TransportSystem::recalculateArrivalTimes(const std::function<bool(const Trip&)>& filter,
+                                                           const std::function<double(const Trip&)>& speedOf) {
+    WriteGuard guard(*this);
+    ensureAllTrips();
+    std::vector<size_t> positions;
+    std::vector<std::shared_ptr<Trip>> selected;
+    std::vector<double> speeds;
+    for (size_t i = 0; i < trips.size(); ++i) {
+        if (!filter || filter(*trips[i])) {
+            positions.push_back(i);
+            selected.push_back(trips[i]);
+            speeds.push_back(speedOf(*trips[i]));
+        }
+    }
+
+    std::vector<std::shared_ptr<Trip>> updated = arrivalTimeAlgorithm->calculateArrivalTimes(selected, speeds);
+    for (size_t k = 0; k < positions.size(); ++k) {
+        trips[positions[k]] = updated[k];
+        if (!realtimeOriginals.empty()) {
+            realtimeOriginals.erase(updated[k]->getTripId());
+        }
+    }
+    markNetworkChanged();
+    dataManager.recordChanges(*this, updated.size(),
+                              [&updated](size_t k) { return "+trip|" + updated[k]->serialize(); });
+    return arrivalTimeAlgorithm->getLastBatchStats();
+}
+
+TravelTimeMatrix TransportSystem::buildTravelTimeMatrix(const Time& departureTime, int weekDay) {
+    return travelMatrixAlgorithm->build(departureTime, weekDay);
+}
+
+DelayUpdateResult TransportSystem::applyDelay(int tripId, size_t stopPosition, int delayMinutes) {
+    WriteGuard guard(*this);
+    return applyDelay(tripId, stopPosition, delayMinutes, delayAlgorithm->getRecoveryMinutesPerStop());
+}
+
+DelayUpdateResult TransportSystem::applyDelay(int tripId, size_t stopPosition, int delayMinutes,
+                                              int recoveryMinutes) {
+    WriteGuard guard(*this);
+    auto startTime = std::chrono::steady_clock::now();
+    DelayUpdateResult result;
+    auto updated = delayTrip(tripId, stopPosition, delayMinutes, recoveryMinutes, result);
+    // Введенная вручную задержка становится частью расписания, в том числе для рейса из оперативных данных
+    realtimeOriginals.erase(tripId);
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "+trip|" + updated->serialize());
+    }
+    result.microseconds = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - startTime).count();
+    return result;
+}
+
+std::shared_ptr<Trip> TransportSystem::delayTrip(int tripId, size_t stopPosition, int delayMinutes,
+                                                 int recoveryMinutes, DelayUpdateResult& result) {
+    // Индекс поддерживает изменяющий поток: иначе задержка без готового индекса сбрасывала бы его,
+    // и при частых задержках каждый новый снимок строил бы индекс для запросов заново
+    getTimetableIndex();
+    int indexPosition = -1;
+    size_t position = findTripPosition(tripId, indexPosition);
+    if (position == trips.size()) {
+        throw ContainerException("Рейс с ID " + std::to_string(tripId) + " не найден");
+    }
+
+    // Прежний объект остается у фонового сохранения и у найденных ранее поездок
+    std::vector<int> oldMinutes;
+    trips[position]->getRouteStopMinutes(oldMinutes);
+    auto updated = delayAlgorithm->propagate(*trips[position], stopPosition, delayMinutes, recoveryMinutes,
+                                             result.affectedStops);
+    trips[position] = updated;
+
+    contentVersion++;
+    if (indexPosition >= 0) {
+        if (timetableIndex.use_count() > 1) {
+            timetableIndex = std::make_shared<TimetableIndex>(*timetableIndex);
+        }
+        // Все индексы системы создаются изменяемыми (make_shared<TimetableIndex>)
+        auto& index = const_cast<TimetableIndex&>(*timetableIndex);
+        result.indexUpdated = index.updateTrip(indexPosition, updated, oldMinutes, result.changedConnections);
+    }
+    if (!result.indexUpdated) {
+        // Индекс перестроится целиком при следующем обращении
+        markNetworkChanged();
+    }
+    // Маршруты и остановки не менялись, поэтому замыкание достижимости остается верным
+    return updated;
+}
+
+size_t TransportSystem::findTripPosition(int tripId, int& indexPosition) const {
+    ensureAllTrips();
+    adoptSnapshotIndexes();
+    // При актуальном индексе рейс находится по нему: порядок рейсов в индексе совпадает со списком
+    const bool indexCurrent = timetableIndex && timetableIndexVersion == networkVersion;
+    indexPosition = indexCurrent ? timetableIndex->findTrip(tripId) : -1;
+    if (indexPosition >= 0 && static_cast<size_t>(indexPosition) < trips.size() &&
+        trips[indexPosition]->getTripId() == tripId) {
+        return static_cast<size_t>(indexPosition);
+    }
+    auto tripIt = std::find_if(trips.begin(), trips.end(),
+                               [tripId](const auto& t) { return t->getTripId() == tripId; });
+    return static_cast<size_t>(tripIt - trips.begin());
+}
+
+void TransportSystem::startRealtimeFeed(const std::string& sourcePath, std::chrono::milliseconds pollInterval) {
+    WriteGuard guard(*this);
+    stopRealtimeFeed();
+    realtimeFeed = std::make_unique<RealtimeFeed>(sourcePath.empty() ? dataManager.getDataDirectory() + "realtime.txt"
+                                                                     : sourcePath);
+    realtimeMergedBatch = 0;
+    realtimeFeed->start(pollInterval);
+}
+
+void TransportSystem::stopRealtimeFeed() {
+    WriteGuard guard(*this);
+    if (realtimeFeed) {
+        realtimeFeed->stop();
+    }
+}
+
+std::shared_ptr<const RealtimeOverlay> TransportSystem::getRealtimeOverlay() const {
+    return realtimeFeed ? realtimeFeed->current() : nullptr;
+}
+
+RealtimeFeedStats TransportSystem::getRealtimeStats() const {
+    return realtimeFeed ? realtimeFeed->getStats() : RealtimeFeedStats();
+}
+
+bool TransportSystem::applyRealtimeUpdates() {
+    WriteGuard guard(*this);
+    auto overlay = getRealtimeOverlay();
+    if (!overlay || overlay->batch <= realtimeMergedBatch) {
+        return false;
+    }
+    auto startTime = std::chrono::steady_clock::now();
+    size_t rejected = 0;
+    std::string lastError;
+    std::optional<TripLinker> linker;
+    // Переносятся только рейсы, состояние которых изменилось после прошлого переноса.
+    // Сначала задержки рейсов расписания - они обновляют индекс на месте; отмены и добавления
+    // меняют состав рейсов, после них индекс перестраивается
+    for (int pass = 0; pass < 2; ++pass) {
+        for (const auto& [tripId, state] : overlay->trips) {
+            const bool structural = state->cancelled || !state->addedTrip.empty();
+            if (state->batch <= realtimeMergedBatch || structural != (pass == 1)) {
+                continue;
+            }
+            try {
+                mergeRealtimeTrip(tripId, *state, linker);
+            } catch (const std::exception& e) {
+                rejected++;
+                lastError = "Рейс " + std::to_string(tripId) + ": " + e.what();
+            }
+        }
+    }
+    realtimeMergedBatch = overlay->batch;
+    realtimeFeed->recordMerge(*overlay,
+                              std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count(),
+                              rejected, lastError);
+    return true;
+}
+
+void TransportSystem::mergeRealtimeTrip(int tripId, const RealtimeTripState& state,
+                                        std::optional<TripLinker>& linker) {
+    int indexPosition = -1;
+    size_t position = findTripPosition(tripId, indexPosition);
+    std::shared_ptr<Trip> current = position < trips.size() ? trips[position] : nullptr;
+    // Запоминается рейс до первого оперативного изменения
+    realtimeOriginals.try_emplace(tripId, current);
+
+    if (state.cancelled) {
+        if (current) {
+            trips.erase(trips.begin() + static_cast<std::ptrdiff_t>(position));
+            markNetworkChanged();
+        }
+        return;
+    }
+    std::shared_ptr<Trip> added;
+    if (!state.addedTrip.empty()) {
+        if (!linker) {
+            linker.emplace(*this);
+        }
+        added = dataManager.linkTrip(*linker, state.addedTrip);
+        if (added->getTripId() != tripId) {
+            throw InputException("ID добавленного рейса не совпадает");
+        }
+        current = added;
+    }
+    if (state.delayed) {
+        if (!current) {
+            throw ContainerException("Рейс с ID " + std::to_string(tripId) + " не найден");
+        }
+        const auto& routeStops = current->getRoute()->getAllStops();
+        auto stopIt = std::find(routeStops.begin(), routeStops.end(), state.stop);
+        if (stopIt == routeStops.end()) {
+            throw InputException("Остановка не входит в маршрут рейса: " + state.stop);
+        }
+        const size_t stopPosition = static_cast<size_t>(stopIt - routeStops.begin());
+        const int recovery = state.recoveryMinutes >= 0 ? state.recoveryMinutes
+                                                        : delayAlgorithm->getRecoveryMinutesPerStop();
+        if (added) {
+            // Добавленного рейса еще нет в индексе: задержка учитывается до его установки
+            size_t affectedStops = 0;
+            added = delayAlgorithm->propagate(*added, stopPosition, state.delayMinutes, recovery, affectedStops);
+        } else {
+            DelayUpdateResult result;
+            delayTrip(tripId, stopPosition, state.delayMinutes, recovery, result);
+        }
+    }
+    if (added) {
+        if (position < trips.size()) {
+            trips[position] = added;
+        } else {
+            trips.push_back(added);
+        }
+        markNetworkChanged();
+    }
+}
+
+void TransportSystem::setDelayRecovery(int minutesPerStop) {
+    WriteGuard guard(*this);
+    delayAlgorithm->setRecoveryMinutesPerStop(minutesPerStop);
+}
+
+bool TransportSystem::isJourneyAffected(const Journey& journey) const {
+    auto network = getSnapshot();
+    const TimetableIndex& index = network->getTimetableIndex();
+    const auto& legs = journey.getTrips();
+    const auto& transfers = journey.getTransferPoints();
+    for (size_t leg = 0; leg < legs.size(); ++leg) {
+        const auto& planned = legs[leg];
+        int position = index.findTrip(planned->getTripId());
+        if (position < 0) {
+            return true;
+        }
+        const auto current = index.getTrip(position);
+        if (current == planned) {
+            continue;
+        }
+
+        // Остановки посадки и высадки: пересадки известны по имени, начало и конец
+        // поездки - по времени отправления и прибытия на первом и последнем рейсе
+        std::vector<std::string> checkStops;
+        auto scheduleStops = planned->getSchedule();
+        if (leg > 0 && leg - 1 < transfers.size()) {
+            checkStops.push_back(transfers[leg - 1]);
+        }
+        if (leg < transfers.size()) {
+            checkStops.push_back(transfers[leg]);
+        }
+        for (const auto& [stop, time] : scheduleStops) {
+            if ((leg == 0 && time == journey.getStartTime()) ||
+                (leg + 1 == legs.size() && time == journey.getEndTime())) {
+                checkStops.push_back(stop);
+            }
+        }
+        for (const auto& stop : checkStops) {
+            auto it = scheduleStops.find(stop);
+            if (it == scheduleStops.end() || !current->hasStop(stop) ||
+                !(current->getArrivalTime(stop) == it->second)) {
+                return true;
+            }
+        }
+    }
+    return false;
 }
 
 ArrivalTimeCalculationAlgorithm* TransportSystem::getArrivalTimeAlgorithm() const {
@@ -141,7 +646,221 @@ RouteSearchAlgorithm* TransportSystem::getRouteSearchAlgorithm() const {
     return routeSearchAlgorithm.get();
 }
 
+TravelTimeMatrixAlgorithm* TransportSystem::getTravelMatrixAlgorithm() const {
+    return travelMatrixAlgorithm.get();
+}
+
+DelayPropagationAlgorithm* TransportSystem::getDelayAlgorithm() const {
+    return delayAlgorithm.get();
+}
+
+TaskScheduler& TransportSystem::getScheduler() {
+    return scheduler;
+}
+
+void TransportSystem::setWorkerThreads(int threads) {
+    scheduler.setWorkerCount(threads);
+}
+
+const TimetableIndex& TransportSystem::getTimetableIndex() const {
+    ensureAllTrips();
+    adoptSnapshotIndexes();
+    if (!timetableIndex || timetableIndexVersion != networkVersion) {
+        // Новый индекс строится отдельно: прежний может удерживать фоновое сохранение
+        auto index = std::make_shared<TimetableIndex>();
+        index->build(trips, stops, transferNetwork);
+        timetableIndex = std::move(index);
+        timetableIndexVersion = networkVersion;
+    }
+    return *timetableIndex;
+}
+
+void TransportSystem::installTimetableIndex(TimetableIndex index) {
+    WriteGuard guard(*this);
+    timetableIndex = std::make_shared<TimetableIndex>(std::move(index));
+    timetableIndexVersion = networkVersion;
+}
+
+NetworkState TransportSystem::captureState() const {
+    WriteGuard guard(*this);
+    ensureAllTrips();
+    NetworkState state;
+    state.routes = routes;
+    if (realtimeOriginals.empty()) {
+        state.trips = trips;
+    } else {
+        // Записывается расписание без оперативных данных: плановые рейсы вместо измененных,
+        // отмененные рейсы возвращаются, добавленные потоком не попадают
+        state.trips.reserve(trips.size() + realtimeOriginals.size());
+        std::unordered_set<int> replaced;
+        for (const auto& trip : trips) {
+            auto it = realtimeOriginals.find(trip->getTripId());
+            if (it == realtimeOriginals.end()) {
+                state.trips.push_back(trip);
+                continue;
+            }
+            replaced.insert(it->first);
+            if (it->second) {
+                state.trips.push_back(it->second);
+            }
+        }
+        for (const auto& [tripId, original] : realtimeOriginals) {
+            if (original && !replaced.count(tripId)) {
+                state.trips.push_back(original);
+            }
+        }
+    }
+    state.vehicles = vehicles;
+    state.drivers = drivers;
+    state.stops = stops;
+    state.adminCredentials = adminCredentials;
+    state.transferNetwork = transferNetwork;
+    state.segmentTable = segmentTable;
+    if (timetableIndex && timetableIndexVersion == networkVersion && realtimeOriginals.empty()) {
+        state.timetableIndex = timetableIndex;
+    }
+    return state;
+}
+
+void TransportSystem::setMinTransferTime(int stopId, int minutes) {
+    WriteGuard guard(*this);
+    transferNetwork.setMinTransferTime(stopId, minutes);
+    markNetworkChanged();
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "transfer|" + std::to_string(stopId) + "|" + std::to_string(minutes));
+    }
+}
+
+void TransportSystem::addFootpath(int fromStopId, int toStopId, int minutes) {
+    WriteGuard guard(*this);
+    transferNetwork.addFootpath(fromStopId, toStopId, minutes);
+    markNetworkChanged();
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "footpath|" + std::to_string(fromStopId) + "|" + std::to_string(toStopId) + "|" + std::to_string(minutes));
+    }
+}
+
+const TransferNetwork& TransportSystem::getTransferNetwork() const {
+    return transferNetwork;
+}
+
+void TransportSystem::setSegmentTable(std::shared_ptr<const SegmentTable> table) {
+    WriteGuard guard(*this);
+    segmentTable = table ? std::move(table) : std::make_shared<SegmentTable>();
+    contentVersion++;
+}
+
+const SegmentTable& TransportSystem::getSegmentTable() const {
+    return *segmentTable;
+}
+
+const ReachabilityIndex& TransportSystem::getReachabilityIndex() const {
+    adoptSnapshotIndexes();
+    if (!reachabilityIndex || reachabilityVersion != networkVersion) {
+        auto index = std::make_shared<ReachabilityIndex>();
+        index->build(getTimetableIndex(), REACHABILITY_MAX_TRANSFERS);
+        reachabilityIndex = std::move(index);
+        reachabilityVersion = networkVersion;
+    }
+    return *reachabilityIndex;
+}
+
+unsigned long long TransportSystem::getNetworkVersion() const {
+    return networkVersion;
+}
+
+void TransportSystem::markNetworkChanged() {
+    networkVersion++;
+    contentVersion++;
+}
+
+void TransportSystem::adoptSnapshotIndexes() const {
+    auto published = snapshot.load(std::memory_order_acquire);
+    if (!published) {
+        return;
+    }
+    if ((!timetableIndex || timetableIndexVersion != networkVersion) &&
+        published->getContentVersion() == contentVersion) {
+        if (auto built = published->builtTimetableIndex()) {
+            timetableIndex = std::move(built);
+            timetableIndexVersion = networkVersion;
+        }
+    }
+    // Задержки не меняют замыкание, поэтому достаточно совпадения версии сети
+    if ((!reachabilityIndex || reachabilityVersion != networkVersion) &&
+        published->getNetworkVersion() == networkVersion) {
+        if (auto built = published->builtReachabilityIndex()) {
+            reachabilityIndex = std::move(built);
+            reachabilityVersion = networkVersion;
+        }
+    }
+}
+
+std::shared_ptr<const NetworkSnapshot> TransportSystem::getSnapshot() const {
+    auto published = snapshot.load(std::memory_order_acquire);
+    if (published && published->getContentVersion() == contentVersion.load(std::memory_order_acquire)) {
+        return published;
+    }
+    if (writerThread.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        // Незавершенное изменение не публикуется
+        return makeSnapshot();
+    }
+    // Пока другой поток изменяет сеть, запрос не ждет его и идет по последнему опубликованному снимку
+    std::shared_lock<std::shared_mutex> lock(networkMutex, std::try_to_lock);
+    if (!lock.owns_lock() && published && published->getContentVersion() >= lastOwnWriteVersion) {
+        return published;
+    }
+    if (!lock.owns_lock()) {
+        lock.lock();
+    }
+    publishIfChanged();
+    return snapshot.load(std::memory_order_acquire);
+}
+
+void TransportSystem::publishSnapshot() const {
+    ReadGuard guard(*this);
+    publishIfChanged();
+}
+
+void TransportSystem::publishIfChanged() const {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    auto published = snapshot.load(std::memory_order_acquire);
+    if (published && published->getContentVersion() == contentVersion.load(std::memory_order_acquire)) {
+        return;
+    }
+    // Индексы прежнего снимка, еще верные для текущей сети, переходят в новый
+    adoptSnapshotIndexes();
+    // Прежний снимок освобождается, когда его отпустит последний запрос
+    snapshot.store(makeSnapshot(), std::memory_order_release);
+}
+
+std::shared_ptr<const NetworkSnapshot> TransportSystem::makeSnapshot() const {
+    // Копируются только указатели: маршруты и рейсы не изменяются на месте
+    NetworkSnapshot::Contents contents;
+    contents.contentVersion = contentVersion.load(std::memory_order_acquire);
+    contents.networkVersion = networkVersion;
+    contents.routes = routes;
+    {
+        std::lock_guard<std::mutex> lock(lazyMutex);
+        contents.trips = trips;
+        contents.lazyTrips = lazyTrips;
+    }
+    contents.stops = stops;
+    contents.stopIdToName = stopIdToName;
+    contents.transferNetwork = transferNetwork;
+    contents.segmentTable = segmentTable;
+    contents.reachabilityTransfers = REACHABILITY_MAX_TRANSFERS;
+    if (timetableIndex && timetableIndexVersion == networkVersion) {
+        contents.timetableIndex = timetableIndex;
+    }
+    if (reachabilityIndex && reachabilityVersion == networkVersion) {
+        contents.reachabilityIndex = reachabilityIndex;
+    }
+    return std::make_shared<const NetworkSnapshot>(std::move(contents));
+}
+
 void TransportSystem::addRoute(std::shared_ptr<Route> route) {
+    WriteGuard guard(*this);
     for (const auto& existingRoute : routes) {
         if (existingRoute->getNumber() == route->getNumber()) {
             throw ContainerException("Маршрут с номером " + std::to_string(route->getNumber()) + " уже существует");
@@ -151,6 +870,8 @@ void TransportSystem::addRoute(std::shared_ptr<Route> route) {
 }
 
 void TransportSystem::addTrip(std::shared_ptr<Trip> trip) {
+    WriteGuard guard(*this);
+    ensureAllTrips();
     for (const auto& existingTrip : trips) {
         if (existingTrip->getTripId() == trip->getTripId()) {
             throw ContainerException("Рейс с ID " + std::to_string(trip->getTripId()) + " уже существует");
@@ -187,6 +908,7 @@ void TransportSystem::addTrip(std::shared_ptr<Trip> trip) {
 }
 
 void TransportSystem::addVehicle(std::shared_ptr<Vehicle> vehicle) {
+    WriteGuard guard(*this);
     for (const auto& existingVehicle : vehicles) {
         if (existingVehicle->getLicensePlate() == vehicle->getLicensePlate()) {
             throw ContainerException("Транспортное средство с номером " + vehicle->getLicensePlate() + " уже существует");
@@ -196,10 +918,12 @@ void TransportSystem::addVehicle(std::shared_ptr<Vehicle> vehicle) {
 }
 
 void TransportSystem::addDriver(std::shared_ptr<Driver> driver) {
+    WriteGuard guard(*this);
     commandHistory.executeCommand(std::make_unique<AddDriverCommand>(this, driver));
 }
 
 void TransportSystem::addStop(const Stop& stop) {
+    WriteGuard guard(*this);
     for (const auto& existingStop : stops) {
         if (existingStop.getId() == stop.getId()) {
             throw ContainerException("Остановка с ID " + std::to_string(stop.getId()) + " уже существует");
@@ -209,6 +933,7 @@ void TransportSystem::addStop(const Stop& stop) {
 }
 
 void TransportSystem::removeRoute(int routeNumber) {
+    WriteGuard guard(*this);
     auto it = std::find_if(routes.begin(), routes.end(),
                           [routeNumber](const auto& r) { return r->getNumber() == routeNumber; });
     if (it == routes.end()) {
@@ -219,6 +944,8 @@ void TransportSystem::removeRoute(int routeNumber) {
 }
 
 void TransportSystem::removeTrip(int tripId) {
+    WriteGuard guard(*this);
+    ensureAllTrips();
     auto it = std::find_if(trips.begin(), trips.end(),
                           [tripId](const auto& t) { return t->getTripId() == tripId; });
     if (it == trips.end()) {
@@ -229,6 +956,7 @@ void TransportSystem::removeTrip(int tripId) {
 }
 
 void TransportSystem::displayAllRoutes() const {
+    ReadGuard guard(*this);
     std::cout << "\n=== ВСЕ МАРШРУТЫ ===\n";
     for (const auto& route : routes) {
         std::cout << "Маршрут " << route->getNumber() << " (" << route->getVehicleType()
@@ -237,6 +965,8 @@ void TransportSystem::displayAllRoutes() const {
 }
 
 void TransportSystem::displayAllTrips() const {
+    ReadGuard guard(*this);
+    ensureAllTrips();
     std::cout << "\n=== ВСЕ РЕЙСЫ ===\n";
     for (const auto& trip : trips) {
         std::cout << "Рейс " << trip->getTripId() << ": Маршрут " << trip->getRoute()->getNumber()
@@ -247,6 +977,7 @@ void TransportSystem::displayAllTrips() const {
 }
 
 void TransportSystem::displayAllVehicles() const {
+    ReadGuard guard(*this);
     std::cout << "\n=== ВСЕ ТРАНСПОРТНЫЕ СРЕДСТВА ===\n";
     for (const auto& vehicle : vehicles) {
         std::cout << vehicle->getInfo() << '\n';
@@ -254,6 +985,7 @@ void TransportSystem::displayAllVehicles() const {
 }
 
 void TransportSystem::displayAllStops() const {
+    ReadGuard guard(*this);
     std::cout << "\n=== ВСЕ ОСТАНОВКИ ===\n";
     for (const auto& stop : stops) {
         std::cout << "ID: " << stop.getId() << " - " << stop.getName() << '\n';
@@ -261,9 +993,16 @@ void TransportSystem::displayAllStops() const {
 }
 
 const std::vector<std::shared_ptr<Trip>>& TransportSystem::getTrips() const {
+    ensureAllTrips();
     return trips;
 }
 
+size_t TransportSystem::getTripCount() const {
+    ReadGuard guard(*this);
+    std::lock_guard<std::mutex> lock(lazyMutex);
+    return trips.size() + (lazyTrips ? lazyTrips->tripCount() : 0);
+}
+
 const std::vector<std::shared_ptr<Route>>& TransportSystem::getRoutes() const {
     return routes;
 }
@@ -291,6 +1030,7 @@ DriverSchedule& TransportSystem::getDriverSchedule() {
 std::shared_ptr<Driver> TransportSystem::findDriverByName(const std::string& firstName,
                                         const std::string& lastName,
                                         const std::string& middleName) const {
+    ReadGuard guard(*this);
     for (const auto& driver : drivers) {
         if (driver->getFirstName() == firstName &&
             driver->getLastName() == lastName &&
@@ -302,6 +1042,7 @@ std::shared_ptr<Driver> TransportSystem::findDriverByName(const std::string& fir
 }
 
 std::shared_ptr<Vehicle> TransportSystem::findVehicleByLicensePlate(const std::string& licensePlate) const {
+    ReadGuard guard(*this);
     for (const auto& vehicle : vehicles) {
         if (vehicle->getLicensePlate() == licensePlate) {
             return vehicle;
@@ -311,6 +1052,7 @@ std::shared_ptr<Vehicle> TransportSystem::findVehicleByLicensePlate(const std::s
 }
 
 std::shared_ptr<Route> TransportSystem::findRouteByNumber(int number) const {
+    ReadGuard guard(*this);
     for (const auto& route : routes) {
         if (route->getNumber() == number) {
             return route;
@@ -320,16 +1062,15 @@ std::shared_ptr<Route> TransportSystem::findRouteByNumber(int number) const {
 }
 
 std::vector<std::shared_ptr<Trip>> TransportSystem::getTripsThroughStop(const std::string& stopName) const {
-    std::vector<std::shared_ptr<Trip>> result;
-    for (const auto& trip : trips) {
-        if (trip->hasStop(stopName)) {
-            result.push_back(trip);
-        }
-    }
-    return result;
+    return getSnapshot()->getTripsThroughStop(stopName);
+}
+
+std::vector<std::shared_ptr<Trip>> TransportSystem::getTripsByVehicleType(const std::string& vehicleType) const {
+    return getSnapshot()->getTripsByVehicleType(vehicleType);
 }
 
 std::string TransportSystem::getStopNameById(int id) const {
+    ReadGuard guard(*this);
     auto it = stopIdToName.find(id);
     if (it != stopIdToName.end()) {
         return it->second;
@@ -338,6 +1079,7 @@ std::string TransportSystem::getStopNameById(int id) const {
 }
 
 std::shared_ptr<Route> TransportSystem::getRouteByNumber(int number) {
+    ReadGuard guard(*this);
     for (const auto& route : routes) {
         if (route->getNumber() == number) {
             return route;
@@ -347,6 +1089,8 @@ std::shared_ptr<Route> TransportSystem::getRouteByNumber(int number) {
 }
 
 std::shared_ptr<Trip> TransportSystem::getTripById(int id) {
+    ReadGuard guard(*this);
+    ensureAllTrips();
     for (const auto& trip : trips) {
         if (trip->getTripId() == id) {
             return trip;
@@ -356,6 +1100,7 @@ std::shared_ptr<Trip> TransportSystem::getTripById(int id) {
 }
 
 std::shared_ptr<Vehicle> TransportSystem::getVehicleByLicensePlate(const std::string& licensePlate) {
+    ReadGuard guard(*this);
     for (const auto& vehicle : vehicles) {
         if (vehicle->getLicensePlate() == licensePlate) {
             return vehicle;
@@ -365,6 +1110,7 @@ std::shared_ptr<Vehicle> TransportSystem::getVehicleByLicensePlate(const std::st
 }
 
 Stop TransportSystem::getStopById(int id) {
+    ReadGuard guard(*this);
     for (const auto& stop : stops) {
         if (stop.getId() == id) {
             return stop;
@@ -374,34 +1120,63 @@ Stop TransportSystem::getStopById(int id) {
 }
 
 void TransportSystem::addRouteDirect(std::shared_ptr<Route> route) {
-    routes.push_back(std::move(route));
+    WriteGuard guard(*this);
+    routes.push_back(route);
+    markNetworkChanged();
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "+route|" + route->serialize());
+    }
 }
 
 void TransportSystem::removeRouteDirect(int routeNumber) {
+    WriteGuard guard(*this);
     auto it = std::find_if(routes.begin(), routes.end(),
                           [routeNumber](const auto& r) { return r->getNumber() == routeNumber; });
     if (it != routes.end()) {
         routes.erase(it);
     }
+    markNetworkChanged();
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "-route|" + std::to_string(routeNumber));
+    }
 }
 
 void TransportSystem::addTripDirect(std::shared_ptr<Trip> trip) {
-    trips.push_back(std::move(trip));
+    WriteGuard guard(*this);
+    // Изменения администратора заменяют план и для рейсов из оперативных данных
+    realtimeOriginals.erase(trip->getTripId());
+    trips.push_back(trip);
+    markNetworkChanged();
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "+trip|" + trip->serialize());
+    }
 }
 
 void TransportSystem::removeTripDirect(int tripId) {
+    WriteGuard guard(*this);
+    ensureAllTrips();
     auto it = std::find_if(trips.begin(), trips.end(),
                           [tripId](const auto& t) { return t->getTripId() == tripId; });
     if (it != trips.end()) {
         trips.erase(it);
     }
+    realtimeOriginals.erase(tripId);
+    markNetworkChanged();
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "-trip|" + std::to_string(tripId));
+    }
 }
 
 void TransportSystem::addVehicleDirect(std::shared_ptr<Vehicle> vehicle) {
-    vehicles.push_back(std::move(vehicle));
+    WriteGuard guard(*this);
+    vehicles.push_back(vehicle);
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "+vehicle|" + vehicle->serialize());
+    }
 }
 
 void TransportSystem::removeVehicleDirect(const std::string& licensePlate) {
+    WriteGuard guard(*this);
     auto it = std::find_if(vehicles.begin(), vehicles.end(),
                           [&licensePlate](const auto& v) {
                               return v->getLicensePlate() == licensePlate;
@@ -409,27 +1184,48 @@ void TransportSystem::removeVehicleDirect(const std::string& licensePlate) {
     if (it != vehicles.end()) {
         vehicles.erase(it);
     }
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "-vehicle|" + licensePlate);
+    }
 }
 
 void TransportSystem::addStopDirect(const Stop& stop) {
+    WriteGuard guard(*this);
     stops.push_back(stop);
     stopIdToName[stop.getId()] = stop.getName();
+    markNetworkChanged();
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "+stop|" + stop.serialize());
+    }
 }
 
 void TransportSystem::removeStopDirect(int stopId) {
+    WriteGuard guard(*this);
     auto it = std::find_if(stops.begin(), stops.end(),
                           [stopId](const auto& s) { return s.getId() == stopId; });
     if (it != stops.end()) {
         stopIdToName.erase(stopId);
         stops.erase(it);
     }
+    // Иначе правила перешли бы к новой остановке с тем же ID. Запись "-stop" при повторе
+    // журнала удаляет их так же, а отмена команды восстанавливает отдельными записями
+    transferNetwork.removeStop(stopId);
+    markNetworkChanged();
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "-stop|" + std::to_string(stopId));
+    }
 }
 
 void TransportSystem::addDriverDirect(std::shared_ptr<Driver> driver) {
-    drivers.push_back(std::move(driver));
+    WriteGuard guard(*this);
+    drivers.push_back(driver);
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "+driver|" + driver->serialize());
+    }
 }
 
 void TransportSystem::removeDriverDirect(std::shared_ptr<Driver> driver) {
+    WriteGuard guard(*this);
     auto it = std::find_if(drivers.begin(), drivers.end(),
                           [&driver](const auto& d) {
                               return d->getFirstName() == driver->getFirstName() &&
@@ -439,5 +1235,8 @@ void TransportSystem::removeDriverDirect(std::shared_ptr<Driver> driver) {
     if (it != drivers.end()) {
         drivers.erase(it);
     }
+    if (dataManager.isJournalOpen()) {
+        dataManager.recordChange(*this, "-driver|" + driver->getFirstName() + "|" + driver->getLastName() + "|" + driver->getMiddleName());
+    }
 }
 
@@ -5,6 +5,13 @@
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <optional>
 #include "dynamic_array.h"
 #include "stop.h"
 #include "route.h"
@@ -18,32 +25,149 @@
 #include "command.h"
 #include "commands.h"
 #include "algorithm.h"
+#include "timetable.h"
+#include "transfer_network.h"
+#include "segment_table.h"
+#include "network_state.h"
+#include "reachability.h"
+#include "travel_matrix.h"
+#include "gtfs_importer.h"
+#include "lazy_trip_store.h"
+#include "realtime_feed.h"
+#include "network_snapshot.h"
+#include "task_scheduler.h"
 #include "exceptions.h"
 #include <iostream>
 #include <algorithm>
 #include <memory>
 
+// Схема блокировок (несколько потоков запросов и изменения сети):
+// - изменения сети (команды, undo/redo, прямые методы, загрузка, задержки, перезагрузка)
+//   выполняются под networkMutex монопольно (WriteGuard) и поэтому идут по одному;
+//   вложенный вызов из того же потока блокировку повторно не берет;
+// - простые поиски по номеру или ID берут networkMutex на чтение (ReadGuard);
+// - поиск маршрутов и поездок, расписание остановки и рейсы через остановку выполняются
+//   по снимку сети без блокировок; networkMutex на чтение берется только на время
+//   публикации снимка, если прежний устарел (publishMutex - чтобы его строил один поток);
+// - методы, возвращающие ссылки на данные системы (getTrips, getRoutes, getStops,
+//   getTimetableIndex и т.п.), предназначены для потока, изменяющего сеть; другие
+//   потоки читают те же данные из getSnapshot();
+// - состояние алгоритмов: алгоритмы поиска поездок и маршрутов состояния не хранят;
+//   матрица времени в пути строится из любого потока (статистика последнего построения
+//   под своим мьютексом); настройки и статистика ArrivalTimeCalculationAlgorithm
+//   (getLastBatchStats) и нагон DelayPropagationAlgorithm меняются только при изменении
+//   сети и читаются потоком, изменяющим сеть.
+// Отдельные мьютексы reloadMutex и lazyMutex защищают только свои поля.
 class TransportSystem {
 private:
     std::vector<std::shared_ptr<Route>> routes;
-    std::vector<std::shared_ptr<Trip>> trips;
+    // Рейсы, еще не разобранные при загрузке по требованию, лежат в lazyTrips
+    // и переносятся в trips перед первым обращением ко всему списку
+    mutable std::vector<std::shared_ptr<Trip>> trips;
+    mutable std::shared_ptr<LazyTripStore> lazyTrips;
+    mutable std::mutex lazyMutex; // перенос отложенных рейсов в trips (может начать любой читатель)
     std::vector<std::shared_ptr<Vehicle>> vehicles;
     std::vector<std::shared_ptr<Driver>> drivers;
     DynamicArray<Stop> stops;
     std::unordered_map<int, std::string> stopIdToName;
     std::unordered_map<std::string, std::string> adminCredentials;
+    TransferNetwork transferNetwork;
+    // Расстояния и скорости перегонов для расчета времени прибытия (segments.txt)
+    std::shared_ptr<const SegmentTable> segmentTable = std::make_shared<SegmentTable>();
+
+    // Общие рабочие потоки для параллельных алгоритмов, загрузки и импорта;
+    // объявлен раньше их, чтобы пережить их задачи
+    TaskScheduler scheduler;
 
     JourneyPlanner journeyPlanner;
     DriverSchedule driverSchedule;
+    // Сеть, загруженная из замененных извне файлов и ожидающая подмены (см. startHotReload).
+    // Заполняется потоком наблюдения dataManager, поэтому объявлена раньше него
+    std::mutex reloadMutex;
+    std::shared_ptr<ReloadResult> pendingReload;
     DataManager dataManager;
     CommandHistory commandHistory;
     
     // Алгоритмы (Strategy pattern)
     std::unique_ptr<ArrivalTimeCalculationAlgorithm> arrivalTimeAlgorithm;
     std::unique_ptr<RouteSearchAlgorithm> routeSearchAlgorithm;
+    std::unique_ptr<TravelTimeMatrixAlgorithm> travelMatrixAlgorithm;
+    std::unique_ptr<DelayPropagationAlgorithm> delayAlgorithm;
+
+    // Поток оперативных обновлений и последний перенесенный в сеть пакет
+    std::unique_ptr<RealtimeFeed> realtimeFeed;
+    unsigned long long realtimeMergedBatch = 0;
+    // Плановые рейсы, замененные оперативными данными (nullptr - рейса в расписании не было).
+    // Оперативные данные не сохраняются: в копию сети для записи попадают эти рейсы
+    std::unordered_map<int, std::shared_ptr<Trip>> realtimeOriginals;
+
+    // Глубина предрассчитанного замыкания достижимости (совпадает с числом пересадок по умолчанию)
+    static const int REACHABILITY_MAX_TRANSFERS = 2;
+
+    // Версия сети увеличивается при каждом изменении маршрутов, рейсов или остановок;
+    // производные индексы перестраиваются лениво при несовпадении версии
+    unsigned long long networkVersion = 0;
+    // Увеличивается при любом изменении данных снимка, в том числе при задержке рейса,
+    // которая обновляет индекс на месте и версию сети не меняет
+    std::atomic<unsigned long long> contentVersion{0};
+    mutable unsigned long long timetableIndexVersion = 0;
+    // Индекс может одновременно использоваться фоновым сохранением и снимками, поэтому на месте
+    // (applyDelay) изменяется только единственная копия, иначе сначала копируется
+    mutable std::shared_ptr<const TimetableIndex> timetableIndex;
+    mutable unsigned long long reachabilityVersion = 0;
+    mutable std::shared_ptr<const ReachabilityIndex> reachabilityIndex;
+
+    // Опубликованный снимок сети для запросов (см. getSnapshot)
+    mutable std::atomic<std::shared_ptr<const NetworkSnapshot>> snapshot;
+
+    mutable std::shared_mutex networkMutex;
+    mutable std::mutex publishMutex;
+    // Поток, который сейчас изменяет сеть (держит networkMutex монопольно)
+    mutable std::atomic<std::thread::id> writerThread;
+
+    class WriteGuard {
+    private:
+        const TransportSystem& system;
+        std::unique_lock<std::shared_mutex> lock;
+
+    public:
+        explicit WriteGuard(const TransportSystem& owner);
+        ~WriteGuard();
+    };
+
+    class ReadGuard {
+    private:
+        std::shared_lock<std::shared_mutex> lock;
+
+    public:
+        explicit ReadGuard(const TransportSystem& owner);
+    };
+
+    // Снимок текущего состояния; вызывается под networkMutex (на чтение или монопольно)
+    std::shared_ptr<const NetworkSnapshot> makeSnapshot() const;
+    // Публикация, если снимок устарел; вызывается под networkMutex
+    void publishIfChanged() const;
+
+    void markNetworkChanged();
+    // Индексы, построенные снимком той же версии, принимаются системой без перестройки
+    void adoptSnapshotIndexes() const;
+    // Позиция рейса в trips (trips.size(), если нет); indexPosition - позиция в актуальном индексе или -1
+    size_t findTripPosition(int tripId, int& indexPosition) const;
+    // Замена рейса копией с задержкой и обновление индекса без журнала
+    std::shared_ptr<Trip> delayTrip(int tripId, size_t stopPosition, int delayMinutes, int recoveryMinutes,
+                                    DelayUpdateResult& result);
+    // linker создается при первом добавленном рейсе и используется до конца переноса
+    void mergeRealtimeTrip(int tripId, const RealtimeTripState& state, std::optional<TripLinker>& linker);
+    // Загрузка и проверка новых файлов в отдельной системе; выполняется в потоке наблюдения
+    void prepareReload();
+    // Замена всех данных сети (рейсы, маршруты, остановки, индекс) готовой копией
+    void installNetwork(const NetworkState& state);
+    // Разбирает все отложенные рейсы; вызывается перед любым обходом всего списка рейсов
+    void ensureAllTrips() const;
 
 public:
     TransportSystem();
+    explicit TransportSystem(const std::string& dataDirectory);
 
     bool canUndo() const;
     void undo();
@@ -57,17 +181,101 @@ public:
     const std::unordered_map<std::string, std::string>& getAdminCredentials() const;
     void setAdminCredentials(const std::unordered_map<std::string, std::string>& creds);
 
+    // Изменения сохраняются в журнал сразу; saveData перезаписывает файлы
+    // в фоновом потоке, только когда журнал пора уплотнить. compactData перезаписывает их всегда
+    // и дожидается окончания записи
     void saveData();
+    void compactData();
     void loadData();
+    // Рейсы загружаются по маршрутам при первом обращении (см. DataManager::setLazyTripLoading)
+    void setLazyTripLoading(bool enabled);
+    void installLazyTrips(std::shared_ptr<LazyTripStore> store);
+    void waitForSave();
+    // Горячая перезагрузка: каталог данных опрашивается с заданным интервалом; замененные извне
+    // файлы загружаются в фоне в новую систему (с применением журнала, как при запуске),
+    // проверяются, и готовая сеть подменяет текущую целиком в applyPendingReload.
+    // Рейсы, отложенные при загрузке по требованию, разбираются до начала наблюдения
+    void startHotReload(std::chrono::milliseconds pollInterval = std::chrono::milliseconds(2000));
+    void stopHotReload();
+    // Вызывается между командами: запрос, начатый до подмены, дорабатывает на прежних данных.
+    // История отмены очищается. true, если сеть заменена
+    bool applyPendingReload();
+    // Сообщает о завершении фонового сохранения (один раз на каждое завершение)
+    void reportSaveStatus();
+    SaveStatus getSaveStatus() const;
+    // Копия данных сети для сохранения без остановки работы системы
+    NetworkState captureState() const;
+    // Сжатый архив текущего расписания (data/archive/network-NNNN.tnc); возвращает путь
+    std::string archiveData();
+    // Загрузка архива в пустую систему
+    void loadArchive(const std::string& path);
+    // Импорт расписания GTFS из каталога и полное сохранение результата
+    GtfsImportStats importGtfs(const std::string& feedDirectory);
 
     std::vector<std::shared_ptr<Route>> findRoutes(const std::string& stopA, const std::string& stopB);
     void getStopTimetable(int stopId, const Time& startTime, const Time& endTime);
     void getStopTimetableAll(const std::string& stopName);
     void calculateArrivalTimes(int tripId, double averageSpeed);
+    // Пакетный пересчет времени прибытия рейсов, прошедших фильтр (пустой фильтр - все рейсы),
+    // со скоростью speedOf(рейс). Рейсы заменяются пересчитанными копиями
+    ArrivalBatchStats recalculateArrivalTimes(const std::function<bool(const Trip&)>& filter,
+                                              const std::function<double(const Trip&)>& speedOf);
+    TravelTimeMatrix buildTravelTimeMatrix(const Time& departureTime, int weekDay = 0);
+    // Оперативное сообщение: рейс tripId опаздывает на delayMinutes на остановке stopPosition
+    // своего маршрута. Рейс заменяется копией с прогнозом времени, индекс расписания
+    // обновляется только в измененных перегонах, без смены версии сети.
+    // Без recoveryMinutes используется нагон по умолчанию (setDelayRecovery)
+    DelayUpdateResult applyDelay(int tripId, size_t stopPosition, int delayMinutes);
+    DelayUpdateResult applyDelay(int tripId, size_t stopPosition, int delayMinutes, int recoveryMinutes);
+    void setDelayRecovery(int minutesPerStop);
+    // Поездка, найденная до задержки, стала неточной: время ее рейсов на остановках
+    // посадки, пересадки или высадки изменилось (или рейс удален)
+    bool isJourneyAffected(const Journey& journey) const;
+
+    // Оперативные обновления (задержки, отмены, добавленные рейсы) из файла или именованного
+    // канала; пустой путь - realtime.txt в каталоге данных. Поток чтения публикует накопленные
+    // данные атомарной заменой указателя, в сеть они переносятся в applyRealtimeUpdates
+    void startRealtimeFeed(const std::string& sourcePath = "",
+                           std::chrono::milliseconds pollInterval = std::chrono::milliseconds(500));
+    void stopRealtimeFeed();
+    // Вызывается между командами (как applyPendingReload). true, если перенесен новый пакет
+    bool applyRealtimeUpdates();
+    // Последние опубликованные оперативные данные; читается из любого потока без блокировок
+    std::shared_ptr<const RealtimeOverlay> getRealtimeOverlay() const;
+    RealtimeFeedStats getRealtimeStats() const;
     
     // Получение алгоритмов
     ArrivalTimeCalculationAlgorithm* getArrivalTimeAlgorithm() const;
     RouteSearchAlgorithm* getRouteSearchAlgorithm() const;
+    TravelTimeMatrixAlgorithm* getTravelMatrixAlgorithm() const;
+    DelayPropagationAlgorithm* getDelayAlgorithm() const;
+
+    // Планировщик задач системы; число рабочих потоков меняется, когда задачи не выполняются
+    TaskScheduler& getScheduler();
+    void setWorkerThreads(int threads);
+
+    // Минимальное время пересадки и пешие переходы (идентификаторы остановок)
+    void setMinTransferTime(int stopId, int minutes);
+    void addFootpath(int fromStopId, int toStopId, int minutes);
+    const TransferNetwork& getTransferNetwork() const;
+    // Таблица перегонов заменяется целиком; уже рассчитанные рейсы не пересчитываются
+    void setSegmentTable(std::shared_ptr<const SegmentTable> table);
+    const SegmentTable& getSegmentTable() const;
+
+    const TimetableIndex& getTimetableIndex() const;
+    // Принимает готовый индекс (например, из бинарного снимка) для текущей версии сети
+    void installTimetableIndex(TimetableIndex index);
+    const ReachabilityIndex& getReachabilityIndex() const;
+    unsigned long long getNetworkVersion() const;
+
+    // Снимок сети для запроса (RCU): запрос держит указатель до конца и видит одно
+    // согласованное состояние, пока администратор вносит изменения. Актуальный снимок
+    // возвращается без блокировок; устаревший сначала публикуется заново. Внутри изменения
+    // сети поток получает неопубликованный снимок своего промежуточного состояния
+    std::shared_ptr<const NetworkSnapshot> getSnapshot() const;
+    // Публикация снимка текущего состояния (если оно изменилось с прошлой публикации);
+    // вызывается после каждой завершенной команды
+    void publishSnapshot() const;
 
     void addRoute(std::shared_ptr<Route> route);
     void addTrip(std::shared_ptr<Trip> trip);
@@ -82,7 +290,9 @@ public:
     void displayAllVehicles() const;
     void displayAllStops() const;
 
+    // Полный список рейсов; при загрузке по требованию сначала разбираются все отложенные
     const std::vector<std::shared_ptr<Trip>>& getTrips() const;
+    size_t getTripCount() const;
     const std::vector<std::shared_ptr<Route>>& getRoutes() const;
     const std::vector<std::shared_ptr<Vehicle>>& getVehicles() const;
     const DynamicArray<Stop>& getStops() const;
@@ -96,7 +306,9 @@ public:
                                             const std::string& middleName = "") const;
     std::shared_ptr<Vehicle> findVehicleByLicensePlate(const std::string& licensePlate) const;
     std::shared_ptr<Route> findRouteByNumber(int number) const;
+    // Поиск рейсов по снимку сети без разбора всех отложенных: читаются только подходящие маршруты
     std::vector<std::shared_ptr<Trip>> getTripsThroughStop(const std::string& stopName) const;
+    std::vector<std::shared_ptr<Trip>> getTripsByVehicleType(const std::string& vehicleType) const;
     std::string getStopNameById(int id) const;
 
     std::shared_ptr<Route> getRouteByNumber(int number);
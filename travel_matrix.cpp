@@ -0,0 +1,194 @@
+#include "travel_matrix.h"
+#include "transport_system.h"
+#include "timetable.h"
+#include "exceptions.h"
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+
+TravelTimeMatrix::TravelTimeMatrix(const std::vector<std::string>& stops, const Time& departure, int day)
+    : stopNames(stops), departureTime(departure), weekDay(day),
+      travelMinutes(stops.size() * stops.size(), NO_ROUTE_MINUTES),
+      transferCounts(stops.size() * stops.size(), NO_ROUTE_TRANSFERS) {}
+
+int TravelTimeMatrix::getStopCount() const {
+    return static_cast<int>(stopNames.size());
+}
+
+const std::vector<std::string>& TravelTimeMatrix::getStopNames() const {
+    return stopNames;
+}
+
+Time TravelTimeMatrix::getDepartureTime() const {
+    return departureTime;
+}
+
+int TravelTimeMatrix::getWeekDay() const {
+    return weekDay;
+}
+
+bool TravelTimeMatrix::isReachable(int from, int to) const {
+    return travelMinutes[static_cast<size_t>(from) * stopNames.size() + to] != NO_ROUTE_MINUTES;
+}
+
+int TravelTimeMatrix::getTravelMinutes(int from, int to) const {
+    uint16_t value = travelMinutes[static_cast<size_t>(from) * stopNames.size() + to];
+    return value == NO_ROUTE_MINUTES ? -1 : value;
+}
+
+int TravelTimeMatrix::getTransferCount(int from, int to) const {
+    uint8_t value = transferCounts[static_cast<size_t>(from) * stopNames.size() + to];
+    return value == NO_ROUTE_TRANSFERS ? -1 : value;
+}
+
+void TravelTimeMatrix::setCell(int from, int to, int minutes, int transfers) {
+    size_t cell = static_cast<size_t>(from) * stopNames.size() + to;
+    travelMinutes[cell] = static_cast<uint16_t>(minutes);
+    transferCounts[cell] = static_cast<uint8_t>(std::min(transfers, NO_ROUTE_TRANSFERS - 1));
+}
+
+// Формат: "TTMX", версия, число остановок, время отправления, день недели,
+// названия остановок (длина + байты), затем матрица минут (uint16) и пересадок (uint8)
+void TravelTimeMatrix::saveBinary(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) throw FileException(path, "открытие для записи");
+
+    const char magic[4] = {'T', 'T', 'M', 'X'};
+    uint32_t version = 1;
+    uint32_t count = static_cast<uint32_t>(stopNames.size());
+    uint16_t departure = static_cast<uint16_t>(departureTime.getTotalMinutes());
+    uint8_t day = static_cast<uint8_t>(weekDay);
+
+    file.write(magic, sizeof(magic));
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(&departure), sizeof(departure));
+    file.write(reinterpret_cast<const char*>(&day), sizeof(day));
+
+    for (const auto& name : stopNames) {
+        uint32_t nameLen = static_cast<uint32_t>(name.size());
+        file.write(reinterpret_cast<const char*>(&nameLen), sizeof(nameLen));
+        file.write(name.data(), nameLen);
+    }
+
+    file.write(reinterpret_cast<const char*>(travelMinutes.data()),
+               static_cast<std::streamsize>(travelMinutes.size() * sizeof(uint16_t)));
+    file.write(reinterpret_cast<const char*>(transferCounts.data()),
+               static_cast<std::streamsize>(transferCounts.size() * sizeof(uint8_t)));
+
+    if (!file) throw FileException(path, "запись");
+}
+
+void TravelTimeMatrix::saveCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) throw FileException(path, "открытие для записи");
+
+    auto quoted = [](const std::string& value) {
+        std::string result = "\"";
+        for (char ch : value) {
+            if (ch == '"') result += '"';
+            result += ch;
+        }
+        return result + "\"";
+    };
+
+    file << "откуда,куда,минут,пересадок\n";
+    const int n = getStopCount();
+    for (int from = 0; from < n; ++from) {
+        for (int to = 0; to < n; ++to) {
+            if (from == to || !isReachable(from, to)) {
+                continue;
+            }
+            file << quoted(stopNames[from]) << ',' << quoted(stopNames[to]) << ','
+                 << getTravelMinutes(from, to) << ',' << getTransferCount(from, to) << '\n';
+        }
+    }
+
+    if (!file) throw FileException(path, "запись");
+}
+
+TravelTimeMatrixAlgorithm::TravelTimeMatrixAlgorithm(TransportSystem* sys, int threads)
+    : Algorithm(sys), threadCount(threads) {}
+
+TravelTimeMatrix TravelTimeMatrixAlgorithm::build(const Time& departureTime, int weekDay, MatrixBuildStats* stats) {
+    if (weekDay < 0 || weekDay > 7) {
+        throw InputException("День недели должен быть от 1 до 7 (0 - любой день)");
+    }
+
+    // Снимок удерживает индекс, пока рабочие потоки считают строки матрицы
+    auto network = system->getSnapshot();
+    const TimetableIndex& index = network->getTimetableIndex();
+    TravelTimeMatrix matrix(index.getStopNames(), departureTime, weekDay);
+    const int stopCount = index.getStopCount();
+    const int departure = departureTime.getTotalMinutes();
+
+    TaskScheduler& scheduler = system->getScheduler();
+    int workers = threadCount > 0 ? threadCount : scheduler.getWorkerCount() + 1;
+    workers = std::max(1, std::min(workers, std::max(1, stopCount)));
+
+    MatrixBuildStats buildStats;
+    buildStats.originsPerThread.assign(workers, 0);
+    buildStats.busySecondsPerThread.assign(workers, 0.0);
+
+    // Остановки раздаются задачам по одной через общий счетчик,
+    // поэтому медленные источники не задерживают остальные задачи
+    std::atomic<int> nextOrigin{0};
+    auto worker = [&](int id) {
+        auto started = std::chrono::steady_clock::now();
+        std::vector<int> arrival;
+        std::vector<int> transfers;
+        int origin;
+        while ((origin = nextOrigin.fetch_add(1)) < stopCount) {
+            index.earliestArrivalFromStop(origin, departure, weekDay, arrival, transfers);
+            // Каждая задача пишет только в свою строку матрицы
+            for (int to = 0; to < stopCount; ++to) {
+                if (arrival[to] != TimetableIndex::UNREACHABLE) {
+                    matrix.setCell(origin, to, arrival[to] - departure, transfers[to]);
+                }
+            }
+            buildStats.originsPerThread[id]++;
+        }
+        buildStats.busySecondsPerThread[id] =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    };
+
+    auto started = std::chrono::steady_clock::now();
+    TaskScheduler::TaskGroup group(scheduler);
+    for (int id = 1; id < workers; ++id) {
+        group.run([&worker, id] { worker(id); });
+    }
+    worker(0);
+    group.wait();
+    buildStats.wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    if (stats) {
+        *stats = buildStats;
+    }
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        lastStats = std::move(buildStats);
+    }
+    return matrix;
+}
+
+MatrixBuildStats TravelTimeMatrixAlgorithm::getLastStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return lastStats;
+}
+
+void TravelTimeMatrixAlgorithm::printStats(std::ostream& os) const {
+    const MatrixBuildStats stats = getLastStats();
+    os << "Время построения: " << std::fixed << std::setprecision(3)
+       << stats.wallSeconds << " с, задач: " << stats.originsPerThread.size() << "\n";
+    for (size_t i = 0; i < stats.originsPerThread.size(); ++i) {
+        double busy = stats.busySecondsPerThread[i];
+        double rate = busy > 0 ? stats.originsPerThread[i] / busy : 0.0;
+        os << "  Задача " << i << ": " << stats.originsPerThread[i] << " остановок, "
+           << std::setprecision(1) << rate << " остановок/с\n";
+    }
+    os << std::defaultfloat;
+    system->getScheduler().printStats(os);
+}
@@ -0,0 +1,74 @@
+#ifndef TRAVEL_MATRIX_H
+#define TRAVEL_MATRIX_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <mutex>
+#include "algorithm.h"
+#include "time.h"
+
+class TimetableIndex;
+
+// Матрица времени в пути и числа пересадок между всеми парами остановок
+class TravelTimeMatrix {
+private:
+    std::vector<std::string> stopNames;
+    Time departureTime;
+    int weekDay;
+    std::vector<uint16_t> travelMinutes;  // построчно: [откуда * n + куда]
+    std::vector<uint8_t> transferCounts;
+
+public:
+    static constexpr uint16_t NO_ROUTE_MINUTES = 0xFFFF;
+    static constexpr uint8_t NO_ROUTE_TRANSFERS = 0xFF;
+
+    TravelTimeMatrix(const std::vector<std::string>& stops, const Time& departure, int day);
+
+    int getStopCount() const;
+    const std::vector<std::string>& getStopNames() const;
+    Time getDepartureTime() const;
+    int getWeekDay() const;
+
+    bool isReachable(int from, int to) const;
+    int getTravelMinutes(int from, int to) const;
+    int getTransferCount(int from, int to) const;
+    void setCell(int from, int to, int minutes, int transfers);
+
+    void saveBinary(const std::string& path) const;
+    void saveCsv(const std::string& path) const;
+};
+
+// Статистика построения матрицы
+struct MatrixBuildStats {
+    double wallSeconds = 0.0;
+    std::vector<int> originsPerThread;       // по задачам планировщика
+    std::vector<double> busySecondsPerThread;
+};
+
+// Построение матрицы: поиск "от одной до всех" из каждой остановки, параллельно задачами
+// планировщика системы (threads - число задач, 0 - по числу его потоков)
+class TravelTimeMatrixAlgorithm : public Algorithm {
+private:
+    int threadCount;
+    // Матрицу могут строить несколько потоков запросов одновременно: каждое построение
+    // собирает статистику в своей копии, а последняя сохраняется под блокировкой
+    mutable std::mutex statsMutex;
+    MatrixBuildStats lastStats;
+
+public:
+    explicit TravelTimeMatrixAlgorithm(TransportSystem* sys, int threads = 0);
+
+    // stats - статистика этого построения (не зависит от построений в других потоках)
+    TravelTimeMatrix build(const Time& departureTime, int weekDay, MatrixBuildStats* stats = nullptr);
+    MatrixBuildStats getLastStats() const;
+    void printStats(std::ostream& os) const;
+
+    void execute() override {}
+
+    std::string getDescription() const override {
+        return "Алгоритм построения матрицы времени в пути между всеми остановками";
+    }
+};
+
+#endif // TRAVEL_MATRIX_H
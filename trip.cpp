@@ -3,7 +3,21 @@
 #include "bus.h"
 #include "tram.h"
 #include "trolleybus.h"
-#include <sstream>
+#include "text_parser.h"
+#include <array>
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+
+namespace {
+
+// Общие массивы смещений всех рейсов процесса (в том числе систем, загружаемых в фоне)
+std::mutex offsetsPoolMutex;
+std::map<std::vector<int>, std::weak_ptr<const std::vector<int>>> offsetsPool;
+// Записи освобожденных массивов удаляются, когда пул вырастает до этого размера
+size_t offsetsPoolPruneSize = 1024;
+
+} // namespace
 
 Trip::Trip(int id, std::shared_ptr<Route> r, std::shared_ptr<Vehicle> v,
          std::shared_ptr<Driver> d, const Time& start, int day)
@@ -14,20 +28,176 @@ Trip::Trip(int id, std::shared_ptr<Route> r, std::shared_ptr<Vehicle> v,
     }
 }
 
+int Trip::templateOffset(const std::string& stop) const {
+    if (!offsets || !route) {
+        return NO_STOP_TIME;
+    }
+    const auto& routeStops = route->getAllStops();
+    for (size_t i = routeStops.size(); i-- > 0;) {
+        if ((*offsets)[i] != NO_STOP_TIME && routeStops[i] == stop) {
+            return (*offsets)[i];
+        }
+    }
+    return NO_STOP_TIME;
+}
+
+int Trip::templateOffsetAt(size_t position) const {
+    if (!offsets) {
+        return NO_STOP_TIME;
+    }
+    // На повторяющейся остановке действует последнее смещение, как и при поиске по названию
+    if (route->hasRepeatedStops()) {
+        return templateOffset(route->getAllStops()[position]);
+    }
+    return (*offsets)[position];
+}
+
 void Trip::setArrivalTime(const std::string& stop, const Time& time) {
-    schedule[stop] = time;
+    int offset = templateOffset(stop);
+    if (offset != NO_STOP_TIME && startTime + offset == time) {
+        exceptions.erase(stop);
+        return;
+    }
+    exceptions[stop] = time;
 }
 
 Time Trip::getArrivalTime(const std::string& stop) const {
-    auto it = schedule.find(stop);
-    if (it != schedule.end()) {
+    auto it = exceptions.find(stop);
+    if (it != exceptions.end()) {
         return it->second;
     }
+    int offset = templateOffset(stop);
+    if (offset != NO_STOP_TIME) {
+        return startTime + offset;
+    }
     throw ContainerException("Остановка не найдена в расписании рейса");
 }
 
 bool Trip::hasStop(const std::string& stop) const {
-    return schedule.find(stop) != schedule.end();
+    return exceptions.find(stop) != exceptions.end() || templateOffset(stop) != NO_STOP_TIME;
+}
+
+Time Trip::getArrivalTimeAt(size_t position) const {
+    if (!exceptions.empty()) {
+        auto it = exceptions.find(route->getAllStops()[position]);
+        if (it != exceptions.end()) {
+            return it->second;
+        }
+    }
+    int offset = templateOffsetAt(position);
+    if (offset != NO_STOP_TIME) {
+        return startTime + offset;
+    }
+    throw ContainerException("Остановка не найдена в расписании рейса");
+}
+
+bool Trip::hasStopAt(size_t position) const {
+    if (!exceptions.empty() && exceptions.find(route->getAllStops()[position]) != exceptions.end()) {
+        return true;
+    }
+    return templateOffsetAt(position) != NO_STOP_TIME;
+}
+
+std::shared_ptr<const std::vector<int>> Trip::shareOffsets(std::vector<int> stopOffsets) {
+    for (int offset : stopOffsets) {
+        if (offset < 0 && offset != NO_STOP_TIME) {
+            throw InputException("Смещение времени прибытия не может быть отрицательным");
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(offsetsPoolMutex);
+    auto it = offsetsPool.find(stopOffsets);
+    if (it != offsetsPool.end()) {
+        if (auto existing = it->second.lock()) {
+            return existing;
+        }
+    }
+    auto shared = std::make_shared<const std::vector<int>>(std::move(stopOffsets));
+    if (it != offsetsPool.end()) {
+        it->second = shared;
+        return shared;
+    }
+    if (offsetsPool.size() >= offsetsPoolPruneSize) {
+        std::erase_if(offsetsPool, [](const auto& entry) { return entry.second.expired(); });
+        offsetsPoolPruneSize = std::max<size_t>(1024, offsetsPool.size() * 2);
+    }
+    offsetsPool.emplace(*shared, shared);
+    return shared;
+}
+
+size_t Trip::sharedOffsetsCount() {
+    std::lock_guard<std::mutex> lock(offsetsPoolMutex);
+    return static_cast<size_t>(std::count_if(offsetsPool.begin(), offsetsPool.end(),
+                                             [](const auto& entry) { return !entry.second.expired(); }));
+}
+
+void Trip::setScheduleOffsets(std::shared_ptr<const std::vector<int>> stopOffsets) {
+    if (stopOffsets && (!route || stopOffsets->size() != route->getAllStops().size())) {
+        throw InputException("Шаблон расписания не подходит к маршруту рейса " + std::to_string(tripId));
+    }
+    if (route) {
+        for (const auto& stop : route->getAllStops()) {
+            exceptions.erase(stop);
+        }
+    }
+    offsets = std::move(stopOffsets);
+}
+
+void Trip::shareSchedule() {
+    if (!route || exceptions.empty()) {
+        return;
+    }
+    const auto& routeStops = route->getAllStops();
+    std::vector<int> stopOffsets = offsets ? *offsets : std::vector<int>(routeStops.size(), NO_STOP_TIME);
+    const int start = startTime.getTotalMinutes();
+    bool moved = false;
+    for (size_t i = 0; i < routeStops.size(); ++i) {
+        auto it = exceptions.find(routeStops[i]);
+        if (it != exceptions.end()) {
+            stopOffsets[i] = ((it->second.getTotalMinutes() - start) % 1440 + 1440) % 1440;
+            moved = true;
+        }
+    }
+    if (!moved) {
+        return;
+    }
+    for (const auto& stop : routeStops) {
+        exceptions.erase(stop);
+    }
+    offsets = shareOffsets(std::move(stopOffsets));
+}
+
+const std::shared_ptr<const std::vector<int>>& Trip::getScheduleOffsets() const {
+    return offsets;
+}
+
+const std::map<std::string, Time>& Trip::getScheduleExceptions() const {
+    return exceptions;
+}
+
+void Trip::getRouteStopMinutes(std::vector<int>& minutes) const {
+    const auto& routeStops = route->getAllStops();
+    minutes.resize(routeStops.size());
+    const int start = startTime.getTotalMinutes();
+    if (offsets && exceptions.empty() && !route->hasRepeatedStops()) {
+        // Без зависимостей между итерациями - цикл векторизуется компилятором
+        const int* source = offsets->data();
+        for (size_t i = 0; i < minutes.size(); ++i) {
+            minutes[i] = source[i] == NO_STOP_TIME ? NO_STOP_TIME : (start + source[i]) % 1440;
+        }
+        return;
+    }
+    for (size_t i = 0; i < routeStops.size(); ++i) {
+        if (!exceptions.empty()) {
+            auto it = exceptions.find(routeStops[i]);
+            if (it != exceptions.end()) {
+                minutes[i] = it->second.getTotalMinutes();
+                continue;
+            }
+        }
+        int offset = templateOffsetAt(i);
+        minutes[i] = offset == NO_STOP_TIME ? NO_STOP_TIME : (start + offset) % 1440;
+    }
 }
 
 int Trip::getTripId() const {
@@ -50,7 +220,19 @@ Time Trip::getStartTime() const {
     return startTime;
 }
 
-const std::map<std::string, Time>& Trip::getSchedule() const {
+std::map<std::string, Time> Trip::getSchedule() const {
+    std::map<std::string, Time> schedule;
+    if (offsets) {
+        const auto& routeStops = route->getAllStops();
+        for (size_t i = 0; i < routeStops.size(); ++i) {
+            if ((*offsets)[i] != NO_STOP_TIME) {
+                schedule[routeStops[i]] = startTime + (*offsets)[i];
+            }
+        }
+    }
+    for (const auto& [stop, time] : exceptions) {
+        schedule[stop] = time;
+    }
     return schedule;
 }
 
@@ -68,7 +250,7 @@ std::string Trip::serialize() const {
                        startTime.serialize() + "|" + std::to_string(weekDay) + "|";
 
     std::string scheduleStr;
-    for (const auto& [stop, time] : schedule) {
+    for (const auto& [stop, time] : getSchedule()) {
         scheduleStr += stop + "=" + time.serialize() + ";";
     }
     if (!scheduleStr.empty()) scheduleStr.pop_back();
@@ -77,150 +259,240 @@ std::string Trip::serialize() const {
     return result;
 }
 
-std::shared_ptr<Trip> Trip::deserialize(const std::string& data, TransportSystem* system) {
-    std::istringstream ss(data);
-    std::string token;
-    std::vector<std::string> tokens;
+namespace {
 
-    while (std::getline(ss, token, '|')) {
-        tokens.push_back(token);
-    }
+// Список дней недели вида "1,2,3" (по нему отличается текущий формат строки рейса)
+bool isWeekDayList(std::string_view token) {
+    return !token.empty() &&
+           std::all_of(token.begin(), token.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) || c == ','; });
+}
 
-    if (tokens.size() < 6) {
-        throw InputException("Некорректные данные рейса");
+// Больше полей строка рейса не содержит ни в одном из форматов
+const size_t MAX_TRIP_FIELDS = 20;
+
+} // namespace
+
+std::string Trip::serializeByReference() const {
+    const auto& routeStops = route->getAllStops();
+    for (const auto& [stop, time] : exceptions) {
+        if (std::find(routeStops.begin(), routeStops.end(), stop) == routeStops.end()) {
+            return {};
+        }
     }
 
-    int tripId = std::stoi(tokens[0]);
+    std::string result = std::to_string(tripId) + "|" + std::to_string(route->getNumber()) + "|" +
+                         vehicle->getLicensePlate() + "|" + driver->getFirstName() + "|" +
+                         driver->getLastName() + "|" + driver->getMiddleName() + "|" +
+                         startTime.serialize() + "|" + std::to_string(weekDay) + "|";
+
+    // Время на повторяющейся остановке кольцевого маршрута пишется один раз
+    std::vector<std::string_view> written;
+    std::vector<int> minutes;
+    getRouteStopMinutes(minutes);
+    const int start = startTime.getTotalMinutes();
+    for (size_t i = 0; i < routeStops.size(); ++i) {
+        if (i > 0) {
+            result += ';';
+        }
+        const std::string& stop = routeStops[i];
+        if (minutes[i] == NO_STOP_TIME ||
+            (route->hasRepeatedStops() && std::find(written.begin(), written.end(), stop) != written.end())) {
+            continue;
+        }
+        written.push_back(stop);
+        result += std::to_string(((minutes[i] - start) % 1440 + 1440) % 1440);
+    }
+    return result;
+}
 
-    std::shared_ptr<Route> route;
-    int vehicleTokenIndex, driverTokenIndex, timeTokenIndex, scheduleTokenIndex;
+ParsedTrip Trip::parse(std::string_view data, int formatVersion) {
+    std::array<std::string_view, MAX_TRIP_FIELDS> tokens;
+    size_t tokenCount = 0;
+    FieldTokenizer fields(data, '|');
+    std::string_view field;
+    while (tokenCount < MAX_TRIP_FIELDS && fields.next(field)) {
+        tokens[tokenCount++] = field;
+    }
 
-    if (tokens.size() >= 11) {
-        std::string routeData = tokens[1] + "|" + tokens[2] + "|" + tokens[3];
-        route = Route::deserialize(routeData);
-        vehicleTokenIndex = 4;
-        driverTokenIndex = 7;
-        timeTokenIndex = 10;
-        scheduleTokenIndex = 11;
-    } else {
-        route = Route::deserialize(tokens[1]);
-        vehicleTokenIndex = 2;
-        driverTokenIndex = 3;
-        timeTokenIndex = 4;
-        scheduleTokenIndex = 5;
+    if (tokenCount < 6) {
+        throw InputException("Некорректные данные рейса");
     }
 
-    std::shared_ptr<Vehicle> vehicle = nullptr;
-    if (system) {
-        std::string type, model, licensePlate;
-
-        if (tokens.size() >= 11) {
-            type = tokens[vehicleTokenIndex];
-            model = tokens[vehicleTokenIndex + 1];
-            licensePlate = tokens[vehicleTokenIndex + 2];
-        } else {
-            std::istringstream vehicleStream(tokens[vehicleTokenIndex]);
-            std::getline(vehicleStream, type, '|');
-            std::getline(vehicleStream, model, '|');
-            std::getline(vehicleStream, licensePlate);
-        }
-
-        vehicle = system->findVehicleByLicensePlate(licensePlate);
-
-        if (!vehicle && tokens.size() >= 11) {
-            std::shared_ptr<Vehicle> newVehicle;
-            if (type == "Автобус") {
-                newVehicle = std::make_shared<Bus>(model, licensePlate);
-            } else if (type == "Трамвай") {
-                newVehicle = std::make_shared<Tram>(model, licensePlate);
-            } else if (type == "Троллейбус") {
-                newVehicle = std::make_shared<Trolleybus>(model, licensePlate);
+    ParsedTrip parsed;
+    parsed.tripId = parseIntField(tokens[0]);
+
+    if (formatVersion >= 2 && tokenCount == REFERENCE_FIELD_COUNT) {
+        parsed.byReference = true;
+        parsed.routeNumber = parseIntField(tokens[1]);
+        parsed.licensePlate = tokens[2];
+        parsed.driverFirstName = tokens[3];
+        parsed.driverLastName = tokens[4];
+        parsed.driverMiddleName = tokens[5];
+        parsed.startTime = parseTimeField(tokens[6]);
+        int weekDay = parseIntField(tokens[7]);
+        if (weekDay < 1 || weekDay > 7) {
+            throw InputException("Некорректный день недели рейса");
+        }
+        parsed.weekDay = weekDay;
+
+        // Пустое поле - остановка без времени; последнее поле пустым не опускается
+        size_t position = 0;
+        std::string_view offsets = tokens[8];
+        while (true) {
+            size_t end = offsets.find(';', position);
+            std::string_view offset = offsets.substr(position, end == std::string_view::npos ? end : end - position);
+            int minutes = offset.empty() ? NO_STOP_TIME : parseIntField(offset);
+            if (!offset.empty() && minutes < 0) {
+                throw InputException("Смещение времени прибытия не может быть отрицательным");
             }
-            if (newVehicle) {
-                try {
-                    system->addVehicle(newVehicle);
-                    vehicle = newVehicle;
-                } catch (...) {
-                    vehicle = system->findVehicleByLicensePlate(licensePlate);
-                }
+            parsed.stopOffsets.push_back(minutes);
+            if (end == std::string_view::npos) {
+                break;
             }
+            position = end + 1;
         }
+        return parsed;
     }
 
-    std::shared_ptr<Driver> driver;
-    if (tokens.size() >= 11) {
-        std::string firstName = tokens[driverTokenIndex];
-        std::string lastName = tokens[driverTokenIndex + 1];
-        std::string middleName = (driverTokenIndex + 2 < tokens.size() && !tokens[driverTokenIndex + 2].empty()) ? tokens[driverTokenIndex + 2] : "";
+    size_t timeTokenIndex;
+    if (tokenCount >= 16 && isWeekDayList(tokens[4])) {
+        // Текущий формат: id|маршрут(4)|транспорт(5)|водитель(4)|время|день|расписание
+        parsed.route = Route::fromFields(tokens[1], tokens[2], tokens[3], tokens[4]);
+        parsed.vehicleType = tokens[5];
+        parsed.vehicleModel = tokens[6];
+        parsed.licensePlate = tokens[7];
+        parsed.canCreateVehicle = true;
+        parsed.driverFirstName = tokens[10];
+        parsed.driverLastName = tokens[11];
+        parsed.driverMiddleName = tokens[12];
+        parsed.driverCategory = tokens[13];
+        timeTokenIndex = 14;
+    } else if (tokenCount >= 11) {
+        // Старый формат: маршрут без дней недели, транспорт и водитель по три поля
+        parsed.route = Route::fromFields(tokens[1], tokens[2], tokens[3], {});
+        parsed.vehicleType = tokens[4];
+        parsed.vehicleModel = tokens[5];
+        parsed.licensePlate = tokens[6];
+        parsed.canCreateVehicle = true;
+        parsed.driverFirstName = tokens[7];
+        parsed.driverLastName = tokens[8];
+        parsed.driverMiddleName = tokens[9];
+        timeTokenIndex = 10;
+    } else {
+        // Самый старый формат: маршрут, транспорт и водитель - по одному полю
+        parsed.route = Route::deserialize(tokens[1]);
+        parsed.vehicleType = tokens[2];
+        parsed.driverFirstName = tokens[3];
+        timeTokenIndex = 4;
+    }
 
-        driver = system ? system->findDriverByName(firstName, lastName, middleName) : nullptr;
+    parsed.startTime = parseTimeField(tokens[timeTokenIndex]);
 
-        if (!driver) {
-            driver = std::make_shared<Driver>(firstName, lastName, middleName);
-            if (system) {
-                try {
-                    system->addDriver(driver);
-                } catch (...) {
-                    driver = system->findDriverByName(firstName, lastName, middleName);
-                }
-            }
-        }
-    } else {
-        driver = Driver::deserialize(tokens[driverTokenIndex]);
-        if (system) {
-            auto existingDriver = system->findDriverByName(
-                driver->getFirstName(),
-                driver->getLastName(),
-                driver->getMiddleName());
-            if (existingDriver) {
-                driver = existingDriver;
-            } else {
-                try {
-                    system->addDriver(driver);
-                } catch (...) {
-                }
-            }
+    size_t scheduleTokenIndex = timeTokenIndex + 1;
+    if (timeTokenIndex + 1 < tokenCount) {
+        try {
+            int weekDay = parseIntField(tokens[timeTokenIndex + 1]);
+            parsed.weekDay = (weekDay < 1 || weekDay > 7) ? 1 : weekDay;
+            scheduleTokenIndex = timeTokenIndex + 2;
+        } catch (const InputException&) {
         }
     }
 
-    Time startTime = Time::deserialize(tokens[timeTokenIndex]);
-    
-    int weekDay = 1;
-    if (tokens.size() < 11) {
-        if (timeTokenIndex + 1 < tokens.size()) {
-            try {
-                weekDay = std::stoi(tokens[timeTokenIndex + 1]);
-                if (weekDay < 1 || weekDay > 7) weekDay = 1;
-                scheduleTokenIndex = timeTokenIndex + 2;
-            } catch (...) {
-                scheduleTokenIndex = timeTokenIndex + 1;
+    if (scheduleTokenIndex < tokenCount && !tokens[scheduleTokenIndex].empty()) {
+        FieldTokenizer stopTimes(tokens[scheduleTokenIndex], ';');
+        std::string_view stopTimePair;
+        while (stopTimes.next(stopTimePair)) {
+            size_t eqPos = stopTimePair.find('=');
+            if (eqPos != std::string_view::npos) {
+                parsed.schedule.emplace_back(std::string(stopTimePair.substr(0, eqPos)),
+                                             parseTimeField(stopTimePair.substr(eqPos + 1)));
             }
-        } else {
-            scheduleTokenIndex = timeTokenIndex + 1;
         }
-    } else {
-        scheduleTokenIndex = timeTokenIndex + 1;
     }
 
+    return parsed;
+}
+
+void Trip::resolveRoute(ParsedTrip& parsed, std::shared_ptr<Route> route) {
+    if (!route) {
+        throw ContainerException("Маршрут " + std::to_string(parsed.routeNumber) + " не найден в системе");
+    }
+    const auto& routeStops = route->getAllStops();
+    if (parsed.stopOffsets.size() != routeStops.size()) {
+        throw InputException("Число времен в расписании не совпадает с числом остановок маршрута " +
+                             std::to_string(parsed.routeNumber));
+    }
+
+    // Расписание строится из смещений в fromParsed (общий шаблон)
+    parsed.route = std::move(route);
+}
+
+std::shared_ptr<Trip> Trip::fromParsed(const ParsedTrip& parsed, std::shared_ptr<Vehicle> vehicle,
+                                       std::shared_ptr<Driver> driver) {
     if (!vehicle) {
         throw ContainerException("Транспортное средство не найдено в системе");
     }
 
-    auto trip = std::make_shared<Trip>(tripId, route, vehicle, driver, startTime, weekDay);
+    auto trip = std::make_shared<Trip>(parsed.tripId, parsed.route, std::move(vehicle), std::move(driver),
+                                       parsed.startTime, parsed.weekDay);
+    if (parsed.byReference) {
+        trip->setScheduleOffsets(shareOffsets(parsed.stopOffsets));
+        return trip;
+    }
+    for (const auto& [stop, time] : parsed.schedule) {
+        trip->setArrivalTime(stop, time);
+    }
+    trip->shareSchedule();
+    return trip;
+}
 
-    if (scheduleTokenIndex < tokens.size() && !tokens[scheduleTokenIndex].empty()) {
-        std::istringstream scheduleStream(tokens[scheduleTokenIndex]);
-        std::string stopTimePair;
-        while (std::getline(scheduleStream, stopTimePair, ';')) {
-            size_t eqPos = stopTimePair.find('=');
-            if (eqPos != std::string::npos) {
-                std::string stop = stopTimePair.substr(0, eqPos);
-                std::string timeStr = stopTimePair.substr(eqPos + 1);
-                trip->setArrivalTime(stop, Time::deserialize(timeStr));
+std::shared_ptr<Vehicle> Trip::createVehicle(const ParsedTrip& parsed) {
+    if (!parsed.canCreateVehicle) {
+        return nullptr;
+    }
+    if (parsed.vehicleType == "Автобус") {
+        return std::make_shared<Bus>(parsed.vehicleModel, parsed.licensePlate);
+    } else if (parsed.vehicleType == "Трамвай") {
+        return std::make_shared<Tram>(parsed.vehicleModel, parsed.licensePlate);
+    } else if (parsed.vehicleType == "Троллейбус") {
+        return std::make_shared<Trolleybus>(parsed.vehicleModel, parsed.licensePlate);
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Trip> Trip::deserialize(const std::string& data, TransportSystem* system) {
+    ParsedTrip parsed = parse(data);
+
+    std::shared_ptr<Vehicle> vehicle = nullptr;
+    if (system) {
+        vehicle = system->findVehicleByLicensePlate(parsed.licensePlate);
+        if (!vehicle) {
+            if (auto newVehicle = createVehicle(parsed)) {
+                try {
+                    system->addVehicle(newVehicle);
+                    vehicle = newVehicle;
+                } catch (...) {
+                    vehicle = system->findVehicleByLicensePlate(parsed.licensePlate);
+                }
             }
         }
     }
 
-    return trip;
-}
+    std::shared_ptr<Driver> driver = system ? system->findDriverByName(parsed.driverFirstName,
+                                                                       parsed.driverLastName,
+                                                                       parsed.driverMiddleName) : nullptr;
+    if (!driver) {
+        driver = std::make_shared<Driver>(parsed.driverFirstName, parsed.driverLastName,
+                                          parsed.driverMiddleName, parsed.driverCategory);
+        if (system) {
+            try {
+                system->addDriver(driver);
+            } catch (...) {
+                driver = system->findDriverByName(parsed.driverFirstName, parsed.driverLastName,
+                                                  parsed.driverMiddleName);
+            }
+        }
+    }
 
+    return fromParsed(parsed, vehicle, driver);
+}
@@ -4,6 +4,9 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
 #include "route.h"
 #include "vehicle.h"
 #include "driver.h"
@@ -12,6 +15,30 @@
 
 class TransportSystem;
 
+// Рейс, разобранный из строки trips.txt, но еще не связанный с транспортом
+// и водителями системы. Разбор не обращается к системе и может выполняться параллельно.
+struct ParsedTrip {
+    int tripId = 0;
+    std::shared_ptr<Route> route;
+    std::string vehicleType;
+    std::string vehicleModel;
+    std::string licensePlate;
+    bool canCreateVehicle = false; // в строке есть тип и модель - транспорт можно создать
+    std::string driverFirstName;
+    std::string driverLastName;
+    std::string driverMiddleName;
+    std::string driverCategory;
+    Time startTime;
+    int weekDay = 1;
+    std::vector<std::pair<std::string, Time>> schedule;
+
+    // Строка нормализованного формата: маршрут задан номером, а расписание -
+    // смещениями от времени отправления по порядку остановок маршрута
+    bool byReference = false;
+    int routeNumber = 0;
+    std::vector<int> stopOffsets; // NO_STOP_TIME - рейс на остановке не останавливается
+};
+
 class Trip {
 private:
     int tripId;
@@ -19,29 +46,78 @@ private:
     std::shared_ptr<Vehicle> vehicle;
     std::shared_ptr<Driver> driver;
     Time startTime;
-    std::map<std::string, Time> schedule; // остановка -> время прибытия
+    // Расписание: общий шаблон смещений от отправления по порядку остановок маршрута
+    // (один на все рейсы с одинаковыми смещениями) и время, отличающееся от шаблона.
+    // Время остановки в exceptions важнее шаблона; на повторяющейся остановке
+    // кольцевого маршрута действует последнее заданное смещение
+    std::shared_ptr<const std::vector<int>> offsets;
+    std::map<std::string, Time> exceptions; // остановка -> время прибытия
     int weekDay; // День недели: 1-понедельник, 2-вторник, ..., 7-воскресенье
 
+    // Смещение остановки по шаблону; NO_STOP_TIME, если его нет
+    int templateOffset(const std::string& stop) const;
+    // Смещение по шаблону для остановки с номером position в маршруте; NO_STOP_TIME, если его нет
+    int templateOffsetAt(size_t position) const;
+
 public:
+    static const int NO_STOP_TIME = -1;
+    // Число полей строки нормализованного формата
+    static const size_t REFERENCE_FIELD_COUNT = 9;
+
     Trip(int id, std::shared_ptr<Route> r, std::shared_ptr<Vehicle> v,
          std::shared_ptr<Driver> d, const Time& start, int day = 1);
 
     void setArrivalTime(const std::string& stop, const Time& time);
     Time getArrivalTime(const std::string& stop) const;
     bool hasStop(const std::string& stop) const;
+    // То же по номеру остановки в маршруте рейса (номер не проверяется): время читается
+    // из шаблона по номеру, без сравнения названий остановок
+    Time getArrivalTimeAt(size_t position) const;
+    bool hasStopAt(size_t position) const;
+
+    // Общий массив смещений с тем же содержимым, если он уже есть (иначе новый)
+    static std::shared_ptr<const std::vector<int>> shareOffsets(std::vector<int> stopOffsets);
+    // Число различных общих массивов смещений
+    static size_t sharedOffsetsCount();
+    // Время на остановках маршрута задается шаблоном (по одному смещению на остановку,
+    // NO_STOP_TIME - без времени); время на остановках вне маршрута сохраняется
+    void setScheduleOffsets(std::shared_ptr<const std::vector<int>> stopOffsets);
+    // Переносит время на остановках маршрута в общий шаблон (после разбора по одной остановке)
+    void shareSchedule();
+    const std::shared_ptr<const std::vector<int>>& getScheduleOffsets() const;
+    const std::map<std::string, Time>& getScheduleExceptions() const;
+    // Время прибытия (минуты от начала суток) по порядку остановок маршрута, NO_STOP_TIME - нет времени.
+    // Для рейса без отличий от шаблона - время отправления плюс шаблон
+    void getRouteStopMinutes(std::vector<int>& minutes) const;
 
     int getTripId() const;
     std::shared_ptr<Route> getRoute() const;
     std::shared_ptr<Vehicle> getVehicle() const;
     std::shared_ptr<Driver> getDriver() const;
     Time getStartTime() const;
-    const std::map<std::string, Time>& getSchedule() const;
+    // Полное расписание остановка -> время, собранное из шаблона и отличий
+    std::map<std::string, Time> getSchedule() const;
     int getWeekDay() const;
 
     Time getEstimatedEndTime() const;
 
     std::string serialize() const;
     static std::shared_ptr<Trip> deserialize(const std::string& data, TransportSystem* system = nullptr);
+
+    // Нормализованная строка: id|маршрут|госномер|имя|фамилия|отчество|время|день|смещения.
+    // Пустая строка, если рейс так записать нельзя (на остановке вне маршрута есть время)
+    std::string serializeByReference() const;
+
+    // Разбор строки без обращения к системе. В файле версии 2 строки
+    // из REFERENCE_FIELD_COUNT полей разбираются как нормализованные
+    static ParsedTrip parse(std::string_view data, int formatVersion = 1);
+    // Подстановка маршрута системы в нормализованную строку и сборка расписания
+    static void resolveRoute(ParsedTrip& parsed, std::shared_ptr<Route> route);
+    // Сборка рейса из разобранной строки с уже найденными транспортом и водителем
+    static std::shared_ptr<Trip> fromParsed(const ParsedTrip& parsed, std::shared_ptr<Vehicle> vehicle,
+                                            std::shared_ptr<Driver> driver);
+    // Новый транспорт по данным строки (nullptr, если данных недостаточно)
+    static std::shared_ptr<Vehicle> createVehicle(const ParsedTrip& parsed);
 };
 
 #endif // TRIP_H
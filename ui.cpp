@@ -20,6 +20,7 @@ void displayGuestMenu() {
     std::cout << "1. Просмотр расписания транспорта\n";
     std::cout << "2. Просмотр расписания остановки\n";
     std::cout << "3. Поиск маршрутов между остановками\n";
+    std::cout << "4. Поиск поездки с прибытием к сроку\n";
     std::cout << "0. Выход в главное меню\n";
     std::cout << "Выберите опцию: ";
 }
@@ -41,7 +42,10 @@ void displayAdminMenu() {
     std::cout << "12. Просмотр всех данных\n";
     std::cout << "13. Сохранить данные\n";
     std::cout << "14. Отменить последнее действие\n";
-    std::cout << "15. Выход\n";
+    std::cout << "15. Построить матрицу времени в пути\n";
+    std::cout << "16. Импорт расписания GTFS\n";
+    std::cout << "17. Задержка рейса\n";
+    std::cout << "18. Выход\n";
     std::cout << "Выберите опцию: ";
 }
 
@@ -1059,16 +1063,15 @@ void initializeTestData(TransportSystem& system) {
 
         // Рассчитываем время прибытия для всех рейсов
         // Скорости: автобусы ~30 км/ч, трамваи ~25 км/ч, троллейбусы ~28 км/ч
-        for (int i = 1; i <= 272; i++) {
-            auto trip = system.getTripById(i);
-            if (trip) {
-                std::string vehicleType = trip->getRoute()->getVehicleType();
+        system.recalculateArrivalTimes(
+            [](const Trip& trip) { return trip.getTripId() >= 1 && trip.getTripId() <= 272; },
+            [](const Trip& trip) {
+                std::string vehicleType = trip.getRoute()->getVehicleType();
                 double speed = 30.0; // по умолчанию
                 if (vehicleType == "Трамвай") speed = 25.0;
                 else if (vehicleType == "Троллейбус") speed = 28.0;
-                system.calculateArrivalTimes(i, speed);
-            }
-        }
+                return speed;
+            });
 
     } catch (const std::exception& e) {
         std::cout << "Ошибка при создании тестовых рейсов: " << e.what() << "\n";
@@ -1117,6 +1120,45 @@ void searchRoutes(TransportSystem& system) {
     }
 }
 
+void searchArriveBy(TransportSystem& system) {
+    try {
+        std::string stopAInput, stopBInput, deadlineStr;
+
+        displayAllStopsForSelection(system);
+
+        std::cout << "\nВведите начальную остановку (ID или название): ";
+        std::getline(std::cin, stopAInput);
+        std::cout << "Введите конечную остановку (ID или название): ";
+        std::getline(std::cin, stopBInput);
+        std::cout << "Введите время, к которому нужно прибыть (HH:MM): ";
+        std::getline(std::cin, deadlineStr);
+
+        std::cout << "Введите день недели (1-7, 0 - любой день): ";
+        int weekDay;
+        if (!(std::cin >> weekDay)) {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            throw InputException("Неверный формат ввода для дня недели");
+        }
+        std::cin.ignore();
+
+        if (weekDay < 0 || weekDay > 7) {
+            throw InputException("Неверный выбор дня недели. Допустимые значения: 0-7");
+        }
+
+        std::string stopA = getStopNameByInput(system, stopAInput);
+        std::string stopB = getStopNameByInput(system, stopBInput);
+        Time deadline(deadlineStr);
+
+        Journey journey = system.getJourneyPlanner().findLatestDepartureJourney(stopA, stopB, deadline, weekDay);
+        std::cout << "\nВыезжайте не позже " << journey.getStartTime()
+                  << ", чтобы прибыть к " << deadline << ".\n";
+        journey.display();
+    } catch (const std::exception& e) {
+        std::cout << "Ошибка: " << e.what() << "\n";
+    }
+}
+
 void viewStopTimetable(TransportSystem& system) {
     try {
         displayAllStopsForSelection(system);
@@ -1149,16 +1191,13 @@ void viewStopTimetable(TransportSystem& system) {
             throw InputException("Неверный выбор дня недели. Допустимые значения: 1-7");
         }
 
-        const auto& trips = system.getTrips();
-        std::vector<std::pair<int, Time>> relevantTrips;
+        std::vector<std::pair<std::shared_ptr<Trip>, Time>> relevantTrips;
 
-        for (const auto& trip : trips) {
-            if (trip->hasStop(stopName)) {
-                int tripDay = trip->getWeekDay();
-                if (tripDay == weekDayChoice) {
-                    Time arrivalTime = trip->getArrivalTime(stopName);
-                    relevantTrips.push_back({trip->getTripId(), arrivalTime});
-                }
+        for (const auto& trip : system.getTripsThroughStop(stopName)) {
+            int tripDay = trip->getWeekDay();
+            if (tripDay == weekDayChoice) {
+                Time arrivalTime = trip->getArrivalTime(stopName);
+                relevantTrips.push_back({trip, arrivalTime});
             }
         }
 
@@ -1173,13 +1212,10 @@ void viewStopTimetable(TransportSystem& system) {
         if (relevantTrips.empty()) {
             std::cout << "Рейсов не найдено.\n";
         } else {
-            for (const auto& [tripId, time] : relevantTrips) {
-                auto trip = system.getTripById(tripId);
-                if (trip) {
-                    std::cout << "Рейс " << tripId << " | Маршрут " << trip->getRoute()->getNumber() 
-                              << " | Отправление: " << trip->getStartTime() 
-                              << " | Прибытие: " << time << "\n";
-                }
+            for (const auto& [trip, time] : relevantTrips) {
+                std::cout << "Рейс " << trip->getTripId() << " | Маршрут " << trip->getRoute()->getNumber() 
+                          << " | Отправление: " << trip->getStartTime() 
+                          << " | Прибытие: " << time << "\n";
             }
         }
         std::cout << "========================================\n";
@@ -1236,15 +1272,12 @@ void viewTransportScheduleGuest(TransportSystem& system) {
             throw InputException("Неверный выбор дня недели. Допустимые значения: 1-7");
         }
 
-        const auto& trips = system.getTrips();
         std::vector<std::shared_ptr<Trip>> filteredTrips;
         
-        for (const auto& trip : trips) {
-            if (trip->getRoute()->getVehicleType() == selectedType) {
-                int tripDay = trip->getWeekDay();
-                if (tripDay == weekDayChoice) {
-                    filteredTrips.push_back(trip);
-                }
+        for (const auto& trip : system.getTripsByVehicleType(selectedType)) {
+            int tripDay = trip->getWeekDay();
+            if (tripDay == weekDayChoice) {
+                filteredTrips.push_back(trip);
             }
         }
 
@@ -1496,7 +1529,7 @@ void calculateArrivalTime(TransportSystem& system) {
         int tripId;
         double speed;
 
-        std::cout << "Введите ID рейса: ";
+        std::cout << "Введите ID рейса (0 - все рейсы): ";
         if (!(std::cin >> tripId)) {
             std::cin.clear();
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -1510,6 +1543,14 @@ void calculateArrivalTime(TransportSystem& system) {
         }
         std::cin.ignore();
 
+        if (tripId == 0) {
+            ArrivalBatchStats stats = system.recalculateArrivalTimes(nullptr, [speed](const Trip&) { return speed; });
+            std::cout << "Пересчитано рейсов: " << stats.trips << ", времен прибытия: " << stats.stopTimes
+                      << " (расчет " << stats.computeMilliseconds << " мс, обновление рейсов "
+                      << stats.applyMilliseconds << " мс, задач " << stats.threads << ")\n";
+            return;
+        }
+
         system.calculateArrivalTimes(tripId, speed);
 
         auto tripIt = std::find_if(trips.begin(), trips.end(),
@@ -1527,6 +1568,101 @@ void calculateArrivalTime(TransportSystem& system) {
     }
 }
 
+void buildTravelMatrix(TransportSystem& system) {
+    try {
+        std::string timeStr;
+        std::cout << "Введите время отправления (HH:MM): ";
+        std::getline(std::cin, timeStr);
+        Time departureTime(timeStr);
+
+        std::cout << "Введите день недели (1-7, 0 - любой день): ";
+        int weekDay;
+        if (!(std::cin >> weekDay)) {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            throw InputException("Неверный формат ввода для дня недели");
+        }
+        std::cin.ignore();
+
+        TravelTimeMatrix matrix = system.buildTravelTimeMatrix(departureTime, weekDay);
+        matrix.saveBinary("data/travel_matrix.bin");
+        matrix.saveCsv("data/travel_matrix.csv");
+
+        std::cout << "\nМатрица " << matrix.getStopCount() << "x" << matrix.getStopCount()
+                  << " сохранена в data/travel_matrix.bin и data/travel_matrix.csv\n";
+        system.getTravelMatrixAlgorithm()->printStats(std::cout);
+    } catch (const std::exception& e) {
+        std::cout << "Ошибка: " << e.what() << "\n";
+    }
+}
+
+void importGtfsFeed(TransportSystem& system) {
+    try {
+        std::string directory;
+        std::cout << "Введите каталог с файлами GTFS (stops.txt, routes.txt, trips.txt, stop_times.txt): ";
+        std::getline(std::cin, directory);
+        if (directory.empty()) {
+            throw InputException("Каталог не указан");
+        }
+        // Импорт не попадает в историю команд и не отменяется
+        system.importGtfs(directory);
+    } catch (const std::exception& e) {
+        std::cout << "Ошибка: " << e.what() << "\n";
+    }
+}
+
+void reportTripDelay(TransportSystem& system) {
+    try {
+        int tripId;
+        std::cout << "Введите ID рейса: ";
+        if (!(std::cin >> tripId)) {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            throw InputException("Неверный формат ввода для ID рейса");
+        }
+        std::cin.ignore();
+        auto trip = system.getTripById(tripId);
+        if (!trip) {
+            throw ContainerException("Рейс с ID " + std::to_string(tripId) + " не найден");
+        }
+
+        std::string stopName;
+        std::cout << "Введите остановку, на которой известна задержка: ";
+        std::getline(std::cin, stopName);
+        const auto& routeStops = trip->getRoute()->getAllStops();
+        auto stopIt = std::find(routeStops.begin(), routeStops.end(), stopName);
+        if (stopIt == routeStops.end()) {
+            throw InputException("Остановка не входит в маршрут рейса: " + stopName);
+        }
+
+        int delay;
+        int recovery;
+        std::cout << "Введите задержку в минутах (отрицательная - рейс идет раньше): ";
+        if (!(std::cin >> delay)) {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            throw InputException("Неверный формат ввода для задержки");
+        }
+        std::cout << "Сколько минут рейс нагоняет на каждой следующей остановке: ";
+        if (!(std::cin >> recovery)) {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            throw InputException("Неверный формат ввода для нагона");
+        }
+        std::cin.ignore();
+
+        DelayUpdateResult result = system.applyDelay(tripId, static_cast<size_t>(stopIt - routeStops.begin()),
+                                                     delay, recovery);
+        std::cout << "Изменено время на " << result.affectedStops << " остановках, перегонов в индексе: "
+                  << result.changedConnections << " (" << result.microseconds << " мкс)\n";
+        for (const auto& [stop, time] : system.getTripById(tripId)->getSchedule()) {
+            std::cout << "  " << stop << " - " << time << '\n';
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Ошибка: " << e.what() << "\n";
+    }
+}
+
 void showAllTrips(const TransportSystem& system) {
     const auto& trips = system.getTrips();
     if (trips.empty()) {
@@ -1548,6 +1684,9 @@ void runGuestMode(TransportSystem& system) {
     bool running = true;
 
     while (running) {
+        system.applyPendingReload();
+        system.applyRealtimeUpdates();
+        system.publishSnapshot();
         displayGuestMenu();
         if (!(std::cin >> choice)) {
             std::cin.clear();
@@ -1563,6 +1702,7 @@ void runGuestMode(TransportSystem& system) {
                 case 1: viewTransportScheduleGuest(system); break;
                 case 2: viewStopTimetable(system); break;
                 case 3: searchRoutes(system); break;
+                case 4: searchArriveBy(system); break;
                 default: std::cout << "Неверный выбор.\n";
             }
         } catch (const InputException& e) {
@@ -1598,6 +1738,10 @@ void runAdminMode(TransportSystem& system) {
     bool running = true;
 
     while (running) {
+        system.reportSaveStatus();
+        system.applyPendingReload();
+        system.applyRealtimeUpdates();
+        system.publishSnapshot();
         displayAdminMenu();
         if (!(std::cin >> choice)) {
             std::cin.clear();
@@ -1713,7 +1857,10 @@ void runAdminMode(TransportSystem& system) {
                     }
                     break;
                 }
-                case 15: 
+                case 15: buildTravelMatrix(system); break;
+                case 16: importGtfsFeed(system); break;
+                case 17: reportTripDelay(system); break;
+                case 18: 
                     system.saveData();
                     std::cout << "Данные сохранены. Выход из административного режима.\n";
                     running = false; 
@@ -20,8 +20,12 @@ void viewTransportSchedule(TransportSystem& system);
 void viewTransportScheduleGuest(TransportSystem& system);
 void viewStopTimetable(TransportSystem& system);
 void searchRoutes(TransportSystem& system);
+void searchArriveBy(TransportSystem& system);
 void calculateArrivalTime(TransportSystem& system);
 void showAllTrips(const TransportSystem& system);
+void buildTravelMatrix(TransportSystem& system);
+void importGtfsFeed(TransportSystem& system);
+void reportTripDelay(TransportSystem& system);
 
 void runGuestMode(TransportSystem& system);
 void runAdminMode(TransportSystem& system);